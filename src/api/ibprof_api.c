@@ -23,24 +23,12 @@ extern IBPROF_MODULE_OBJECT mxm_module;
 extern IBPROF_MODULE_OBJECT pmix_module;
 extern IBPROF_MODULE_OBJECT shmem_module;
 
-/****************************************************************************
- * Configuration options
- ***************************************************************************/
-#ifndef CONF_TIMESTAMP
-#define CONF_TIMESTAMP  0
-#endif
-
-typedef void (*ibprof_format_dump)(FILE*, IBPROF_OBJECT*);
-
 ibprof_format_dump format_dump;
 
 /****************************************************************************
  * Static Function Declarations
  ***************************************************************************/
 static IBPROF_ERROR __get_env(void);
-#if defined(CONF_TIMESTAMP) && (CONF_TIMESTAMP == 1)
-static double __get_cpu_clocks_per_sec(void);
-#endif /* CONF_TIMESTAMP */
 
 static IBPROF_MODULE_OBJECT user_module = {IBPROF_MODULE_USER,
 					       "user",
@@ -66,7 +54,7 @@ static IBPROF_MODULE_OBJECT *__ibprof_modules[] = {
 void __ibprof_init(void);
 void __ibprof_exit(void);
 
-static IBPROF_OBJECT *ibprof_obj = NULL;	/* Verify a pointer to this object with NULL to check ACTIVE/CLOSE */
+IBPROF_OBJECT *ibprof_obj = NULL;	/* Verify a pointer to this object with NULL to check ACTIVE/CLOSE */
 pthread_once_t ibprof_initialized = PTHREAD_ONCE_INIT;
 
 #if defined(HAVE_VISIBILITY)
@@ -75,89 +63,138 @@ pthread_once_t ibprof_initialized = PTHREAD_ONCE_INIT;
 
 double ibprof_timestamp(void)
 {
-#if defined(CONF_TIMESTAMP) && (CONF_TIMESTAMP == 1)
-	return ((double)sys_rdtsc() / __get_cpu_clocks_per_sec());
-#else
-	struct timeval tv;
-
-	sys_time(&tv);
-
-	return ((tv.tv_sec) + (tv.tv_usec) * 1.0e-6);
-#endif
+	return ibprof_clock_to_sec(ibprof_clock_ticks());
 }
 
 void ibprof_update(int module, int call, double tm)
 {
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
 	IBPROF_HASH_OBJ *entry = NULL;
 	HASH_KEY key;
 
-	if (ibprof_obj) {
+	if ((module >= 0) && (module < IBPROF_MODULE_USER) &&
+		(call >= 0) && (call <= HASH_MAX_CALL)) {
+		ibprof_update_call(module, call, ibprof_clock_from_sec(tm));
+	} else if (ibprof_obj && (thread_obj = ibprof_thread_get())) {
 		key = HASH_KEY_SET(module, call, ibprof_obj->task_obj->procid, 0);
 
-		entry = ibprof_hash_find(ibprof_obj->hash_obj, key);
+		entry = ibprof_hash_find(thread_obj->hash_obj, key);
 		if (entry)
-			ibprof_hash_update(ibprof_obj->hash_obj, entry, tm);
+			ibprof_hash_update(thread_obj->hash_obj, entry,
+					ibprof_clock_from_sec(tm));
 	}
 }
 
 void ibprof_update_ex(int module, int call, double tm, void *ctx)
 {
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
 	IBPROF_HASH_OBJ *entry = NULL;
 	HASH_KEY key;
 
-	if (ibprof_obj) {
+	if ((module >= 0) && (module < IBPROF_MODULE_USER) &&
+		(call >= 0) && (call <= HASH_MAX_CALL)) {
+		ibprof_update_call_ex(module, call, ibprof_clock_from_sec(tm), ctx);
+	} else if (ibprof_obj && (thread_obj = ibprof_thread_get())) {
 		key = HASH_KEY_SET(module, call, ibprof_obj->task_obj->procid, 0);
 
-		entry = ibprof_hash_find(ibprof_obj->hash_obj, key);
+		entry = ibprof_hash_find(thread_obj->hash_obj, key);
 		if (entry)
-			ibprof_hash_update_ex(ibprof_obj->hash_obj, entry, tm, ctx);
+			ibprof_hash_update_ex(thread_obj->hash_obj, entry,
+					ibprof_clock_from_sec(tm), ctx);
 	}
 }
 
 
 void ibprof_interval_start(int callid, const char* name)
 {
-	IBPROF_HASH_OBJ *entry = NULL;
-	HASH_KEY key;
-
-	if (ibprof_obj && (callid <= HASH_MAX_CALL)) {
-		key = HASH_KEY_SET(IBPROF_MODULE_USER, callid, ibprof_obj->task_obj->procid, 0);
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
 
-		entry = ibprof_hash_find(ibprof_obj->hash_obj, key);
-		if (entry && (entry->t_start < 0)){
-			if (!entry->call_name[0])
-				strncpy(entry->call_name, name, sizeof(entry->call_name) - 1);
-			entry->t_start = ibprof_timestamp();
-		}
+	if (ibprof_obj && (callid >= 0) && (callid <= HASH_MAX_CALL) &&
+		(thread_obj = ibprof_thread_get())) {
+		ibprof_interval_push(&thread_obj->interval_stack, thread_obj->hash_obj,
+				callid, ibprof_obj->task_obj->procid, name);
 	}
 }
 
 void ibprof_interval_end(int callid)
 {
-	IBPROF_HASH_OBJ *entry = NULL;
-	HASH_KEY key;
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
 
-	if (ibprof_obj && (callid <= HASH_MAX_CALL)) {
-		key = HASH_KEY_SET(IBPROF_MODULE_USER, callid, ibprof_obj->task_obj->procid, 0);
+	if (ibprof_obj && (callid >= 0) && (callid <= HASH_MAX_CALL) &&
+		(thread_obj = ibprof_thread_get())) {
+		ibprof_interval_pop(&thread_obj->interval_stack, thread_obj->hash_obj,
+				callid, ibprof_obj->task_obj->procid);
+	}
+}
 
-		entry = ibprof_hash_find(ibprof_obj->hash_obj, key);
-		if (entry && (entry->t_start >= 0)){
-			ibprof_hash_update(ibprof_obj->hash_obj, entry,
-						ibprof_timestamp_diff(entry->t_start));
-			entry->t_start = UNDEFINED_VALUE;
-		}
+int ibprof_interval_register(const char* name)
+{
+	return ibprof_interval_register_name(name);
+}
+
+void ibprof_interval_enter(int handle)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	if (ibprof_obj && (handle > HASH_MAX_CALL) && (thread_obj = ibprof_thread_get())) {
+		ibprof_interval_push(&thread_obj->interval_stack, thread_obj->hash_obj,
+				handle, ibprof_obj->task_obj->procid, NULL);
+	}
+}
+
+void ibprof_interval_leave(int handle)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	if (ibprof_obj && (handle > HASH_MAX_CALL) && (thread_obj = ibprof_thread_get())) {
+		ibprof_interval_pop(&thread_obj->interval_stack, thread_obj->hash_obj,
+				handle, ibprof_obj->task_obj->procid);
 	}
 }
 
 void ibprof_dump(void)
 {
-	if (ibprof_obj && ibprof_hash_count(ibprof_obj->hash_obj)) {
-		format_dump(ibprof_dump_file, ibprof_obj);
-		/* Cleanup hash after dump */
+	IBPROF_OBJECT dump_obj;
+	IBPROF_TASK_OBJECT task_obj;
+
+	if (ibprof_obj) {
+		sys_memset(&dump_obj, 0, sizeof(dump_obj));
+		dump_obj.hash_obj = ibprof_hash_create(HASH_MAX_SIZE);
+		if (!dump_obj.hash_obj) {
+			IBPROF_ERROR("%s : error=%d - Can't create hash object\n",
+					__FUNCTION__, IBPROF_ERR_NO_MEMORY);
+			return;
+		}
+
 		ENTER_CRITICAL(&(ibprof_obj->lock));
-		ibprof_hash_destroy(ibprof_obj->hash_obj);
-		ibprof_obj->hash_obj = ibprof_hash_create();
+
+		/* Statistics of all threads collected in current generation are
+		 * copied under the lock and formatted out of it
+		 */
+		ibprof_thread_gather(dump_obj.hash_obj, ibprof_obj->thread_list,
+				ibprof_obj->generation);
+		dump_obj.thread_list = ibprof_thread_copy(ibprof_obj->thread_list,
+				ibprof_obj->generation);
+		dump_obj.module_array = ibprof_obj->module_array;
+		dump_obj.generation = ibprof_obj->generation;
+		task_obj = *ibprof_obj->task_obj;
+		dump_obj.task_obj = &task_obj;
+
+		/* Cleanup statistics after dump: threads drop own tables on next update */
+		__atomic_store_n(&ibprof_obj->generation, ibprof_obj->generation + 1, __ATOMIC_RELEASE);
+
 		LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+		/* Timeline is taken from trace file even if no statistics are collected */
+		if (ibprof_hash_count(dump_obj.hash_obj) ||
+			(format_dump == ibprof_io_chrome_dump)) {
+			flockfile(ibprof_dump_file);
+			format_dump(ibprof_dump_file, &dump_obj);
+			funlockfile(ibprof_dump_file);
+		}
+
+		ibprof_thread_copy_destroy(dump_obj.thread_list);
+		ibprof_hash_destroy(dump_obj.hash_obj);
 	}
 }
 
@@ -186,66 +223,44 @@ static IBPROF_ERROR __get_env(void)
 			setvbuf(ibprof_dump_file, NULL, _IOLBF, 1024);
 	}
 
+	ibprof_clock_init(ibprof_conf_get_string(IBPROF_CLOCK));
+
+	ibprof_hash_init(ibprof_conf_get_int(IBPROF_WARMUP_NUMBER));
+
+	ibprof_hist_init(ibprof_conf_get_int(IBPROF_HIST_BITS));
+
+	ibprof_resource_init(ibprof_conf_get_int(IBPROF_RESOURCE_TOP));
+
+	ibprof_thread_init(ibprof_conf_get_int(IBPROF_THREAD_TOP));
+
+	ibprof_interval_init(ibprof_conf_get_int(IBPROF_INTERVAL_CALLS));
+
+	ibprof_counter_init(ibprof_conf_get_int(IBPROF_CALL_COUNTERS));
+
 	format_dump = ibprof_io_plain_dump;
 
 	env = ibprof_conf_get_string(IBPROF_FORMAT);
 	if (env) {
 		if (sys_strcasecmp(env, "xml") == 0)
 			format_dump = ibprof_io_xml_dump;
+		else if (sys_strcasecmp(env, "chrome") == 0)
+			format_dump = ibprof_io_chrome_dump;
+		else if (sys_strcasecmp(env, "binary") == 0)
+			format_dump = ibprof_io_binary_dump;
 	}
 
-	return status;
-}
-
-#if defined(CONF_TIMESTAMP) && (CONF_TIMESTAMP == 1)
-static double __get_cpu_clocks_per_sec(void)
-{
-	static double clocks_per_sec = 0.0;
-	static int initialized = 0;
-
-	if (!initialized) {
-	        double mhz = 0.0;
-#if defined(__LINUX__)
-		FILE* f;
-		char buf[256];
-
-		f = fopen("/proc/cpuinfo", "r");
-		if (!f) {
-			return 0.0;
-		}
-
-		while (fgets(buf, sizeof(buf), f)) {
-			double m;
-			int rc;
-
-#if defined(__ia64__)
-			rc = sscanf(buf, "itc MHz : %lf", &m);
-#elif defined(__powerpc__)
-			rc = sscanf(buf, "clock : %lf", &m);
-#else
-			rc = sscanf(buf, "cpu MHz : %lf", &m);
-#endif
-			if (rc != 1) {
-				continue;
-			}
-			if (mhz == 0.0) {
-				mhz = m;
-				continue;
-			}
-			if (mhz != m) {
-				double mm = sys_max(mhz, m);
-				mhz = mm;
-			}
-		}
-		fclose(f);
-#endif
-	        clocks_per_sec = mhz * 1.0e6;
-	        initialized = 1;
+	/* Records are not written to terminal or job log */
+	if ((format_dump == ibprof_io_binary_dump) &&
+		((ibprof_dump_file == stdout) || (ibprof_dump_file == stderr) ||
+		isatty(fileno(ibprof_dump_file)))) {
+		IBPROF_WARN("%s : error=%d - Binary format requires IBPROF_DUMP_FILE, plain is used\n",
+				__FUNCTION__, IBPROF_ERR_UNSUPPORTED);
+		format_dump = ibprof_io_plain_dump;
 	}
 
-	return clocks_per_sec;
+	return status;
 }
-#endif /* CONF_TIMESTAMP */
+
 
 /****************************************************************************
  * Load/unload open/exit
@@ -308,9 +323,24 @@ void __attribute__((constructor)) __ibprof_init(void)
 			}
 		}
 
+		/* set sampled calls and injection policies (names are known after modules are initialized) */
+		if (status == IBPROF_ERR_NONE) {
+			ibprof_sample_init(ibprof_conf_get_string(IBPROF_SAMPLE),
+					temp_ibprof_obj->module_array);
+			ibprof_fault_init(ibprof_conf_get_string(IBPROF_ERR_POLICY),
+					ibprof_conf_get_int(IBPROF_ERR_PERCENT),
+					ibprof_conf_get_int(IBPROF_ERR_SEED),
+					temp_ibprof_obj->module_array);
+			ibprof_delay_init(ibprof_conf_get_string(IBPROF_DELAY),
+					temp_ibprof_obj->module_array);
+		}
+
 		/* initialize hash object */
 		if (status == IBPROF_ERR_NONE) {
-			temp_ibprof_obj->hash_obj = ibprof_hash_create();
+			temp_ibprof_obj->hash_obj = ibprof_hash_create(HASH_MAX_SIZE);
+			temp_ibprof_obj->thread_list = NULL;
+			temp_ibprof_obj->generation = 0;
+			temp_ibprof_obj->snapshot = 0;
 			if (!temp_ibprof_obj->hash_obj) {
 				status = IBPROF_ERR_INCORRECT;
 		                IBPROF_FATAL("%s : error=%d - Can't create hash object\n",
@@ -336,6 +366,16 @@ void __attribute__((constructor)) __ibprof_init(void)
 			ibprof_obj = temp_ibprof_obj;
 
 			LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+			ibprof_clock_calibrate(ibprof_conf_get_int(IBPROF_OVERHEAD_SUBTRACT));
+
+			ibprof_trace_init();
+
+			ibprof_snapshot_init();
+
+			ibprof_live_init();
+
+			ibprof_node_init();
 		}
 
 		if (status != IBPROF_ERR_NONE) {
@@ -375,6 +415,7 @@ void __attribute__((constructor)) __ibprof_init(void)
 void __attribute__((destructor)) __ibprof_exit(void)
 {
 	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	int node_leader = 1;
 	UNREFERENCED_PARAMETER(status);
 
 	/* check if it has been activated */
@@ -382,11 +423,18 @@ void __attribute__((destructor)) __ibprof_exit(void)
 		IBPROF_MODULE_OBJECT *temp_module_obj = NULL;
 		int i = 0;
 
+		ibprof_live_exit();
+
+		ibprof_snapshot_exit();
+
+		ibprof_trace_exit();
+
 		ibprof_obj->task_obj->wall_time =
 			ibprof_task_wall_time(ibprof_obj->task_obj->t_start);
 
-		/* Dump all gathered information */
-		ibprof_dump();
+		/* Dump all gathered information (per node or per process) */
+		if (ibprof_node_dump(&node_leader) != IBPROF_ERR_NONE)
+			ibprof_dump();
 
 		temp_module_obj = ibprof_obj->module_array[0];
 		while (temp_module_obj) {
@@ -399,6 +447,17 @@ void __attribute__((destructor)) __ibprof_exit(void)
 
 		ibprof_hash_destroy(ibprof_obj->hash_obj);
 
+		ibprof_thread_exit();
+
+		while (ibprof_obj->thread_list) {
+			IBPROF_THREAD_OBJECT *thread_obj = ibprof_obj->thread_list;
+
+			ibprof_obj->thread_list = thread_obj->next;
+			ibprof_thread_destroy(thread_obj);
+		}
+
+		ibprof_interval_destroy();
+
 		ibprof_task_destroy(ibprof_obj->task_obj);
 
 		DELETE_CRITICAL(&(ibprof_obj->lock));
@@ -423,8 +482,11 @@ void __attribute__((destructor)) __ibprof_exit(void)
 		if (ret > 0) {
 			sys_fflush(ibprof_dump_file);
 			sys_fclose(ibprof_dump_file);
+			/* Shared file can be still empty while node leader has not written it,
+			 * own files of other ranks are removed by the leader
+			 */
 			if (!sys_fstat(filename, &statbuf))
-				if (!statbuf.st_size)
+				if (!statbuf.st_size && node_leader)
 					  ret = sys_fremove(filename);
 		}
 	        sys_free(filename);
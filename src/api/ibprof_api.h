@@ -102,6 +102,47 @@ void ibprof_interval_start(int callid, const char* name);
  ***************************************************************************/
 void ibprof_interval_end(int callid);
 
+/**
+ * ibprof_interval_register
+ *
+ * @brief
+ *    This function returns handle of named interval to be used
+ *    with ibprof_interval_enter() and ibprof_interval_leave().
+ *    The same name always gets the same handle.
+ *
+ * @param[in]    name           String name associated with measurement.
+ *
+ * @retval (handle) - on success
+ * @retval (-1) - on failure
+ ***************************************************************************/
+int ibprof_interval_register(const char* name);
+
+/**
+ * ibprof_interval_enter
+ *
+ * @brief
+ *    This function labels starting point of measurement of registered
+ *    interval. Intervals can be nested and entered by several threads.
+ *
+ * @param[in]    handle         Handle of interval.
+ *
+ * @retval none
+ ***************************************************************************/
+void ibprof_interval_enter(int handle);
+
+/**
+ * ibprof_interval_leave
+ *
+ * @brief
+ *    This function labels finishing of measurement of registered interval.
+ *    Nested intervals that were not left are finished too.
+ *
+ * @param[in]    handle         Handle of interval.
+ *
+ * @retval none
+ ***************************************************************************/
+void ibprof_interval_leave(int handle);
+
 /**
  * ibprof_dump
  *
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * ibprof-bench: drives hot library calls in a loop from several threads and
+ * reports time per call. It is linked against stub libraries (see stub_*.c)
+ * whose calls return immediately, so run with LD_PRELOAD=libibprof.so shows
+ * cost of wrappers. ibprof_bench.sh compares it with run without libibprof.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <infiniband/verbs.h>
+
+/* Calls of stub libraries are declared here, headers of SHMEM and MXM
+ * are not required to build benchmark
+ */
+void shmem_putmem(void *target, const void *source, size_t len, int pe);
+int mxm_progress(void *context);
+
+typedef enum {
+	BENCH_POST_SEND = 0,
+	BENCH_POLL_CQ,
+	BENCH_SHMEM_PUTMEM,
+	BENCH_MXM_PROGRESS,
+	BENCH_LAST
+} BENCH_CALL;
+
+static const char *bench_name[BENCH_LAST] = {
+	"ibv_post_send",
+	"ibv_poll_cq",
+	"shmem_putmem",
+	"mxm_progress"
+};
+
+typedef struct {
+	pthread_t thread;
+	BENCH_CALL call;
+	struct ibv_qp *qp;
+	struct ibv_cq *cq;
+	double nsec; /* CPU time spent in the loop */
+	long failed; /* calls that returned an error */
+	uint64_t fail_hash; /* hash of failed invocation numbers */
+} BENCH_THREAD;
+
+static struct {
+	int threads;
+	long iterations;
+	int failures;
+	pthread_barrier_t barrier;
+} bench_opt = { 1, 1000000, 0 };
+
+static void __usage(const char *prog)
+{
+	int i = 0;
+
+	fprintf(stderr,
+		"Usage: %s [options] [call ...]\n"
+		"  -t <count>  number of threads (default 1)\n"
+		"  -n <count>  calls per thread (default 1000000)\n"
+		"  -f          report failed calls and hash of their numbers\n"
+		"  -h          show this help\n"
+		"Calls:",
+		prog);
+	for (i = 0; i < BENCH_LAST; i++)
+		fprintf(stderr, " %s", bench_name[i]);
+	fprintf(stderr, " (default all)\n");
+}
+
+/* CPU time of the calling thread, so result does not depend on
+ * number of threads per core
+ */
+static double __nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (double)ts.tv_sec * 1.0e+9 + (double)ts.tv_nsec;
+}
+
+/* Errors are injected by libibprof, so a run with the same seed
+ * should fail the same invocations
+ */
+static void __bench_fail(BENCH_THREAD *bench, long i)
+{
+	bench->failed++;
+	bench->fail_hash = (bench->fail_hash ^ (uint64_t)i) * 0x100000001b3ULL;
+}
+
+static void *__bench_thread(void *arg)
+{
+	BENCH_THREAD *bench = (BENCH_THREAD *)arg;
+	struct ibv_sge sge;
+	struct ibv_send_wr wr;
+	struct ibv_send_wr *bad_wr = NULL;
+	struct ibv_wc wc[16];
+	char buf[64];
+	double t_start = 0.0;
+	long i = 0;
+
+	memset(&sge, 0, sizeof(sge));
+	memset(&wr, 0, sizeof(wr));
+	sge.addr = (uintptr_t)buf;
+	sge.length = sizeof(buf);
+	wr.sg_list = &sge;
+	wr.num_sge = 1;
+	wr.opcode = IBV_WR_SEND;
+	wr.send_flags = IBV_SEND_SIGNALED;
+
+	pthread_barrier_wait(&bench_opt.barrier);
+
+	t_start = __nsec();
+	switch (bench->call) {
+	case BENCH_POST_SEND:
+		for (i = 0; i < bench_opt.iterations; i++)
+			if (ibv_post_send(bench->qp, &wr, &bad_wr))
+				__bench_fail(bench, i);
+		break;
+	case BENCH_POLL_CQ:
+		/* Stub CQ is always empty, anything else is injected */
+		for (i = 0; i < bench_opt.iterations; i++)
+			if (ibv_poll_cq(bench->cq, 16, wc))
+				__bench_fail(bench, i);
+		break;
+	case BENCH_SHMEM_PUTMEM:
+		for (i = 0; i < bench_opt.iterations; i++)
+			shmem_putmem(buf, buf, sizeof(buf), 0);
+		break;
+	case BENCH_MXM_PROGRESS:
+		for (i = 0; i < bench_opt.iterations; i++)
+			mxm_progress(NULL);
+		break;
+	default:
+		break;
+	}
+	bench->nsec = __nsec() - t_start;
+
+	return NULL;
+}
+
+static int __bench_run(struct ibv_context *context, struct ibv_pd *pd, BENCH_CALL call)
+{
+	BENCH_THREAD *bench = NULL;
+	struct ibv_qp_init_attr qp_attr;
+	double nsec = 0.0;
+	long failed = 0;
+	uint64_t fail_hash = 0;
+	int i = 0;
+
+	bench = (BENCH_THREAD *)calloc(bench_opt.threads, sizeof(*bench));
+	if (!bench)
+		return -1;
+
+	memset(&qp_attr, 0, sizeof(qp_attr));
+	for (i = 0; i < bench_opt.threads; i++) {
+		bench[i].call = call;
+		bench[i].cq = ibv_create_cq(context, 64, NULL, NULL, 0);
+		qp_attr.send_cq = bench[i].cq;
+		qp_attr.recv_cq = bench[i].cq;
+		bench[i].qp = ibv_create_qp(pd, &qp_attr);
+		if (!bench[i].cq || !bench[i].qp) {
+			fprintf(stderr, "Can't create verbs objects\n");
+			free(bench);
+			return -1;
+		}
+	}
+
+	pthread_barrier_init(&bench_opt.barrier, NULL, bench_opt.threads);
+	for (i = 0; i < bench_opt.threads; i++)
+		pthread_create(&bench[i].thread, NULL, __bench_thread, &bench[i]);
+	for (i = 0; i < bench_opt.threads; i++) {
+		pthread_join(bench[i].thread, NULL);
+		nsec += bench[i].nsec;
+		failed += bench[i].failed;
+		/* Threads are combined regardless of their order */
+		fail_hash ^= bench[i].fail_hash;
+	}
+	pthread_barrier_destroy(&bench_opt.barrier);
+
+	/* Average time of a call in a thread */
+	printf("%-16s %10.2f", bench_name[call],
+		nsec / ((double)bench_opt.threads * bench_opt.iterations));
+	if (bench_opt.failures)
+		printf(" %10ld %016llx", failed, (unsigned long long)fail_hash);
+	printf("\n");
+	fflush(stdout);
+
+	for (i = 0; i < bench_opt.threads; i++) {
+		ibv_destroy_qp(bench[i].qp);
+		ibv_destroy_cq(bench[i].cq);
+	}
+	free(bench);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct ibv_device **device_list = NULL;
+	struct ibv_context *context = NULL;
+	struct ibv_pd *pd = NULL;
+	int run[BENCH_LAST];
+	int opt = 0;
+	int i = 0;
+	int j = 0;
+
+	while ((opt = getopt(argc, argv, "t:n:fh")) != -1) {
+		switch (opt) {
+		case 't':
+			bench_opt.threads = atoi(optarg);
+			break;
+		case 'n':
+			bench_opt.iterations = atol(optarg);
+			break;
+		case 'f':
+			bench_opt.failures = 1;
+			break;
+		default:
+			__usage(argv[0]);
+			return (opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+	if ((bench_opt.threads <= 0) || (bench_opt.iterations <= 0)) {
+		__usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (j = 0; j < BENCH_LAST; j++)
+		run[j] = (optind >= argc);
+	for (i = optind; i < argc; i++) {
+		for (j = 0; (j < BENCH_LAST) && strcmp(argv[i], bench_name[j]); j++)
+			;
+		if (j == BENCH_LAST) {
+			__usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		run[j] = 1;
+	}
+
+	device_list = ibv_get_device_list(NULL);
+	if (!device_list || !device_list[0]) {
+		fprintf(stderr, "No verbs device\n");
+		return EXIT_FAILURE;
+	}
+	context = ibv_open_device(device_list[0]);
+	pd = (context ? ibv_alloc_pd(context) : NULL);
+	if (!pd) {
+		fprintf(stderr, "Can't open verbs device\n");
+		return EXIT_FAILURE;
+	}
+
+	for (j = 0; j < BENCH_LAST; j++) {
+		if (run[j] && __bench_run(context, pd, (BENCH_CALL)j))
+			return EXIT_FAILURE;
+	}
+
+	ibv_dealloc_pd(pd);
+	ibv_close_device(context);
+	ibv_free_device_list(device_list);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+#                         All rights reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+# Run ibprof-bench without libibprof and with libibprof in every mode
+# for several thread counts and report overhead of wrappers per call.
+#
+# Usage: ibprof_bench.sh <libibprof.so> <ibprof-bench>
+#
+# Environment:
+#   BENCH_ITERATIONS  calls per thread (default 1000000)
+#   BENCH_THREADS     list of thread counts (default "1 2 4")
+#   BENCH_MODES       list of IBPROF modes (default "0 1 2 3 4")
+#   BENCH_CALLS       list of calls (default all)
+#
+
+lib=$1
+bench=$2
+
+if [ ! -f "$lib" ] || [ ! -x "$bench" ]; then
+	echo "Usage: $0 <libibprof.so> <ibprof-bench>" >&2
+	exit 1
+fi
+
+iterations=${BENCH_ITERATIONS:-1000000}
+threads=${BENCH_THREADS:-"1 2 4"}
+modes=${BENCH_MODES:-"0 1 2 3 4"}
+calls=${BENCH_CALLS:-}
+tmpdir=`mktemp -d ${TMPDIR:-/tmp}/ibprof_bench.XXXXXX` || exit 1
+trap 'rm -rf "$tmpdir"' 0
+
+mode_name() {
+	case $1 in
+	0) echo "none" ;;
+	1) echo "prof" ;;
+	2) echo "err" ;;
+	3) echo "verbose" ;;
+	4) echo "trace" ;;
+	5) echo "delay" ;;
+	*) echo "mode$1" ;;
+	esac
+}
+
+# Calls of modules that are not built in libibprof go to stub directly
+env LD_PRELOAD=$lib IBPROF_MODE="USE_IBV=1,USE_SHMEM=1,USE_MXM=1" \
+	$bench -n 1000 $calls > $tmpdir/base 2> $tmpdir/dump || exit 1
+missing=`awk 'FILENAME == ARGV[1] { dump[$1] = 1; next } !($1 in dump) { printf " %s", $1 }' $tmpdir/dump $tmpdir/base`
+if [ -n "$missing" ]; then
+	echo "Calls are not intercepted by $lib:$missing"
+fi
+
+printf "%-8s %-8s %-16s %12s %12s\n" "mode" "threads" "call" "ns/call" "overhead"
+for t in $threads; do
+	$bench -t $t -n $iterations $calls > $tmpdir/base || exit 1
+	awk -v t=$t '{ printf "%-8s %-8s %-16s %12.2f %12s\n", "-", t, $1, $2, "-" }' $tmpdir/base
+	for m in $modes; do
+		# Errors are not injected, so error injection mode shows cost of its wrappers
+		env LD_PRELOAD=$lib \
+			IBPROF_MODE="USE_IBV=$m,USE_SHMEM=$m,USE_MXM=$m" \
+			IBPROF_ERR_PERCENT=0 \
+			IBPROF_TRACE_FILE=$tmpdir/bench.trace \
+			$bench -t $t -n $iterations $calls > $tmpdir/run 2> /dev/null || exit 1
+		awk -v t=$t -v m=`mode_name $m` 'NR == FNR { base[$1] = $2; next }
+			{ printf "%-8s %-8s %-16s %12.2f %12.2f\n", m, t, $1, $2, $2 - base[$1] }' \
+			$tmpdir/base $tmpdir/run
+	done
+done
@@ -0,0 +1,104 @@
+#!/bin/sh
+#
+# Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+#                         All rights reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+# Run ibprof-bench against stub libraries with libibprof and check
+# call counts, message size classes and that injected errors are
+# reproduced by a run with the same seed (make check).
+#
+# Usage: ibprof_check.sh <libibprof.so> <ibprof-bench>
+# (make check passes them in IBPROF_CHECK_LIB and IBPROF_CHECK_BENCH)
+#
+# Exit status 77 means the test is skipped.
+#
+
+lib=${1:-$IBPROF_CHECK_LIB}
+bench=${2:-$IBPROF_CHECK_BENCH}
+
+if [ ! -f "$lib" ] || [ ! -x "$bench" ]; then
+	echo "Usage: $0 <libibprof.so> <ibprof-bench>" >&2
+	exit 1
+fi
+
+iterations=1000
+threads=2
+calls="ibv_post_send ibv_poll_cq"
+policy="post_send:ppm=100000,poll_cq:nth=7"
+tmpdir=`mktemp -d ${TMPDIR:-/tmp}/ibprof_check.XXXXXX` || exit 1
+trap 'rm -rf "$tmpdir"' 0
+
+fail() {
+	echo "FAIL: $*"
+	exit 1
+}
+
+# Value of a column in the first row of a call in plain dump
+call_column() {
+	awk -v name="$1" -v col="$2" '$1 == name && $2 == ":" && NF > 2 { print $col; exit }' "$3"
+}
+
+# Count of a message size class of a call in plain dump
+size_count() {
+	awk -v name="$1" -v size="$2" '/^message size/ { s = 1; next }
+		s && ($1 == name) { c = 1; next }
+		c && ($1 == size) { print $3; exit }
+		c && ($2 == ":") && ($3 == "") { exit }' "$3"
+}
+
+run_err() {
+	env LD_PRELOAD=$lib IBPROF_MODE="USE_IBV=2" \
+		IBPROF_ERR_PERCENT=0 IBPROF_ERR_SEED=$1 IBPROF_ERR_POLICY=$policy \
+		IBPROF_DUMP_FILE=$tmpdir/$2.log \
+		$bench -f -t $threads -n $iterations $calls > $tmpdir/$2 || fail "ibprof-bench failed in mode 2"
+}
+
+expected=`expr $threads \* $iterations`
+
+env LD_PRELOAD=$lib IBPROF_MODE="USE_IBV=1" IBPROF_DUMP_FILE=$tmpdir/prof.log \
+	$bench -t $threads -n $iterations $calls > /dev/null || fail "ibprof-bench failed in mode 1"
+
+# Verbs module is not built if installed libibverbs is not supported
+if [ ! -f $tmpdir/prof.log ] || [ -z "`call_column ibv_post_send 3 $tmpdir/prof.log`" ]; then
+	echo "SKIP: calls are not intercepted by $lib"
+	exit 77
+fi
+
+for call in $calls; do
+	count=`call_column $call 3 $tmpdir/prof.log`
+	[ "$count" = "$expected" ] || fail "$call count is '$count', expected $expected"
+done
+echo "PASS: call counts"
+
+# Every work request of ibprof-bench has 64 bytes
+count=`size_count ibv_post_send 64..128 $tmpdir/prof.log`
+[ "$count" = "$expected" ] || fail "ibv_post_send 64..128 bytes count is '$count', expected $expected"
+echo "PASS: message size classes"
+
+run_err 5 first
+run_err 5 second
+run_err 6 other
+
+failed=`awk '$1 == "ibv_post_send" { print $3 }' $tmpdir/first`
+[ -n "$failed" ] && [ "$failed" -gt 0 ] || fail "no ibv_post_send failures are injected"
+failed=`awk '$1 == "ibv_poll_cq" { print $3 }' $tmpdir/first`
+[ "$failed" = "$threads" ] || fail "ibv_poll_cq failures are '$failed', expected $threads (nth=7)"
+for call in $calls; do
+	count=`call_column $call 8 $tmpdir/first.log`
+	failed=`awk -v name=$call '$1 == name { print $3 }' $tmpdir/first`
+	[ "$count" = "$failed" ] || fail "$call failures in dump are '$count', returned $failed"
+done
+
+awk '{ print $1, $3, $4 }' $tmpdir/first > $tmpdir/first.fail
+awk '{ print $1, $3, $4 }' $tmpdir/second > $tmpdir/second.fail
+awk '{ print $1, $3, $4 }' $tmpdir/other > $tmpdir/other.fail
+cmp -s $tmpdir/first.fail $tmpdir/second.fail || fail "failures differ in runs with the same seed"
+cmp -s $tmpdir/first.fail $tmpdir/other.fail && fail "failures are the same in runs with different seeds"
+echo "PASS: injected errors"
+
+exit 0
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Stub libmxm for ibprof-bench: calls return MXM_OK (0) immediately.
+ * Other symbols resolved by libibprof are generated with trivial bodies
+ * (stub_syms.sh).
+ */
+
+#pragma GCC visibility push(default)
+
+int mxm_progress(void *context)
+{
+	return 0;
+}
+
+#pragma GCC visibility pop
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Stub liboshmem for ibprof-bench: single PE, calls return immediately.
+ * Other symbols resolved by libibprof are generated with trivial bodies
+ * (stub_syms.sh).
+ */
+
+#include <stddef.h>
+
+#pragma GCC visibility push(default)
+
+void shmem_init(void)
+{
+}
+
+void shmem_finalize(void)
+{
+}
+
+int shmem_n_pes(void)
+{
+	return 1;
+}
+
+int shmem_my_pe(void)
+{
+	return 0;
+}
+
+void shmem_putmem(void *target, const void *source, size_t len, int pe)
+{
+}
+
+#pragma GCC visibility pop
@@ -0,0 +1,27 @@
+#!/bin/sh
+#
+# Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+#                         All rights reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+# Generate trivial bodies of all symbols that libibprof module resolves
+# with check_dlsym(), so stub library of ibprof-bench is accepted by the
+# module. Symbols are weak, stub source overrides the ones it needs.
+#
+# Usage: stub_syms.sh <prefix> <module source>
+#
+
+prefix=$1
+source=$2
+
+echo "/* Generated by stub_syms.sh from `basename $source`, do not edit */"
+echo "#pragma GCC visibility push(default)"
+sed -n "s/^[[:space:]]*check_dlsymv\{0,1\}(\(${prefix}[A-Za-z0-9_]*\).*/\1/p" $source | sort -u |
+while read sym; do
+	echo "int __attribute__((weak)) $sym() { return 0; }"
+done
+echo "#pragma GCC visibility pop"
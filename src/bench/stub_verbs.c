@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Stub libibverbs for ibprof-bench: one device, objects are allocated
+ * in memory and data path calls return immediately. Other symbols
+ * resolved by libibprof are generated with trivial bodies (stub_syms.sh).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <infiniband/verbs.h>
+
+#pragma GCC visibility push(default)
+
+static struct ibv_device stub_device;
+static struct ibv_device *stub_device_list[] = { &stub_device, NULL };
+
+static int __post_send(struct ibv_qp *qp, struct ibv_send_wr *wr,
+		struct ibv_send_wr **bad_wr)
+{
+	return 0;
+}
+
+static int __post_recv(struct ibv_qp *qp, struct ibv_recv_wr *wr,
+		struct ibv_recv_wr **bad_wr)
+{
+	return 0;
+}
+
+static int __poll_cq(struct ibv_cq *cq, int num_entries, struct ibv_wc *wc)
+{
+	return 0;
+}
+
+#if defined(ibv_get_device_list)
+#undef ibv_get_device_list
+struct ibv_device **__ibv_get_device_list(int *num_devices)
+{
+	return ibv_get_device_list(num_devices);
+}
+#endif
+
+struct ibv_device **ibv_get_device_list(int *num_devices)
+{
+	if (num_devices)
+		*num_devices = 1;
+
+	return stub_device_list;
+}
+
+void ibv_free_device_list(struct ibv_device **list)
+{
+}
+
+struct ibv_context *ibv_open_device(struct ibv_device *device)
+{
+	struct ibv_context *context = NULL;
+
+	context = (struct ibv_context *)calloc(1, sizeof(*context));
+	if (context) {
+		context->device = device;
+		context->ops.post_send = __post_send;
+		context->ops.post_recv = __post_recv;
+		context->ops.poll_cq = __poll_cq;
+	}
+
+	return context;
+}
+
+int ibv_close_device(struct ibv_context *context)
+{
+	free(context);
+
+	return 0;
+}
+
+struct ibv_pd *ibv_alloc_pd(struct ibv_context *context)
+{
+	struct ibv_pd *pd = NULL;
+
+	pd = (struct ibv_pd *)calloc(1, sizeof(*pd));
+	if (pd)
+		pd->context = context;
+
+	return pd;
+}
+
+int ibv_dealloc_pd(struct ibv_pd *pd)
+{
+	free(pd);
+
+	return 0;
+}
+
+struct ibv_cq *ibv_create_cq(struct ibv_context *context, int cqe,
+		void *cq_context, struct ibv_comp_channel *channel, int comp_vector)
+{
+	struct ibv_cq *cq = NULL;
+
+	cq = (struct ibv_cq *)calloc(1, sizeof(*cq));
+	if (cq) {
+		cq->context = context;
+		cq->cq_context = cq_context;
+		cq->cqe = cqe;
+	}
+
+	return cq;
+}
+
+int ibv_destroy_cq(struct ibv_cq *cq)
+{
+	free(cq);
+
+	return 0;
+}
+
+struct ibv_qp *ibv_create_qp(struct ibv_pd *pd, struct ibv_qp_init_attr *qp_init_attr)
+{
+	static uint32_t qp_num = 0;
+	struct ibv_qp *qp = NULL;
+
+	qp = (struct ibv_qp *)calloc(1, sizeof(*qp));
+	if (qp) {
+		qp->context = pd->context;
+		qp->pd = pd;
+		qp->send_cq = qp_init_attr->send_cq;
+		qp->recv_cq = qp_init_attr->recv_cq;
+		qp->qp_num = __sync_add_and_fetch(&qp_num, 1);
+	}
+
+	return qp;
+}
+
+int ibv_destroy_qp(struct ibv_qp *qp)
+{
+	free(qp);
+
+	return 0;
+}
+
+#pragma GCC visibility pop
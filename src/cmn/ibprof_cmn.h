@@ -143,7 +143,8 @@ enum {
 	IBPROF_MODE_PROF,
 	IBPROF_MODE_ERR,
 	IBPROF_MODE_VERBOSE,
-	IBPROF_MODE_TRACE
+	IBPROF_MODE_TRACE,
+	IBPROF_MODE_DELAY
 };
 
 enum {
@@ -236,16 +237,20 @@ static long const ibprof_time_units_multiplier_val[] = {
 /** @{*/
 #define sys_memcpy      memcpy
 #define sys_memset      memset
+#define sys_memcmp      memcmp
 #define sys_strlen      strlen
 #define sys_strcpy      strcpy
 #define sys_strncpy     strncpy
 #define sys_strcmp      strcmp
+#define sys_strncmp     strncmp
 #define sys_strcasecmp  strcasecmp
 #define sys_strstr      strstr
 #define sys_strchr      strchr
+#define sys_strrchr     strrchr
 #define sys_sprintf     sprintf
 #define sys_vsnprintf   vsnprintf
 #define sys_strtol      strtol
+#define sys_strtoull    strtoull
 
 /* Minimum and maximum macros */
 #define sys_max(a, b)  (((a) > (b)) ? (a) : (b))
@@ -576,6 +581,19 @@ static INLINE int sys_jobid()
 	return sys_strtol((str ? str : "-1"), NULL, 10);
 }
 
+/* Launch of a job step: several launches can share job id */
+static INLINE const char *sys_launchid()
+{
+	char *str = NULL;
+
+	str = getenv("PMIX_NAMESPACE");			/* PMIx */
+	str = (str ? str : getenv("SLURM_STEP_ID"));	/* SLURM */
+	str = (str ? str : getenv("SLURM_STEPID"));
+	str = (str ? str : getenv("OMPI_MCA_ess_base_jobid"));	/* OpenMPI */
+
+	return str;
+}
+
 static INLINE int sys_procid()
 {
 	char *str = NULL;
@@ -588,6 +606,16 @@ static INLINE int sys_procid()
 	return ((str ? sys_strtol(str, NULL, 10) : getpid()) & 0xFFFF);
 }
 
+static INLINE int sys_localsize()
+{
+	char *str = NULL;
+
+	str = getenv("OMPI_COMM_WORLD_LOCAL_SIZE");	/* OpenMPI */
+	str = (str ? str : getenv("MPI_LOCALNRANKS"));	/* MPICH/Hydra */
+
+	return (str ? sys_strtol(str, NULL, 10) : 0);
+}
+
 static INLINE const char* sys_procname()
 {
 	const char *str = NULL;
@@ -26,6 +26,22 @@ int hmca_coll_ml_allreduce_dispatch(void *sbuf, void *rbuf, int count, dte_data_
 int hmca_coll_ml_allreduce(void *sbuf, void *rbuf, int count, dte_data_representation_t dtype, hcoll_dte_op_t *op, void *hcoll_context);
 int hmca_coll_ml_allgather(void *sbuf, int scount, dte_data_representation_t sdtype, void* rbuf, int rcount, dte_data_representation_t rdtype, void *hcoll_context);
 
+/*
+ * Amount of data described by count and predefined datatype.
+ * Size of in-line datatype is kept in bits 8..15 of its representation
+ * in bits, size of derived datatypes is not resolved.
+ */
+static inline int64_t hcol_dte_size(int count, dte_data_representation_t dtype)
+{
+#if defined(HCOL_DTE_IS_INLINE)
+	if (HCOL_DTE_IS_INLINE(dtype))
+		return (int64_t)count * (int64_t)((dtype.rep.in_line_rep >> 8) & 0xFF) / 8;
+#endif
+	PRETEND_USED(count);
+	PRETEND_USED(dtype);
+
+	return -1;
+}
 
 /* HCOL API */
 #define OP_ON_MEMBERS_LIST(OP) \
@@ -71,17 +87,17 @@ static struct module_context_t {
 		int TYPE ## hmca_coll_ml_barrier_intra(void *context) \
         { FUNC_BODY_INT(TYPE, hmca_coll_ml_barrier_intra, context) }; \
 		int TYPE ## hmca_coll_ml_bcast_sequential_root(void *buf, int count, dte_data_representation_t dtype, int root, void* hcoll_context) \
-        { FUNC_BODY_INT(TYPE, hmca_coll_ml_bcast_sequential_root, buf, count, dtype, root, hcoll_context) }; \
+        { FUNC_BODY_INT_SIZE(TYPE, hmca_coll_ml_bcast_sequential_root, hcol_dte_size(count, dtype), buf, count, dtype, root, hcoll_context) }; \
 		int TYPE ## hmca_coll_ml_parallel_bcast(void *buf, int count, dte_data_representation_t dtype, int root, void *hcoll_context) \
-        { FUNC_BODY_INT(TYPE, hmca_coll_ml_parallel_bcast, buf, count, dtype, root, hcoll_context) }; \
+        { FUNC_BODY_INT_SIZE(TYPE, hmca_coll_ml_parallel_bcast, hcol_dte_size(count, dtype), buf, count, dtype, root, hcoll_context) }; \
 		int TYPE ## hmca_coll_ml_alltoall(void *sbuf, int scount, dte_data_representation_t sdtype, void* rbuf, int rcount, dte_data_representation_t rdtype, void *hcoll_context) \
-        { FUNC_BODY_INT(TYPE, hmca_coll_ml_alltoall, sbuf, scount, sdtype, rbuf, rcount, rdtype, hcoll_context) }; \
+        { FUNC_BODY_INT_SIZE(TYPE, hmca_coll_ml_alltoall, hcol_dte_size(scount, sdtype), sbuf, scount, sdtype, rbuf, rcount, rdtype, hcoll_context) }; \
 		int TYPE ## hmca_coll_ml_allreduce_dispatch(void *sbuf, void *rbuf, int count, dte_data_representation_t dtype, hcoll_dte_op_t *op, void *hcoll_context) \
-        { FUNC_BODY_INT(TYPE, hmca_coll_ml_allreduce_dispatch, sbuf,rbuf, count, dtype, op, hcoll_context) }; \
+        { FUNC_BODY_INT_SIZE(TYPE, hmca_coll_ml_allreduce_dispatch, hcol_dte_size(count, dtype), sbuf,rbuf, count, dtype, op, hcoll_context) }; \
 		int TYPE ## hmca_coll_ml_allreduce(void *sbuf, void *rbuf, int count, dte_data_representation_t dtype, hcoll_dte_op_t *op, void *hcoll_context) \
-        { FUNC_BODY_INT(TYPE, hmca_coll_ml_allreduce, sbuf, rbuf, count, dtype, op, hcoll_context) }; \
+        { FUNC_BODY_INT_SIZE(TYPE, hmca_coll_ml_allreduce, hcol_dte_size(count, dtype), sbuf, rbuf, count, dtype, op, hcoll_context) }; \
 		int TYPE ## hmca_coll_ml_allgather(void *sbuf, int scount, dte_data_representation_t sdtype, void* rbuf, int rcount, dte_data_representation_t rdtype, void *hcoll_context) \
-        { FUNC_BODY_INT(TYPE, hmca_coll_ml_allgather, sbuf, scount, sdtype, rbuf, rcount, rdtype, hcoll_context) }; \
+        { FUNC_BODY_INT_SIZE(TYPE, hmca_coll_ml_allgather, hcol_dte_size(scount, sdtype), sbuf, scount, sdtype, rbuf, rcount, rdtype, hcoll_context) }; \
 
 
 /****************************************************************************
@@ -115,6 +131,9 @@ DECLARE_OPTION(TRACE)
 #define PREFIX_ERR(x) ERR##x,
 DECLARE_OPTION(ERR)
 
+#define PREFIX_DELAY(x) DELAY##x,
+DECLARE_OPTION(DELAY)
+
 /****************************************************************************
  * Module configuration place
  ***************************************************************************/
@@ -166,6 +185,10 @@ static IBPROF_ERROR __hcol_init(IBPROF_MODULE_OBJECT *mod_obj)
 		src_api = &hcol_TRACE_funcs;
 		break;
 
+	case IBPROF_MODE_DELAY:
+		src_api = &hcol_DELAY_funcs;
+		break;
+
 	default:
 		src_api = &hcol_NONE_funcs;
 	}
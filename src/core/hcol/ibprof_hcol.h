@@ -21,6 +21,10 @@
  * #define POST_RET_SUFFIX(func_name)
  * - what to do after the original is called (return value is "ret")
  *
+ * Calls that transfer data use POST_SIZE_SUFFIX(func_name, size) and
+ * POST_RET_SIZE_SUFFIX(func_name, size) where size is an expression
+ * evaluated after the original is called.
+ *
  * Also, need to add a single line using this macro in the .c file.
  */
 
@@ -34,6 +38,8 @@
 #define PRE_NONE(func_name)
 #define POST_NONE(func_name)
 #define POST_RET_NONE(func_name)
+#define POST_SIZE_NONE(func_name, size)
+#define POST_RET_SIZE_NONE(func_name, size)
 
 /* Verbose mode - output the name of the functions entered and left */
 #define PRE_VERBOSE(func_name) IBPROF_TRACE("IN %s:%s\n", __FILE__, __FUNCTION__);
@@ -41,36 +47,75 @@
     IBPROF_TRACE("OUT %s:%s\n", __FILE__, __FUNCTION__);
 #define POST_RET_VERBOSE(func_name) PRETEND_USED(flip_ret); \
     IBPROF_TRACE("OUT %s:%s\n", __FILE__, __FUNCTION__);
+#define POST_SIZE_VERBOSE(func_name, size) POST_VERBOSE(func_name)
+#define POST_RET_SIZE_VERBOSE(func_name, size) POST_RET_VERBOSE(func_name)
 
 /* Profiling mode - collect timing information about function run-times */
 #define PRE_PROF(func_name) \
-    double tm_start; \
-    tm_start = ibprof_timestamp();
+    int64_t tm_start = 0; \
+    int sampled = ibprof_sample_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name)); \
+    if (sampled) tm_start = ibprof_clock_ticks();
 #define POST_PROF(func_name) \
-    ibprof_update(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start));
+    if (sampled) ibprof_update_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start));
 #define POST_RET_PROF(func_name) \
-    ibprof_update(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start));
+    if (sampled) ibprof_update_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start));
+#define POST_SIZE_PROF(func_name, size) if (sampled) { \
+    int64_t tm_diff = ibprof_clock_diff(tm_start); \
+    ibprof_update_call_size(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size)); }
+#define POST_RET_SIZE_PROF(func_name, size) POST_SIZE_PROF(func_name, size)
+
+/* Delay-injection mode - busy-wait before the call, time is profiled */
+#define PRE_DELAY(func_name) \
+	PRE_PROF(func_name) \
+	ibprof_delay_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name));
+#define POST_DELAY(func_name) POST_PROF(func_name)
+#define POST_RET_DELAY(func_name) POST_RET_PROF(func_name)
+#define POST_SIZE_DELAY(func_name, size) POST_SIZE_PROF(func_name, size)
+#define POST_RET_SIZE_DELAY(func_name, size) POST_RET_SIZE_PROF(func_name, size)
 
 /* Error-injection mode - return an error with some probability */
 #define PRE_ERR(func_name) \
-	double tm_start; \
+	int64_t tm_start; \
 	int64_t err = 0; \
-	tm_start = ibprof_timestamp();
+	tm_start = ibprof_clock_ticks();
 #define POST_ERR(func_name) \
-	ibprof_update_ex(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start), &err);
+	ibprof_update_call_ex(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start), &err);
 #define POST_RET_ERR(func_name) \
-	if ((rand() % 100) < ibprof_conf_get_int(IBPROF_ERR_PERCENT)) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
+	if (ibprof_fault_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name))) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
 	err = (flip_ret ? (ret != 0) : (ret == 0)); \
-	ibprof_update_ex(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start), &err);
+	ibprof_update_call_ex(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start), &err);
+#define POST_SIZE_ERR(func_name, size) { \
+	int64_t tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_size_ex(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size), &err); }
+#define POST_RET_SIZE_ERR(func_name, size) { \
+	int64_t tm_diff; \
+	if (ibprof_fault_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name))) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
+	err = (flip_ret ? (ret != 0) : (ret == 0)); \
+	tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_size_ex(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size), &err); }
 
-/* TODO: Stack-tracing mode - collect information about the origin of function calls */
-#define PRE_TRACE(func_name)
-#define POST_TRACE(func_name)
-#define POST_RET_TRACE(func_name)
+/* Trace mode - record start and duration of every call to a trace file */
+#define PRE_TRACE(func_name) \
+	int64_t tm_start; \
+	tm_start = ibprof_clock_ticks();
+#define POST_TRACE(func_name) \
+	ibprof_trace_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            tm_start, ibprof_clock_diff(tm_start), -1, 0);
+#define POST_RET_TRACE(func_name) \
+	ibprof_trace_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            tm_start, ibprof_clock_diff(tm_start), -1, 0);
+#define POST_SIZE_TRACE(func_name, size) { \
+	int64_t tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_trace_call(IBPROF_MODULE_HCOL, TBL_CALL_NUMBER(func_name), \
+            tm_start, tm_diff, (size), 0); }
+#define POST_RET_SIZE_TRACE(func_name, size) POST_SIZE_TRACE(func_name, size)
 
 /*
  * Common macros, presenting the function stubs
@@ -78,6 +123,8 @@
 #define PRE_(func_name) f = hcol_module_context.mean.func_name;
 #define POST_(func_name)
 #define POST_RET_(func_name)
+#define POST_SIZE_(func_name, size)
+#define POST_RET_SIZE_(func_name, size)
 
 #define FUNC_BODY_INT(type, func_name, ...)     \
     int ret;                                                            \
@@ -113,6 +160,18 @@
     PRETEND_USED(flip_ret);                                             \
     return ret;
 
+#define FUNC_BODY_INT_SIZE(type, func_name, size, ...)     \
+    int ret;                                                            \
+    int flip_ret = 1;                                                   \
+    EMPLOY_TYPE(func_name) *f;                                          \
+    f = hcol_module_context.noble.func_name;                            \
+    PRE_##type(func_name)                                               \
+    INTERNAL_CHECK();                                                   \
+    ret = f(__VA_ARGS__);                                               \
+    POST_RET_SIZE_##type(func_name, size)                               \
+    PRETEND_USED(flip_ret);                                             \
+    return ret;
+
 #define EMPLOY_TYPE(func_name) __type_of_##func_name
 #define DECLARE_TYPE(func_name) \
         typedef typeof(func_name) EMPLOY_TYPE(func_name);
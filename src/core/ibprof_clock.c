@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#define CLOCK_CALIBRATE_NSEC   (20000000) /* Duration of TSC calibration */
+#define CLOCK_OVERHEAD_BATCH   (128) /* Measurements averaged in a batch */
+#define CLOCK_OVERHEAD_LOOPS   (128) /* Batches, the fastest one is taken */
+#define CLOCK_OVERHEAD_MODULE  (IBPROF_MODULE_IBV) /* Slot updated by empty wrapper */
+#define CLOCK_OVERHEAD_CALL    (HASH_MAX_CALL)
+#define CLOCK_OVERHEAD_SIZE    (4096) /* Message size of empty wrapper */
+
+IBPROF_CLOCK_SOURCE ibprof_clock_source = IBPROF_CLOCK_GETTIMEOFDAY;
+
+double ibprof_clock_freq = 1.0e+6;
+
+double ibprof_clock_read_cost[IBPROF_CLOCK_LAST]; /* nsec */
+
+double ibprof_clock_call_cost = 0; /* nsec */
+
+int64_t ibprof_clock_window = 0; /* ticks */
+
+int64_t ibprof_clock_overhead = 0; /* ticks */
+
+static const char * const ibprof_clock_str[] = {
+	"tsc",
+	"monotonic",
+	"monotonic_raw",
+	"gettimeofday"
+};
+
+/****************************************************************************
+ * Static Function Declarations
+ ***************************************************************************/
+static int __tsc_is_invariant(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned int eax, ebx, ecx, edx;
+
+	/* CPUID.80000007H:EDX[8] - Invariant TSC */
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	return ((edx & (1 << 8)) != 0);
+#elif defined(__powerpc64__) || defined(__aarch64__)
+	/* Time base and generic timer have constant frequency */
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static int64_t __raw_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Take TSC value as close as possible to CLOCK_MONOTONIC_RAW reading
+ */
+static void __tsc_sample(int64_t *tsc, int64_t *nsec)
+{
+	int64_t tsc_before;
+	int64_t tsc_after;
+
+	tsc_before = (int64_t)sys_rdtsc();
+	*nsec = __raw_nsec();
+	tsc_after = (int64_t)sys_rdtsc();
+
+	*tsc = tsc_before + (tsc_after - tsc_before) / 2;
+}
+
+static double __tsc_calibrate(void)
+{
+	int64_t tsc_start, tsc_end;
+	int64_t nsec_start, nsec_end;
+
+	__tsc_sample(&tsc_start, &nsec_start);
+	do {
+		__tsc_sample(&tsc_end, &nsec_end);
+	} while ((nsec_end - nsec_start) < CLOCK_CALIBRATE_NSEC);
+
+	return ((double)(tsc_end - tsc_start) * 1.0e+9 / (nsec_end - nsec_start));
+}
+
+static void __clock_noop(void)
+{
+}
+
+/* Wrappers call original functions through pointers */
+static void (* volatile __clock_noop_call)(void) = __clock_noop;
+
+/*
+ * Run empty wrapper the way a profiled call does it: sampling check,
+ * two clock reads around call of no-op function and update of call and
+ * size class statistics of the calling thread (features are given as
+ * constant expression)
+ */
+static INLINE int64_t __clock_wrapper_cost(int opt)
+{
+	int64_t best = INT64_MAX;
+	int64_t nsec = 0;
+	int64_t tm_start = 0;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < CLOCK_OVERHEAD_LOOPS; i++) {
+		nsec = __raw_nsec();
+		for (j = 0; j < CLOCK_OVERHEAD_BATCH; j++) {
+			if (!ibprof_sample_call(CLOCK_OVERHEAD_MODULE, CLOCK_OVERHEAD_CALL))
+				continue;
+			tm_start = ibprof_clock_ticks();
+			__clock_noop_call();
+			ibprof_update_call_opt(CLOCK_OVERHEAD_MODULE, CLOCK_OVERHEAD_CALL,
+					ibprof_clock_diff(tm_start), CLOCK_OVERHEAD_SIZE, opt);
+		}
+		best = sys_min(best, __raw_nsec() - nsec);
+	}
+
+	return best;
+}
+
+/**
+ * ibprof_clock_init
+ *
+ * @brief
+ *    Selects clock source by name and calibrates it.
+ *    Invariant TSC is used by default when CPU supports it,
+ *    otherwise CLOCK_MONOTONIC_RAW is taken.
+ *
+ * @param[in]    name            Clock source name or NULL.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_clock_init(const char *name)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	IBPROF_CLOCK_SOURCE source = IBPROF_CLOCK_TSC;
+	int i = 0;
+
+	if (name) {
+		for (i = 0; i < IBPROF_CLOCK_LAST; i++) {
+			if (sys_strcasecmp(name, ibprof_clock_str[i]) == 0)
+				break;
+		}
+		if (i == IBPROF_CLOCK_LAST) {
+			status = IBPROF_ERR_BAD_ARGUMENT;
+			IBPROF_WARN("%s : error=%d - Unknown clock source '%s', default is used\n",
+					__FUNCTION__, status, name);
+		} else
+			source = (IBPROF_CLOCK_SOURCE)i;
+	}
+
+	if ((source == IBPROF_CLOCK_TSC) && !__tsc_is_invariant()) {
+		if (name && (status == IBPROF_ERR_NONE))
+			IBPROF_WARN("%s : invariant TSC is not available, %s is used\n",
+					__FUNCTION__, ibprof_clock_str[IBPROF_CLOCK_MONOTONIC_RAW]);
+		source = IBPROF_CLOCK_MONOTONIC_RAW;
+	}
+
+	switch (source) {
+	case IBPROF_CLOCK_TSC:
+		ibprof_clock_freq = __tsc_calibrate();
+		break;
+
+	case IBPROF_CLOCK_MONOTONIC:
+	case IBPROF_CLOCK_MONOTONIC_RAW:
+		ibprof_clock_freq = 1.0e+9;
+		break;
+
+	default:
+		ibprof_clock_freq = 1.0e+6;
+		break;
+	}
+
+	ibprof_clock_source = source;
+
+	return status;
+}
+
+/**
+ * ibprof_clock_calibrate
+ *
+ * @brief
+ *    Measures cost of profiling: time to read every clock source,
+ *    time that is added to every measured call by reading selected clock
+ *    (window) and time that empty wrapper takes in total. Window can be
+ *    subtracted from measured calls. It is called when basis object
+ *    exists, as empty wrapper goes through statistics of a thread.
+ *    Nothing is measured if no module is profiled and window is not
+ *    subtracted.
+ *
+ * @param[in]    subtract        Subtract window from measured calls.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_clock_calibrate(int subtract)
+{
+	IBPROF_CLOCK_SOURCE source = ibprof_clock_source;
+	IBPROF_THREAD_OBJECT *saved_obj = NULL;
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	volatile int64_t sink = 0;
+	int64_t best = INT64_MAX;
+	int64_t nsec = 0;
+	int64_t tm_start = 0;
+	int64_t tm = 0;
+	int i = 0;
+	int j = 0;
+
+	ibprof_clock_overhead = 0;
+	ibprof_clock_call_cost = 0;
+	ibprof_clock_window = 0;
+
+	for (i = 0; i < IBPROF_MODULE_USER; i++) {
+		if (ibprof_conf_get_mode(i) != IBPROF_MODE_NONE)
+			break;
+	}
+	if ((i == IBPROF_MODULE_USER) && !subtract)
+		return IBPROF_ERR_NONE;
+
+	/* Reading cost of every source (TSC is skipped if it can not be used) */
+	for (i = 0; i < IBPROF_CLOCK_LAST; i++) {
+		ibprof_clock_read_cost[i] = 0;
+		if ((i == IBPROF_CLOCK_TSC) && !__tsc_is_invariant())
+			continue;
+		ibprof_clock_source = (IBPROF_CLOCK_SOURCE)i;
+		nsec = __raw_nsec();
+		for (j = 0; j < CLOCK_OVERHEAD_BATCH * CLOCK_OVERHEAD_LOOPS; j++)
+			sink += ibprof_clock_ticks();
+		ibprof_clock_read_cost[i] = (double)(__raw_nsec() - nsec) /
+				(CLOCK_OVERHEAD_BATCH * CLOCK_OVERHEAD_LOOPS);
+	}
+	ibprof_clock_source = source;
+
+	/*
+	 * Window is what a wrapper measures around a call that takes no time:
+	 * the fastest batch is taken as other ones are disturbed by interrupts
+	 */
+	for (i = 0; i < CLOCK_OVERHEAD_LOOPS; i++) {
+		tm = 0;
+		for (j = 0; j < CLOCK_OVERHEAD_BATCH; j++) {
+			tm_start = ibprof_clock_ticks();
+			tm += ibprof_clock_diff(tm_start);
+		}
+		best = sys_min(best, tm);
+	}
+	ibprof_clock_window = best / CLOCK_OVERHEAD_BATCH;
+
+	/*
+	 * Empty wrapper updates private thread object of the calling thread,
+	 * so statistics of the process are not affected
+	 */
+	saved_obj = ibprof_thread_obj;
+	thread_obj = ibprof_thread_create(ibprof_obj->task_obj->procid, ibprof_obj->generation);
+	if (thread_obj) {
+		ibprof_thread_obj = thread_obj;
+		if (ibprof_warmup_number || ibprof_interval_calls)
+			best = __clock_wrapper_cost(IBPROF_UPDATE_ALL);
+		else
+			best = __clock_wrapper_cost(IBPROF_UPDATE_HIST);
+		ibprof_clock_call_cost = (double)best / CLOCK_OVERHEAD_BATCH;
+		ibprof_thread_obj = saved_obj;
+		ibprof_thread_destroy(thread_obj);
+	}
+
+	if (subtract)
+		ibprof_clock_overhead = ibprof_clock_window;
+
+	(void)sink;
+
+	return IBPROF_ERR_NONE;
+}
+
+/**
+ * ibprof_clock_name
+ *
+ * @brief
+ *    Return name of current clock source.
+ *
+ * @retval clock source name
+ ***************************************************************************/
+const char *ibprof_clock_name(void)
+{
+	return ibprof_clock_str[ibprof_clock_source];
+}
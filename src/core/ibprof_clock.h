@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_clock.h
+ *
+ * @brief This file is place for clock source
+ *         related data.
+ *
+ **/
+#ifndef _IBPROF_CLOCK_H_
+#define _IBPROF_CLOCK_H_
+
+/**
+ * @enum IBPROF_CLOCK_SOURCE
+ * @brief List of supported clock sources (IBPROF_CLOCK).
+ */
+typedef enum {
+	IBPROF_CLOCK_TSC = 0, /**< invariant time stamp counter */
+	IBPROF_CLOCK_MONOTONIC, /**< clock_gettime(CLOCK_MONOTONIC) */
+	IBPROF_CLOCK_MONOTONIC_RAW, /**< clock_gettime(CLOCK_MONOTONIC_RAW) */
+	IBPROF_CLOCK_GETTIMEOFDAY, /**< gettimeofday() */
+
+	IBPROF_CLOCK_LAST
+} IBPROF_CLOCK_SOURCE;
+
+extern IBPROF_CLOCK_SOURCE ibprof_clock_source;
+
+extern double ibprof_clock_freq;
+
+extern double ibprof_clock_read_cost[IBPROF_CLOCK_LAST];
+
+extern double ibprof_clock_call_cost;
+
+extern int64_t ibprof_clock_window;
+
+extern int64_t ibprof_clock_overhead;
+
+/**
+ * ibprof_clock_init
+ *
+ * @brief
+ *    Selects clock source by name and calibrates it.
+ *    Invariant TSC is used by default when CPU supports it,
+ *    otherwise CLOCK_MONOTONIC_RAW is taken.
+ *
+ * @param[in]    name            Clock source name or NULL.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_clock_init(const char *name);
+
+/**
+ * ibprof_clock_calibrate
+ *
+ * @brief
+ *    Measures cost of profiling: time to read every clock source,
+ *    time that is added to every measured call by reading selected clock
+ *    (window) and time that empty wrapper takes in total. Window can be
+ *    subtracted from measured calls. It is called when basis object
+ *    exists, as empty wrapper goes through statistics of a thread.
+ *    Nothing is measured if no module is profiled and window is not
+ *    subtracted.
+ *
+ * @param[in]    subtract        Subtract window from measured calls.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_clock_calibrate(int subtract);
+
+/**
+ * ibprof_clock_name
+ *
+ * @brief
+ *    Return name of current clock source.
+ *
+ * @retval clock source name
+ ***************************************************************************/
+const char *ibprof_clock_name(void);
+
+/**
+ * ibprof_clock_ticks
+ *
+ * @brief
+ *    Read current value of selected clock source in raw ticks.
+ *
+ * @retval (value) - number of ticks
+ ***************************************************************************/
+static INLINE int64_t ibprof_clock_ticks(void)
+{
+	struct timespec ts;
+	struct timeval tv;
+
+	switch (ibprof_clock_source) {
+	case IBPROF_CLOCK_TSC:
+		return (int64_t)sys_rdtsc();
+
+	case IBPROF_CLOCK_MONOTONIC:
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+	case IBPROF_CLOCK_MONOTONIC_RAW:
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+	default:
+		sys_time(&tv);
+		return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+	}
+}
+
+/**
+ * ibprof_clock_sub
+ *
+ * @brief
+ *    Remove calibrated profiling overhead from measured duration.
+ *
+ * @retval (value) - number of ticks
+ ***************************************************************************/
+static INLINE int64_t ibprof_clock_sub(int64_t ticks)
+{
+	ticks -= ibprof_clock_overhead;
+
+	return (ticks > 0 ? ticks : 0);
+}
+
+#define ibprof_clock_diff(t_val)   ibprof_clock_sub(ibprof_clock_ticks() - (t_val))
+
+/**
+ * ibprof_clock_to_sec
+ *
+ * @brief
+ *    Convert number of ticks to seconds.
+ *
+ * @retval (value) - seconds
+ ***************************************************************************/
+static INLINE double ibprof_clock_to_sec(int64_t ticks)
+{
+	return (double)ticks / ibprof_clock_freq;
+}
+
+/**
+ * ibprof_clock_from_sec
+ *
+ * @brief
+ *    Convert seconds to number of ticks.
+ *
+ * @retval (value) - number of ticks
+ ***************************************************************************/
+static INLINE int64_t ibprof_clock_from_sec(double sec)
+{
+	return (int64_t)(sec * ibprof_clock_freq);
+}
+
+#endif /* _IBPROF_CLOCK_H_ */
@@ -34,7 +34,24 @@ void ibprof_conf_init(void)
 	static const char *ibprof_format = NULL;
 	static int ibprof_err_percent = 1;
 	static int ibprof_err_seed = 1337;
+	static const char *ibprof_err_policy = NULL;
+	static const char *ibprof_delay = NULL;
 	static int ibprof_time_units = IBPROF_TIME_UNITS_MSEC;
+	static const char *ibprof_clock = NULL;
+	static int ibprof_hist_bits = 3;
+	static const char *ibprof_trace_file = NULL;
+	static int ibprof_trace_buffer = 32768;
+	static int ibprof_dump_interval = 0;
+	static int ibprof_dump_delta = 1;
+	static int ibprof_live_interval = 0;
+	static int ibprof_node_reduce = 0;
+	static int ibprof_node_size = 0;
+	static int ibprof_resource_top = 0;
+	static int ibprof_thread_top = 0;
+	static int ibprof_interval_calls = 0;
+	static int ibprof_call_counters = 1;
+	static int ibprof_overhead_subtract = 0;
+	static const char *ibprof_sample = NULL;
 
 	enviroment[IBPROF_TEST_MASK] = (void *) &ibprof_test_mask;
 	enviroment[IBPROF_MODE_IBV] = (void *) &ibprof_mode_ibv;
@@ -48,7 +65,24 @@ void ibprof_conf_init(void)
 	enviroment[IBPROF_FORMAT] = (void *) ibprof_format;
 	enviroment[IBPROF_ERR_PERCENT] = (void *) &ibprof_err_percent;
 	enviroment[IBPROF_ERR_SEED] = (void *) &ibprof_err_seed;
+	enviroment[IBPROF_ERR_POLICY] = (void *) ibprof_err_policy;
+	enviroment[IBPROF_DELAY] = (void *) ibprof_delay;
 	enviroment[IBPROF_TIME_UNITS] = (void *) &ibprof_time_units;
+	enviroment[IBPROF_CLOCK] = (void *) ibprof_clock;
+	enviroment[IBPROF_HIST_BITS] = (void *) &ibprof_hist_bits;
+	enviroment[IBPROF_TRACE_FILE] = (void *) ibprof_trace_file;
+	enviroment[IBPROF_TRACE_BUFFER] = (void *) &ibprof_trace_buffer;
+	enviroment[IBPROF_DUMP_INTERVAL] = (void *) &ibprof_dump_interval;
+	enviroment[IBPROF_DUMP_DELTA] = (void *) &ibprof_dump_delta;
+	enviroment[IBPROF_LIVE_INTERVAL] = (void *) &ibprof_live_interval;
+	enviroment[IBPROF_NODE_REDUCE] = (void *) &ibprof_node_reduce;
+	enviroment[IBPROF_NODE_SIZE] = (void *) &ibprof_node_size;
+	enviroment[IBPROF_RESOURCE_TOP] = (void *) &ibprof_resource_top;
+	enviroment[IBPROF_THREAD_TOP] = (void *) &ibprof_thread_top;
+	enviroment[IBPROF_INTERVAL_CALLS] = (void *) &ibprof_interval_calls;
+	enviroment[IBPROF_CALL_COUNTERS] = (void *) &ibprof_call_counters;
+	enviroment[IBPROF_OVERHEAD_SUBTRACT] = (void *) &ibprof_overhead_subtract;
+	enviroment[IBPROF_SAMPLE] = (void *) ibprof_sample;
 
 	_ibprof_conf_init();
 }
@@ -65,10 +99,12 @@ int ibprof_conf_get_int(IBPROF_ENV variable)
 
 static void _ibprof_conf_mode(char *str);
 
-static void _ibprof_conf_dump_file(char *str);
+static void _ibprof_conf_file_name(IBPROF_ENV variable, const char *str, char *buf, int max_len);
 
 static void _ibprof_conf_init(void)
 {
+	static char dump_file[1024];
+	static char trace_file[1024];
 	char *env;
 	env = getenv("IBPROF_MODE");
 	if (env)
@@ -88,7 +124,7 @@ static void _ibprof_conf_init(void)
 
 	env = getenv("IBPROF_DUMP_FILE");
 	if (env)
-		_ibprof_conf_dump_file(env);
+		_ibprof_conf_file_name(IBPROF_DUMP_FILE, env, dump_file, sizeof(dump_file));
 
 	env = getenv("IBPROF_FORMAT");
 	if (env)
@@ -99,10 +135,16 @@ static void _ibprof_conf_init(void)
 		*(int *) enviroment[IBPROF_ERR_PERCENT] = sys_strtol(env, NULL, 0);
 
 	env = getenv("IBPROF_ERR_SEED");
-	if (env) {
+	if (env)
 		*(int *) enviroment[IBPROF_ERR_SEED] = sys_strtol(env, NULL, 0);
-		srand(*(int *) enviroment[IBPROF_ERR_SEED]);
-	}
+
+	env = getenv("IBPROF_ERR_POLICY");
+	if (env)
+		enviroment[IBPROF_ERR_POLICY] = (void *) env;
+
+	env = getenv("IBPROF_DELAY");
+	if (env)
+		enviroment[IBPROF_DELAY] = (void *) env;
 
 	env = getenv("IBPROF_TIME_UNITS");
 	if (env) {
@@ -110,6 +152,66 @@ static void _ibprof_conf_init(void)
 		if (val < IBPROF_TIME_UNITS_LAST)
 			*(int *) enviroment[IBPROF_TIME_UNITS] = val;
 	}
+
+	env = getenv("IBPROF_CLOCK");
+	if (env)
+		enviroment[IBPROF_CLOCK] = (void *) env;
+
+	env = getenv("IBPROF_HIST_BITS");
+	if (env)
+		*(int *) enviroment[IBPROF_HIST_BITS] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_TRACE_FILE");
+	_ibprof_conf_file_name(IBPROF_TRACE_FILE, (env ? env : "ibprof_%H_%T.trace"),
+			trace_file, sizeof(trace_file));
+
+	env = getenv("IBPROF_TRACE_BUFFER");
+	if (env)
+		*(int *) enviroment[IBPROF_TRACE_BUFFER] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_DUMP_INTERVAL");
+	if (env)
+		*(int *) enviroment[IBPROF_DUMP_INTERVAL] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_DUMP_DELTA");
+	if (env)
+		*(int *) enviroment[IBPROF_DUMP_DELTA] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_LIVE_INTERVAL");
+	if (env)
+		*(int *) enviroment[IBPROF_LIVE_INTERVAL] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_NODE_REDUCE");
+	if (env)
+		*(int *) enviroment[IBPROF_NODE_REDUCE] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_NODE_SIZE");
+	if (env)
+		*(int *) enviroment[IBPROF_NODE_SIZE] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_RESOURCE_TOP");
+	if (env)
+		*(int *) enviroment[IBPROF_RESOURCE_TOP] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_THREAD_TOP");
+	if (env)
+		*(int *) enviroment[IBPROF_THREAD_TOP] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_INTERVAL_CALLS");
+	if (env)
+		*(int *) enviroment[IBPROF_INTERVAL_CALLS] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_CALL_COUNTERS");
+	if (env)
+		*(int *) enviroment[IBPROF_CALL_COUNTERS] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_OVERHEAD_SUBTRACT");
+	if (env)
+		*(int *) enviroment[IBPROF_OVERHEAD_SUBTRACT] = sys_strtol(env, NULL, 0);
+
+	env = getenv("IBPROF_SAMPLE");
+	if (env)
+		enviroment[IBPROF_SAMPLE] = (void *) env;
 }
 
 static void _ibprof_conf_mode(char *env)
@@ -152,11 +254,9 @@ static void _ibprof_conf_mode(char *env)
 	sys_free(lower_env);
 }
 
-static void _ibprof_conf_dump_file(char *str)
+static void _ibprof_conf_file_name(IBPROF_ENV variable, const char *str, char *buf, int max_len)
 {
-	char *pattern = str;
-	int max_len = 1024;
-	char buf[1024];
+	const char *pattern = str;
 	char *dest = buf;
 	int dest_len = 0;
         char *tmp = NULL;
@@ -206,7 +306,8 @@ static void _ibprof_conf_dump_file(char *str)
 		else
 			break; /* size of buffer is exceeded */
 	}
-	enviroment[IBPROF_DUMP_FILE] = (void *) &buf;
+	buf[max_len - 1] = '\0';
+	enviroment[variable] = (void *) buf;
 }
 
 int ibprof_conf_get_mode(int module)
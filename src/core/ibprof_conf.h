@@ -24,7 +24,24 @@ typedef enum {
 	IBPROF_FORMAT,
 	IBPROF_ERR_PERCENT,
 	IBPROF_ERR_SEED,
+	IBPROF_ERR_POLICY,
+	IBPROF_DELAY,
 	IBPROF_TIME_UNITS,
+	IBPROF_CLOCK,
+	IBPROF_HIST_BITS,
+	IBPROF_TRACE_FILE,
+	IBPROF_TRACE_BUFFER,
+	IBPROF_DUMP_INTERVAL,
+	IBPROF_DUMP_DELTA,
+	IBPROF_LIVE_INTERVAL,
+	IBPROF_NODE_REDUCE,
+	IBPROF_NODE_SIZE,
+	IBPROF_RESOURCE_TOP,
+	IBPROF_THREAD_TOP,
+	IBPROF_INTERVAL_CALLS,
+	IBPROF_CALL_COUNTERS,
+	IBPROF_OVERHEAD_SUBTRACT,
+	IBPROF_SAMPLE,
 
 	IBPROF_ENV_OPTIONS_AMOUNT
 } IBPROF_ENV;
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+int ibprof_counter_active = 0;
+
+/**
+ * ibprof_counter_init
+ *
+ * @brief
+ *    Enable or disable call counters.
+ *
+ * @param[in]    active          0 - disable, otherwise - enable.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_counter_init(int active)
+{
+	ibprof_counter_active = (active != 0);
+
+	return IBPROF_ERR_NONE;
+}
+
+/**
+ * ibprof_counter_create
+ *
+ * @brief
+ *    Allocates memory for new set of counters.
+ *
+ * @param[in]    desc            Layout of counters.
+ *
+ * @retval pointer to new table - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_COUNTER_TABLE *ibprof_counter_create(const IBPROF_COUNTER_DESC *desc)
+{
+	IBPROF_COUNTER_TABLE *table = NULL;
+
+	table = (IBPROF_COUNTER_TABLE *) sys_malloc(sizeof(IBPROF_COUNTER_TABLE));
+	if (table) {
+		sys_memset(table, 0, sizeof(IBPROF_COUNTER_TABLE));
+		table->desc = desc;
+	}
+
+	return table;
+}
+
+/**
+ * ibprof_counter_merge
+ *
+ * @brief
+ *    Adds counters of a call to destination set with the same layout.
+ *    Counters of sampled call are scaled to all invocations.
+ *
+ * @param[in]    dst             Destination counters.
+ * @param[in]    src             Counters to be added.
+ * @param[in]    count           Number of measured invocations.
+ * @param[in]    skip            Number of invocations that were not measured.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_counter_merge(IBPROF_COUNTER_TABLE *dst, const IBPROF_COUNTER_TABLE *src,
+			int64_t count, int64_t skip)
+{
+	int i = 0;
+
+	for (i = 0; (i < COUNTER_MAX_SIZE) && src->desc[i].name; i++) {
+		if (src->desc[i].kind == IBPROF_COUNTER_PEAK)
+			dst->value[i] = sys_max(dst->value[i],
+					__atomic_load_n(&src->value[i], __ATOMIC_RELAXED));
+		else
+			dst->value[i] += ibprof_sample_scale(
+					__atomic_load_n(&src->value[i], __ATOMIC_RELAXED), count, skip);
+	}
+}
+
+/**
+ * ibprof_counter_gather
+ *
+ * @brief
+ *    Sums counters of a call collected by all threads in given generation.
+ *    Counters of sampled calls are scaled to all invocations.
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[out]   value           Sum of counters (COUNTER_MAX_SIZE entries).
+ * @param[out]   desc            Layout of counters.
+ *
+ * @retval (1) - call has counters
+ * @retval (0) - otherwise
+ ***************************************************************************/
+int ibprof_counter_gather(IBPROF_THREAD_OBJECT *thread_list, int generation,
+			int module, int call, int64_t *value, const IBPROF_COUNTER_DESC **desc)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_COUNTER_TABLE *table = NULL;
+	int64_t count = 0;
+	int64_t skip = 0;
+	int i = 0;
+
+	sys_memset(value, 0, COUNTER_MAX_SIZE * sizeof(*value));
+	*desc = NULL;
+
+	/* Counters are updated by owner threads while they are read, so
+	 * result is consistent up to calls that are in progress
+	 */
+	for (thread_obj = thread_list; thread_obj; thread_obj = thread_obj->next) {
+		table = __atomic_load_n(&thread_obj->counter_table[module][call], __ATOMIC_ACQUIRE);
+		if (!table || (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) != generation))
+			continue;
+		/* Counters of sampled call are collected over measured invocations */
+		count = thread_obj->call_table[module][call].count;
+		skip = thread_obj->sample_skip[module][call];
+		for (i = 0; (i < COUNTER_MAX_SIZE) && table->desc[i].name; i++) {
+			if (table->desc[i].kind == IBPROF_COUNTER_PEAK)
+				value[i] = sys_max(value[i], __atomic_load_n(&table->value[i], __ATOMIC_RELAXED));
+			else
+				value[i] += ibprof_sample_scale(
+						__atomic_load_n(&table->value[i], __ATOMIC_RELAXED), count, skip);
+		}
+		*desc = table->desc;
+	}
+
+	return (*desc != NULL);
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_counter.h
+ *
+ * @brief This file is place for call counters
+ *         declaration and operations definition.
+ *
+ * Module can describe what its calls do besides taking time: number of
+ * completions returned by a poll, number of work requests in a post etc.
+ * Such values are accumulated in fixed set of counters per call. Layout of
+ * the set is given by module as array of descriptors (name, how to report,
+ * index of counter used as base for ratio), so dump does not need to know
+ * meaning of counters.
+ *
+ **/
+#ifndef _IBPROF_COUNTER_H_
+#define _IBPROF_COUNTER_H_
+
+#define COUNTER_MAX_SIZE      (32) /* Counters per call */
+
+/**
+ * @enum IBPROF_COUNTER_KIND
+ * @brief How counter is reported.
+ */
+typedef enum {
+	IBPROF_COUNTER_TOTAL = 0, /**< value only */
+	IBPROF_COUNTER_PERCENT, /**< value and percent of base */
+	IBPROF_COUNTER_AVERAGE, /**< value and average per base */
+	IBPROF_COUNTER_TIME, /**< time (ticks) and average per base (per MB for bytes) */
+	IBPROF_COUNTER_BYTES, /**< bytes and average per base */
+	IBPROF_COUNTER_PEAK /**< maximum value, threads are not summed */
+} IBPROF_COUNTER_KIND;
+
+/**
+ * @struct _IBPROF_COUNTER_DESC
+ * @brief Description of a counter (array is terminated by NULL name)
+ */
+typedef struct _IBPROF_COUNTER_DESC {
+	const char *name; /**< name of counter */
+	IBPROF_COUNTER_KIND kind; /**< how counter is reported */
+	int base; /**< index of counter used as base of ratio */
+} IBPROF_COUNTER_DESC;
+
+/**
+ * @struct _IBPROF_COUNTER_TABLE
+ * @brief Counters of a call
+ */
+typedef struct _IBPROF_COUNTER_TABLE {
+	const IBPROF_COUNTER_DESC *desc; /**< layout of counters */
+	int64_t value[COUNTER_MAX_SIZE]; /**< counters */
+} IBPROF_COUNTER_TABLE;
+
+struct _IBPROF_THREAD_OBJECT;
+
+extern int ibprof_counter_active;
+
+/**
+ * ibprof_counter_init
+ *
+ * @brief
+ *    Enable or disable call counters.
+ *
+ * @param[in]    active          0 - disable, otherwise - enable.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_counter_init(int active);
+
+/**
+ * ibprof_counter_create
+ *
+ * @brief
+ *    Allocates memory for new set of counters.
+ *
+ * @param[in]    desc            Layout of counters.
+ *
+ * @retval pointer to new table - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_COUNTER_TABLE *ibprof_counter_create(const IBPROF_COUNTER_DESC *desc);
+
+/**
+ * ibprof_counter_merge
+ *
+ * @brief
+ *    Adds counters of a call to destination set with the same layout.
+ *    Counters of sampled call are scaled to all invocations.
+ *
+ * @param[in]    dst             Destination counters.
+ * @param[in]    src             Counters to be added.
+ * @param[in]    count           Number of measured invocations.
+ * @param[in]    skip            Number of invocations that were not measured.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_counter_merge(IBPROF_COUNTER_TABLE *dst, const IBPROF_COUNTER_TABLE *src,
+			int64_t count, int64_t skip);
+
+/**
+ * ibprof_counter_gather
+ *
+ * @brief
+ *    Sums counters of a call collected by all threads in given generation.
+ *    Counters of sampled calls are scaled to all invocations.
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[out]   value           Sum of counters (COUNTER_MAX_SIZE entries).
+ * @param[out]   desc            Layout of counters.
+ *
+ * @retval (1) - call has counters
+ * @retval (0) - otherwise
+ ***************************************************************************/
+int ibprof_counter_gather(struct _IBPROF_THREAD_OBJECT *thread_list, int generation,
+			int module, int call, int64_t *value, const IBPROF_COUNTER_DESC **desc);
+
+/**
+ * ibprof_counter_class
+ *
+ * @brief
+ *    Return power of two class of a value: 0 - 0, 1 - 1, 2 - 2..3,
+ *    3 - 4..7 etc. Classes above max are accounted in max.
+ *
+ * @return class number
+ ***************************************************************************/
+static INLINE int ibprof_counter_class(int64_t value, int max)
+{
+	int class = 0;
+
+	while ((value > 0) && (class < max)) {
+		value >>= 1;
+		class++;
+	}
+
+	return class;
+}
+
+#endif /* _IBPROF_COUNTER_H_ */
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+int64_t ibprof_fault_start = 0;
+IBPROF_FAULT_POLICY ibprof_fault_policy[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+int64_t ibprof_delay_cost = 0;
+IBPROF_DELAY_POLICY ibprof_delay_policy[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+
+static uint64_t ibprof_fault_base = 0;
+
+/* Policy list parser is shared by error and delay injection,
+ * callbacks set a field of policy and copy policy to a call
+ */
+typedef int (*__policy_field_fn)(void *policy, const char *field, long value);
+typedef void (*__policy_set_fn)(int module, int call, const void *policy);
+
+static int __policy_set(IBPROF_MODULE_OBJECT **module_array, const char *name, int len,
+			__policy_set_fn set, const void *policy)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	int matched = 0;
+	int i = 0;
+
+	for (i = 0; (module_obj = module_array[i]); i++) {
+		if ((module_obj->id == IBPROF_MODULE_INVALID) ||
+			(module_obj->id >= IBPROF_MODULE_USER) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if ((module_call->call < 0) || (module_call->call > HASH_MAX_CALL))
+				continue;
+			if (ibprof_sample_match(module_call->name, name, len)) {
+				set(module_obj->id, module_call->call, policy);
+				matched++;
+			}
+		}
+	}
+
+	return matched;
+}
+
+static IBPROF_ERROR __policy_parse(const char *spec, const char *env_name,
+			IBPROF_MODULE_OBJECT **module_array,
+			__policy_field_fn field_fn, __policy_set_fn set_fn,
+			void *policy, size_t size)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	const char *item = spec;
+	const char *field = NULL;
+	const char *sep = NULL;
+	char *end = NULL;
+	long value = 0;
+	int len = 0;
+
+	while (item && *item) {
+		sep = sys_strchr(item, ':');
+		if (!sep) {
+			status = IBPROF_ERR_BAD_ARGUMENT;
+			break;
+		}
+		len = (int)(sep - item);
+
+		sys_memset(policy, 0, size);
+		end = (char *)sep;
+		while (*end == ':') {
+			field = end + 1;
+			sep = sys_strchr(field, '=');
+			if (!sep) {
+				status = IBPROF_ERR_BAD_ARGUMENT;
+				break;
+			}
+			value = sys_strtol(sep + 1, &end, 0);
+			if ((end == sep + 1) || (*end && (*end != ':') && (*end != ',')) ||
+				(value < 0) || !field_fn(policy, field, value)) {
+				status = IBPROF_ERR_BAD_ARGUMENT;
+				break;
+			}
+		}
+		if (status != IBPROF_ERR_NONE)
+			break;
+
+		if (!len || !__policy_set(module_array, item, len, set_fn, policy))
+			IBPROF_WARN("%s : unknown call '%.*s'\n", env_name, len, item);
+
+		item = (*end ? end + 1 : end);
+	}
+
+	if (status != IBPROF_ERR_NONE)
+		IBPROF_WARN("%s : incorrect value '%s', policies are ignored\n", env_name, spec);
+
+	return status;
+}
+
+static int __fault_field(void *policy, const char *field, long value)
+{
+	IBPROF_FAULT_POLICY *fault = (IBPROF_FAULT_POLICY *)policy;
+
+	if (!sys_strncmp(field, "ppm=", 4) && (value <= FAULT_PPM_MAX))
+		fault->ppm = (uint32_t)value;
+	else if (!sys_strncmp(field, "nth=", 4))
+		fault->nth = value;
+	else if (!sys_strncmp(field, "after=", 6))
+		fault->after = ibprof_clock_from_sec(value / 1000.0);
+	else if (!sys_strncmp(field, "burst=", 6) && (value <= INT32_MAX))
+		fault->burst = (int)value;
+	else
+		return 0;
+
+	return 1;
+}
+
+static void __fault_set(int module, int call, const void *policy)
+{
+	IBPROF_FAULT_POLICY *fault = &ibprof_fault_policy[module][call];
+
+	*fault = *(const IBPROF_FAULT_POLICY *)policy;
+
+	/* Call without trigger is never failed */
+	fault->active = (fault->ppm || fault->nth || fault->after);
+}
+
+static void __fault_default(int percent)
+{
+	IBPROF_FAULT_POLICY policy;
+	int module = 0;
+	int call = 0;
+
+	sys_memset(&policy, 0, sizeof(policy));
+	if (percent > 0) {
+		policy.active = 1;
+		policy.ppm = (percent < 100 ? (uint32_t)percent * (FAULT_PPM_MAX / 100) : FAULT_PPM_MAX);
+	}
+
+	for (module = 0; module < IBPROF_MODULE_USER; module++)
+		for (call = 0; call <= HASH_MAX_CALL; call++)
+			ibprof_fault_policy[module][call] = policy;
+}
+
+static int __delay_field(void *policy, const char *field, long value)
+{
+	IBPROF_DELAY_POLICY *delay = (IBPROF_DELAY_POLICY *)policy;
+
+	if (!sys_strncmp(field, "ns=", 3))
+		delay->ns = value;
+	else if (!sys_strncmp(field, "jitter=", 7))
+		delay->jitter = value;
+	else if (!sys_strncmp(field, "ppm=", 4) && (value > 0) && (value <= FAULT_PPM_MAX))
+		delay->ppm = (uint32_t)value;
+	else
+		return 0;
+
+	return 1;
+}
+
+static void __delay_set(int module, int call, const void *policy)
+{
+	IBPROF_DELAY_POLICY *delay = &ibprof_delay_policy[module][call];
+
+	*delay = *(const IBPROF_DELAY_POLICY *)policy;
+	if (!delay->ppm)
+		delay->ppm = FAULT_PPM_MAX;
+}
+
+/**
+ * ibprof_fault_init
+ *
+ * @brief
+ *    Sets policy of every call to fail with given percent and applies
+ *    list of call policies in form "name:key=value:key=value,name:...".
+ *    Keys are ppm (failures per million), nth (invocation that fails),
+ *    after (milliseconds since start before failures begin) and burst
+ *    (number of consecutive failures). Name matches calls as in
+ *    IBPROF_SAMPLE.
+ *
+ * @param[in]    spec            List of call policies or NULL.
+ * @param[in]    percent         Percent of failures of other calls.
+ * @param[in]    seed            Seed of random generators.
+ * @param[in]    module_array    Array of available modules.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_fault_init(const char *spec, int percent, int seed,
+			IBPROF_MODULE_OBJECT **module_array)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	IBPROF_FAULT_POLICY policy;
+
+	ibprof_fault_start = ibprof_clock_ticks();
+	ibprof_fault_base = (uint64_t)(uint32_t)seed;
+	__fault_default(percent);
+
+	status = __policy_parse(spec, "IBPROF_ERR_POLICY", module_array,
+			__fault_field, __fault_set, &policy, sizeof(policy));
+	if (status != IBPROF_ERR_NONE)
+		__fault_default(percent);
+
+	return status;
+}
+
+/**
+ * ibprof_delay_init
+ *
+ * @brief
+ *    Applies list of call delays in form "name:key=value:key=value,name:...".
+ *    Keys are ns (fixed delay), jitter (maximum of uniformly distributed
+ *    addition) and ppm (delayed invocations per million, default is all).
+ *    Clock read cost is calibrated and taken into account by busy-wait.
+ *
+ * @param[in]    spec            List of call delays or NULL.
+ * @param[in]    module_array    Array of available modules.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_delay_init(const char *spec, IBPROF_MODULE_OBJECT **module_array)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	IBPROF_DELAY_POLICY policy;
+	int64_t tm_start = 0;
+	int i = 0;
+
+	sys_memset(ibprof_delay_policy, 0, sizeof(ibprof_delay_policy));
+
+	/* Busy-wait ends one clock read after the deadline in average */
+	tm_start = ibprof_delay_now();
+	for (i = 0; i < 1000; i++)
+		ibprof_delay_now();
+	ibprof_delay_cost = (ibprof_delay_now() - tm_start) / (i + 1);
+
+	status = __policy_parse(spec, "IBPROF_DELAY", module_array,
+			__delay_field, __delay_set, &policy, sizeof(policy));
+	if (status != IBPROF_ERR_NONE)
+		sys_memset(ibprof_delay_policy, 0, sizeof(ibprof_delay_policy));
+
+	return status;
+}
+
+/**
+ * ibprof_fault_seed
+ *
+ * @brief
+ *    Return initial state of random generator of a thread.
+ *
+ * @param[in]    number          Order number of the thread.
+ *
+ * @return generator state
+ ***************************************************************************/
+uint64_t ibprof_fault_seed(int number)
+{
+	uint64_t state = ibprof_fault_base + (uint64_t)number * 0x9E3779B97F4A7C15ULL;
+
+	/* Mix seed once, so close seeds give unrelated sequences */
+	return ibprof_fault_rand(&state);
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_fault.h
+ *
+ * @brief This file is place for error injection policies
+ *         declaration and operations definition.
+ *
+ * Every call has a policy that tells when error injection mode fails it:
+ * with given probability, on Nth invocation, after a time window since
+ * start, and how many consecutive invocations fail once it happens.
+ * Decision is taken on state of the calling thread only: invocation
+ * counters and random generator (splitmix64 seeded from IBPROF_ERR_SEED
+ * and order number of the thread), so threads do not share anything on
+ * the hot path and a run is repeated by the same seed.
+ *
+ * Delay injection mode busy-waits before selected calls to emulate slow
+ * fabric. Delay is fixed or has uniformly distributed jitter and is taken
+ * with given probability from the same per-thread generator. Waiting
+ * reads monotonic clock without locks or system calls (vDSO).
+ *
+ **/
+#ifndef _IBPROF_FAULT_H_
+#define _IBPROF_FAULT_H_
+
+#define FAULT_PPM_MAX         (1000000) /* Probability scale (parts per million) */
+
+/**
+ * @struct _IBPROF_FAULT_POLICY
+ * @brief Error injection policy of a call
+ */
+typedef struct _IBPROF_FAULT_POLICY {
+	int active; /**< call can be failed */
+	uint32_t ppm; /**< probability of failure in parts per million */
+	int64_t nth; /**< invocation of a thread that fails (0 - none) */
+	int64_t after; /**< ticks since start before failures begin (0 - none) */
+	int burst; /**< number of consecutive failures */
+} IBPROF_FAULT_POLICY;
+
+/**
+ * @struct _IBPROF_DELAY_POLICY
+ * @brief Delay injection policy of a call
+ */
+typedef struct _IBPROF_DELAY_POLICY {
+	int64_t ns; /**< fixed delay in nanoseconds */
+	int64_t jitter; /**< maximum of uniformly distributed addition */
+	uint32_t ppm; /**< delayed invocations in parts per million */
+} IBPROF_DELAY_POLICY;
+
+extern int64_t ibprof_fault_start;
+extern IBPROF_FAULT_POLICY ibprof_fault_policy[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+extern int64_t ibprof_delay_cost;
+extern IBPROF_DELAY_POLICY ibprof_delay_policy[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+
+/**
+ * ibprof_fault_init
+ *
+ * @brief
+ *    Sets policy of every call to fail with given percent and applies
+ *    list of call policies in form "name:key=value:key=value,name:...".
+ *    Keys are ppm (failures per million), nth (invocation that fails),
+ *    after (milliseconds since start before failures begin) and burst
+ *    (number of consecutive failures). Name matches calls as in
+ *    IBPROF_SAMPLE.
+ *
+ * @param[in]    spec            List of call policies or NULL.
+ * @param[in]    percent         Percent of failures of other calls.
+ * @param[in]    seed            Seed of random generators.
+ * @param[in]    module_array    Array of available modules.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_fault_init(const char *spec, int percent, int seed,
+			IBPROF_MODULE_OBJECT **module_array);
+
+/**
+ * ibprof_delay_init
+ *
+ * @brief
+ *    Applies list of call delays in form "name:key=value:key=value,name:...".
+ *    Keys are ns (fixed delay), jitter (maximum of uniformly distributed
+ *    addition) and ppm (delayed invocations per million, default is all).
+ *    Clock read cost is calibrated and taken into account by busy-wait.
+ *
+ * @param[in]    spec            List of call delays or NULL.
+ * @param[in]    module_array    Array of available modules.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_delay_init(const char *spec, IBPROF_MODULE_OBJECT **module_array);
+
+/**
+ * ibprof_fault_seed
+ *
+ * @brief
+ *    Return initial state of random generator of a thread.
+ *
+ * @param[in]    number          Order number of the thread.
+ *
+ * @return generator state
+ ***************************************************************************/
+uint64_t ibprof_fault_seed(int number);
+
+/**
+ * ibprof_fault_rand
+ *
+ * @brief
+ *    Return next value of splitmix64 generator.
+ *
+ * @param[in,out] state          Generator state.
+ *
+ * @return random value
+ ***************************************************************************/
+static INLINE uint64_t ibprof_fault_rand(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+/**
+ * ibprof_delay_now
+ *
+ * @brief
+ *    Read monotonic clock used by delay injection.
+ *
+ * @retval (value) - nanoseconds
+ ***************************************************************************/
+static INLINE int64_t ibprof_delay_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * ibprof_delay_wait
+ *
+ * @brief
+ *    Busy-wait given number of nanoseconds.
+ *
+ * @param[in]    ns              Delay.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_delay_wait(int64_t ns)
+{
+	int64_t end = 0;
+
+	if (ns <= ibprof_delay_cost)
+		return;
+
+	end = ibprof_delay_now() + ns - ibprof_delay_cost;
+	while (ibprof_delay_now() < end)
+		;
+}
+
+#endif /* _IBPROF_FAULT_H_ */
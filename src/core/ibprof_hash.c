@@ -15,45 +15,95 @@
 
 #include "ibprof_hash.h"
 
-static double to_time(double t_val)
+int ibprof_warmup_number = 0;
+
+static double to_time(int64_t t_val)
 {
 	static long time_units_multiplier;
 	time_units_multiplier = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
-	return t_val * time_units_multiplier;
+	return ibprof_clock_to_sec(t_val) * time_units_multiplier;
+}
+
+static char *to_size(char *buf, size_t len, int64_t size)
+{
+	static const char *units[] = {"", "K", "M", "G", "T", "P", "E"};
+	int i = 0;
+
+	while ((size >= 1024) && !(size % 1024) && (i < (int)(sizeof(units) / sizeof(units[0])) - 1)) {
+		size /= 1024;
+		i++;
+	}
+	sys_snprintf_safe(buf, len, "%ld%s", (long)size, units[i]);
+
+	return buf;
+}
+
+/*
+ * Find element by a key without inserting it
+ */
+static IBPROF_HASH_OBJ *__hash_lookup(IBPROF_HASH_OBJECT *hash_obj, HASH_KEY key)
+{
+	IBPROF_HASH_OBJ *entry = NULL;
+	int attempts = 0;
+	int idx = key % hash_obj->size;
+
+	for (attempts = 0; attempts < hash_obj->size; attempts++) {
+		entry = &(hash_obj->hash_table[idx]);
+		if (entry->key == key)
+			return entry;
+		if (entry->key == HASH_KEY_INVALID)
+			break;
+		idx = (idx + 1) % hash_obj->size;
+	}
+
+	return NULL;
 }
 
 /****************************************************************************
  * Static Function Declarations
  ***************************************************************************/
 
+/**
+ * ibprof_hash_init
+ *
+ * @brief
+ *    Set number of first calls that are not timed. It is read once
+ *    because every update compares count of a call with it.
+ *
+ * @param[in]    warmup          Number of warmup calls.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_hash_init(int warmup)
+{
+	ibprof_warmup_number = warmup;
+
+	return IBPROF_ERR_NONE;
+}
+
 /**
  * ibprof_hash_create
  *
  * @brief
  *    Allocates memory for new hash object and set initial values.
  *
+ * @param[in]    size            Maximum number of elements.
+ *
  * @retval pointer to new hash object - on success
  * @retval NULL - on failure
  ***************************************************************************/
-IBPROF_HASH_OBJECT *ibprof_hash_create(void)
+IBPROF_HASH_OBJECT *ibprof_hash_create(int size)
 {
 	IBPROF_HASH_OBJECT *hash_obj = NULL;
 
 	hash_obj = (IBPROF_HASH_OBJECT *) sys_malloc(sizeof(IBPROF_HASH_OBJECT));
 	if (hash_obj) {
-		hash_obj->size = HASH_MAX_SIZE;
+		hash_obj->size = size;
 		hash_obj->hash_table = (IBPROF_HASH_OBJ *) sys_malloc(
 				hash_obj->size * sizeof(IBPROF_HASH_OBJ));
 		if (hash_obj->hash_table) {
-			int i = 0;
-
-			sys_memset(hash_obj->hash_table,
-					0,
-					hash_obj->size * sizeof(IBPROF_HASH_OBJ));
-			hash_obj->last = NULL;
-			hash_obj->count = 0;
-			for (i = 0; i < hash_obj->size; i++)
-				hash_obj->hash_table[i].key = HASH_KEY_INVALID;
+			ibprof_hash_clear(hash_obj);
 		} else {
 			sys_free(hash_obj);
 			hash_obj = NULL;
@@ -76,11 +126,215 @@ IBPROF_HASH_OBJECT *ibprof_hash_create(void)
 void ibprof_hash_destroy(IBPROF_HASH_OBJECT *hash_obj)
 {
 	if (hash_obj) {
+		ibprof_hash_clear(hash_obj);
 		sys_free(hash_obj->hash_table);
 		sys_free(hash_obj);
 	}
 }
 
+/**
+ * ibprof_hash_clear
+ *
+ * @brief
+ *    Removes all elements from hash object.
+ *
+ * @param[in]    hash_obj        Hash object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hash_clear(IBPROF_HASH_OBJECT *hash_obj)
+{
+	int i = 0;
+
+	for (i = 0; i < hash_obj->size; i++) {
+		if (hash_obj->hash_table[i].key != HASH_KEY_INVALID) {
+			sys_free(hash_obj->hash_table[i].call_name);
+			sys_free(hash_obj->hash_table[i].hist);
+		}
+	}
+
+	sys_memset(hash_obj->hash_table,
+			0,
+			hash_obj->size * sizeof(IBPROF_HASH_OBJ));
+	hash_obj->last = NULL;
+	hash_obj->count = 0;
+	for (i = 0; i < hash_obj->size; i++)
+		hash_obj->hash_table[i].key = HASH_KEY_INVALID;
+}
+
+/**
+ * ibprof_hash_entry_accumulate
+ *
+ * @brief
+ *    Accumulates statistics of an element into destination element
+ *    with the same key.
+ *
+ * @param[in]    dst             Destination element.
+ * @param[in]    src             Element to be added.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hash_entry_accumulate(IBPROF_HASH_OBJ *dst, IBPROF_HASH_OBJ *src)
+{
+	uint64_t *hist = NULL;
+
+	if (!dst->call_name && __atomic_load_n(&src->call_name, __ATOMIC_ACQUIRE))
+		dst->call_name = sys_strdup(src->call_name);
+	dst->count += src->count;
+	dst->samples += src->samples;
+	dst->t_tot += src->t_tot;
+	dst->t_self += src->t_self;
+	dst->t_max = sys_max(dst->t_max, src->t_max);
+	dst->t_min = sys_min(dst->t_min, src->t_min);
+	dst->mode_data.err += src->mode_data.err;
+	dst->bytes += src->bytes;
+
+	hist = __atomic_load_n(&src->hist, __ATOMIC_ACQUIRE);
+	if (hist) {
+		if (!dst->hist)
+			dst->hist = ibprof_hist_create();
+		if (dst->hist)
+			ibprof_hist_merge(dst->hist, hist);
+	}
+}
+
+/**
+ * ibprof_hash_accumulate
+ *
+ * @brief
+ *    Accumulates statistics of an element into destination hash object.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    src             Element to be added.
+ *
+ * @retval (0) - on success
+ * @retval (-1) - on failure
+ ***************************************************************************/
+int ibprof_hash_accumulate(IBPROF_HASH_OBJECT *dst_obj, IBPROF_HASH_OBJ *src)
+{
+	IBPROF_HASH_OBJ *dst = NULL;
+
+	dst = ibprof_hash_find(dst_obj, src->key);
+	if (!dst)
+		return -1;
+
+	ibprof_hash_entry_accumulate(dst, src);
+
+	return 0;
+}
+
+/**
+ * ibprof_hash_merge
+ *
+ * @brief
+ *    Accumulates all elements of source hash object into destination one.
+ *    Source can be updated by its owner thread at the same time.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    src_obj         Source hash object.
+ *
+ * @retval (count) - number of merged elements
+ ***************************************************************************/
+int ibprof_hash_merge(IBPROF_HASH_OBJECT *dst_obj, IBPROF_HASH_OBJECT *src_obj)
+{
+	IBPROF_HASH_OBJ *src = NULL;
+	HASH_KEY key;
+	int merged = 0;
+	int i = 0;
+
+	for (i = 0; i < src_obj->size; i++) {
+		src = &(src_obj->hash_table[i]);
+		key = __atomic_load_n(&src->key, __ATOMIC_ACQUIRE);
+		if (key == HASH_KEY_INVALID || src->count <= 0)
+			continue;
+
+		if (ibprof_hash_accumulate(dst_obj, src))
+			break;
+		merged++;
+	}
+
+	return merged;
+}
+
+/**
+ * ibprof_hash_subtract
+ *
+ * @brief
+ *    Turns statistics of destination hash object into increment since
+ *    earlier state of the same statistics kept in source hash object.
+ *    Bounds of durations
+ *    are restored from histograms. Elements without calls are removed.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    src_obj         Source hash object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hash_subtract(IBPROF_HASH_OBJECT *dst_obj, IBPROF_HASH_OBJECT *src_obj)
+{
+	IBPROF_HASH_OBJ *dst = NULL;
+	IBPROF_HASH_OBJ *src = NULL;
+	int64_t t_min, t_max;
+	int i = 0;
+
+	for (i = 0; i < dst_obj->size; i++) {
+		dst = &(dst_obj->hash_table[i]);
+		if (dst->key == HASH_KEY_INVALID)
+			continue;
+
+		/* Earlier state is ignored if statistics were dropped since then */
+		src = __hash_lookup(src_obj, dst->key);
+		if (src && (src->count > dst->count))
+			src = NULL;
+
+		if (src) {
+			dst->count -= src->count;
+			dst->samples -= src->samples;
+			dst->t_tot -= src->t_tot;
+			dst->t_self -= src->t_self;
+			dst->mode_data.err -= src->mode_data.err;
+			dst->bytes -= src->bytes;
+			if (dst->hist && src->hist)
+				ibprof_hist_subtract(dst->hist, src->hist);
+		}
+
+		if (dst->count <= 0) {
+			sys_free(dst->call_name);
+			sys_free(dst->hist);
+			sys_memset(dst, 0, sizeof(*dst));
+			dst->key = HASH_KEY_INVALID;
+			dst_obj->count--;
+		} else if (!ibprof_hist_range(dst->hist, &t_min, &t_max)) {
+			dst->t_min = t_min;
+			dst->t_max = t_max;
+		}
+	}
+	dst_obj->last = NULL;
+}
+
+/**
+ * ibprof_hash_update_features
+ *
+ * @brief
+ *    Return set of statistics update features (IBPROF_UPDATE_xxx)
+ *    required by current configuration. Modules use it to select
+ *    wrappers specialized for the set on initialization.
+ *
+ * @return set of features
+ ***************************************************************************/
+int ibprof_hash_update_features(void)
+{
+	int opt = 0;
+
+	if (ibprof_warmup_number > 0)
+		opt |= IBPROF_UPDATE_WARMUP;
+	if (ibprof_hist_size)
+		opt |= IBPROF_UPDATE_HIST;
+	if (ibprof_interval_calls)
+		opt |= IBPROF_UPDATE_INTERVAL;
+
+	return opt;
+}
 
 /**
  * ibprof_hash_module_total
@@ -103,8 +357,13 @@ double ibprof_hash_module_total(IBPROF_HASH_OBJECT *hash_obj,
 				continue;
 			if (rank != HASH_KEY_GET_RANK(hash_obj->hash_table[i].key))
 				continue;
+			if (HASH_KEY_GET_SIZE(hash_obj->hash_table[i].key))
+				continue;
 
-			result_total += to_time(hash_obj->hash_table[i].t_tot);
+			/* Nested user intervals are counted once */
+			result_total += to_time(module == IBPROF_MODULE_USER ?
+					hash_obj->hash_table[i].t_self :
+					hash_obj->hash_table[i].t_tot);
 		}
 	}
 
@@ -127,10 +386,15 @@ char *ibprof_hash_dump(IBPROF_HASH_OBJECT *hash_obj,
 	char *buffer = NULL;
 	char *dest = NULL;
 	char *call_name = NULL;
+	char call_id[16];
+	IBPROF_HASH_OBJ *entry = NULL;
+	static const double percent[] = {50.0, 90.0, 99.0, 99.9};
+	int64_t t_pct[] = {0, 0, 0, 0};
 	int buffer_len = 0;
 	int dest_len = 0;
 	int ret = 0;
 	int i = 0;
+	int p = 0;
 
 	if (!hash_obj || !format)
 		return NULL;
@@ -147,20 +411,23 @@ char *ibprof_hash_dump(IBPROF_HASH_OBJECT *hash_obj,
 			if (module != HASH_KEY_GET_MODULE(hash_obj->hash_table[i].key))
 				continue;
 
+			if (HASH_KEY_GET_SIZE(hash_obj->hash_table[i].key))
+				continue;
+
 			if (call == UNDEFINED_VALUE) {
-				if (!hash_obj->hash_table[i].call_name[0]) {
-					sys_snprintf_safe(hash_obj->hash_table[i].call_name,
-							  sizeof(hash_obj->hash_table[i].call_name) - 1,
+				call_name = hash_obj->hash_table[i].call_name;
+				if (!call_name) {
+					sys_snprintf_safe(call_id, sizeof(call_id),
 							  "%d", HASH_KEY_GET_CALL(hash_obj->hash_table[i].key));
+					call_name = call_id;
 				}
-				call_name = hash_obj->hash_table[i].call_name;
 			} else if (call	!= HASH_KEY_GET_CALL(hash_obj->hash_table[i].key))
 				continue;
 
 			if (rank != HASH_KEY_GET_RANK(hash_obj->hash_table[i].key))
 				continue;
 
-			if (dest_len > (buffer_len - 100)) {
+			if (dest_len > (buffer_len - 512)) {
 				buffer_len += 1024;
 				buffer = realloc(buffer, buffer_len);
 				if (!buffer) {
@@ -170,30 +437,59 @@ char *ibprof_hash_dump(IBPROF_HASH_OBJECT *hash_obj,
 				dest = buffer;
 			}
 
-			switch (ibprof_conf_get_mode(module)) {
+			entry = &hash_obj->hash_table[i];
+			if (ibprof_hist_size) {
+				for (p = 0; p < (int)(sizeof(percent) / sizeof(percent[0])); p++) {
+					t_pct[p] = ibprof_hist_percentile(entry->hist, percent[p]);
+					t_pct[p] = sys_max(sys_min(t_pct[p], entry->t_max),
+							(entry->samples > 0 ? entry->t_min : 0));
+				}
+			}
+
+			switch (module == IBPROF_MODULE_USER ? IBPROF_MODE_NONE : ibprof_conf_get_mode(module)) {
+			case IBPROF_MODE_NONE:
+				/* Self time of user intervals follows total one */
+				ret = sys_snprintf_safe((dest + dest_len),
+							(buffer_len - dest_len), "%s",
+							format(module, call_name, "%ld %f %f %f %f %f %f %f %f %f",
+							entry->count,
+							to_time(entry->t_tot),
+							to_time(entry->t_self),
+							(entry->samples > 0 ?
+					to_time(entry->t_tot) / entry->samples : 0),
+							to_time(entry->t_max),
+							(entry->samples > 0 ? to_time(entry->t_min) : 0),
+							to_time(t_pct[0]), to_time(t_pct[1]),
+							to_time(t_pct[2]), to_time(t_pct[3])));
+				break;
+
 			case IBPROF_MODE_ERR:
 				ret = sys_snprintf_safe((dest + dest_len),
 							(buffer_len - dest_len), "%s",
-							format(module, call_name, "%ld %f %f %f %f %ld",
-							hash_obj->hash_table[i].count,
-	                        to_time(hash_obj->hash_table[i].t_tot),
-	                        (hash_obj->hash_table[i].count > 0 ? 
-					to_time(hash_obj->hash_table[i].t_tot) / (hash_obj->hash_table[i].count - ibprof_conf_get_int(IBPROF_WARMUP_NUMBER)) : 0),
-	                        to_time(hash_obj->hash_table[i].t_max),
-	                        (hash_obj->hash_table[i].count > 0 ? to_time(hash_obj->hash_table[i].t_min) : 0),
-							hash_obj->hash_table[i].mode_data.err));
+							format(module, call_name, "%ld %f %f %f %f %ld %f %f %f %f",
+							entry->count,
+	                        to_time(entry->t_tot),
+	                        (entry->samples > 0 ?
+					to_time(entry->t_tot) / entry->samples : 0),
+	                        to_time(entry->t_max),
+	                        (entry->samples > 0 ? to_time(entry->t_min) : 0),
+							entry->mode_data.err,
+							to_time(t_pct[0]), to_time(t_pct[1]),
+							to_time(t_pct[2]), to_time(t_pct[3])));
 				break;
 
 			default:
 				ret = sys_snprintf_safe((dest + dest_len),
 							(buffer_len - dest_len), "%s",
-							format(module, call_name, "%ld %f %f %f %f",
-							hash_obj->hash_table[i].count,
-	                        to_time(hash_obj->hash_table[i].t_tot),
-	                        (hash_obj->hash_table[i].count > 0 ?
-					to_time(hash_obj->hash_table[i].t_tot) / (hash_obj->hash_table[i].count - ibprof_conf_get_int(IBPROF_WARMUP_NUMBER)) : 0),
-	                        to_time(hash_obj->hash_table[i].t_max),
-	                        (hash_obj->hash_table[i].count > 0 ? to_time(hash_obj->hash_table[i].t_min) : 0)));
+							format(module, call_name, "%ld %f %f %f %f %f %f %f %f",
+							entry->count,
+	                        to_time(entry->t_tot),
+	                        (entry->samples > 0 ?
+					to_time(entry->t_tot) / entry->samples : 0),
+	                        to_time(entry->t_max),
+	                        (entry->samples > 0 ? to_time(entry->t_min) : 0),
+							to_time(t_pct[0]), to_time(t_pct[1]),
+							to_time(t_pct[2]), to_time(t_pct[3])));
 				break;
 			}
 			if (ret >= 0) {
@@ -215,3 +511,77 @@ char *ibprof_hash_dump(IBPROF_HASH_OBJECT *hash_obj,
 
 	return (ret > 0 ? buffer : NULL);
 }
+
+/**
+ * ibprof_hash_dump_size
+ *
+ * @brief
+ *    Dump collected calls split by message size class.
+ *    Statistics are passed to format as count, total, avg, max, min
+ *    and bandwidth (MB/s), call_name is size class description.
+ *
+ * @return formatted string
+ ***************************************************************************/
+char *ibprof_hash_dump_size(IBPROF_HASH_OBJECT *hash_obj,
+				int module,
+				int call,
+				int rank,
+				const char *(*format)(int module, const char* call_name, const char* stats_fmt, ...)) {
+	IBPROF_HASH_OBJ *size_class[HASH_MAX_SIZE_CLASS];
+	IBPROF_HASH_OBJ *entry = NULL;
+	char *buffer = NULL;
+	char *str = NULL;
+	char class_name[64];
+	char low[16];
+	char high[16];
+	int count = 0;
+	int ret = 0;
+	int i = 0;
+
+	if (!hash_obj || !format)
+		return NULL;
+
+	sys_memset(size_class, 0, sizeof(size_class));
+	for (i = 0; i < hash_obj->size; i++) {
+		entry = &hash_obj->hash_table[i];
+		if ((entry->key == HASH_KEY_INVALID) ||
+			(module != HASH_KEY_GET_MODULE(entry->key)) ||
+			(call != HASH_KEY_GET_CALL(entry->key)) ||
+			(rank != HASH_KEY_GET_RANK(entry->key)) ||
+			!HASH_KEY_GET_SIZE(entry->key) ||
+			(HASH_KEY_GET_SIZE(entry->key) >= HASH_MAX_SIZE_CLASS))
+			continue;
+
+		size_class[HASH_KEY_GET_SIZE(entry->key)] = entry;
+		count++;
+	}
+
+	for (i = 1; (i < HASH_MAX_SIZE_CLASS) && count && (ret >= 0); i++) {
+		entry = size_class[i];
+		if (!entry || (entry->count <= 0))
+			continue;
+
+		if (i == 1)
+			sys_snprintf_safe(class_name, sizeof(class_name), "0");
+		else
+			sys_snprintf_safe(class_name, sizeof(class_name), "%s..%s",
+					to_size(low, sizeof(low), (int64_t)1 << (i - 2)),
+					to_size(high, sizeof(high), (int64_t)1 << (i - 1)));
+
+		ret = sys_asprintf(&str, "%s%s%s",
+				(buffer ? buffer : ""),
+				format(module, class_name, "%ld %f %f %f %f %f",
+					entry->count,
+					to_time(entry->t_tot),
+					(entry->samples > 0 ? to_time(entry->t_tot) / entry->samples : 0),
+					to_time(entry->t_max),
+					(entry->samples > 0 ? to_time(entry->t_min) : 0),
+					(entry->t_tot > 0 ? entry->bytes / ibprof_clock_to_sec(entry->t_tot) * 1.0e-6 : 0)),
+				"\n");
+		sys_free(buffer);
+		buffer = str;
+		str = NULL;
+	}
+
+	return buffer;
+}
@@ -26,6 +26,12 @@
 #define HASH_MAX_CALL 0xFF
 #define HASH_MAX_RANK 0xFFFF
 
+/* Features of statistics update, wrappers are specialized by them */
+#define IBPROF_UPDATE_WARMUP    0x1 /* first IBPROF_WARMUP_NUMBER calls are not timed */
+#define IBPROF_UPDATE_HIST      0x2 /* latency histogram */
+#define IBPROF_UPDATE_INTERVAL  0x4 /* call is charged to enclosing user interval */
+#define IBPROF_UPDATE_ALL       (IBPROF_UPDATE_WARMUP | IBPROF_UPDATE_HIST | IBPROF_UPDATE_INTERVAL)
+
 #define HASH_KEY_SET(module, call, rank, size)  \
 	(                                           \
 	(((uint64_t)(module) << 60) & 0xF000000000000000) |   \
@@ -37,20 +43,50 @@
 #define HASH_KEY_GET_MODULE(key)           (int)(((key) & 0xF000000000000000) >> 60)  /* 4bits by offset 59 */
 #define HASH_KEY_GET_CALL(key)             (int)(((key) & 0x0FF0000000000000) >> 52)  /* 8bits by offset 51 */
 #define HASH_KEY_GET_RANK(key)             (int)(((key) & 0x000FFFF000000000) >> 36)  /* 16bits by offset 35 */
-#define HASH_KEY_GET_SIZE(key)             (int)(((key) & 0x00000000FFFFFFFF) >> 0)   /* 32bits by offset 0 */
+#define HASH_KEY_GET_SIZE(key)             \
+	(HASH_KEY_GET_MODULE(key) == IBPROF_MODULE_USER ? 0 : (int)(((key) & 0x00000000FFFFFFFF) >> 0))   /* 32bits by offset 0 */
+
+/*
+ * User defined intervals have no size classes, so interval id takes
+ * call field as low 8 bits and size field as the rest of bits.
+ */
+#define HASH_KEY_SET_INTERVAL(id, rank)  \
+	(HASH_KEY_SET(IBPROF_MODULE_USER, (id), (rank), ((uint64_t)(id) >> 8)))
+#define HASH_KEY_GET_INTERVAL(key)         \
+	(int)(HASH_KEY_GET_CALL(key) | (((key) & 0x00000000007FFFFF) << 8))
+
+/*
+ * Size field of a key keeps power of two class of message size:
+ * 0 - statistics of a call regardless of size,
+ * 1 - zero length messages,
+ * k - messages of [2^(k-2), 2^(k-1)) bytes.
+ */
+#define HASH_MAX_SIZE_CLASS    (66)
+#define HASH_SIZE_CLASS(size)  ((size) ? (65 - __builtin_clzll((uint64_t)(size))) : 1)
+
+/*
+ * Size field above size classes keeps user interval a call is made in
+ * (IBPROF_INTERVAL_CALLS), such elements are not size classes.
+ */
+#define HASH_SIZE_INTERVAL(id)     ((uint64_t)(id) + HASH_MAX_SIZE_CLASS)
+#define HASH_KEY_IS_INTERVAL(key)  (HASH_KEY_GET_SIZE(key) >= HASH_MAX_SIZE_CLASS)
 
 /**
  * @struct _IBPROF_HASH_OBJ
  * @brief It is an object to be stored
  */
 typedef struct _IBPROF_HASH_OBJ {
-	double t_min; /**< minimum time spent in a call */
-	double t_max; /**< maximum time spent in a call */
-	double t_tot; /**< total time spent in a call */
+	int64_t t_min; /**< minimum time spent in a call (ticks) */
+	int64_t t_max; /**< maximum time spent in a call (ticks) */
+	int64_t t_tot; /**< total time spent in a call (ticks) */
+	int64_t t_self; /**< time out of nested user intervals (ticks) */
 	int64_t count; /**< number of calls */
+	int64_t samples; /**< number of calls timed after warmup */
 	HASH_KEY key; /**< key */
-	double t_start; /**< start timer */
-	char call_name[100];
+	int64_t t_start; /**< start timer (ticks) */
+	char *call_name; /**< name of user defined call */
+	uint64_t *hist; /**< latency histogram (allocated on first use) */
+	int64_t bytes; /**< amount of transferred data */
 	union {
 		int64_t err;
 	} mode_data;
@@ -67,16 +103,33 @@ typedef struct _IBPROF_HASH_OBJECT {
 	int count; /**< current count of elements */
 } IBPROF_HASH_OBJECT;
 
+extern int ibprof_warmup_number;
+
+/**
+ * ibprof_hash_init
+ *
+ * @brief
+ *    Set number of first calls that are not timed.
+ *
+ * @param[in]    warmup          Number of warmup calls.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_hash_init(int warmup);
+
 /**
  * ibprof_hash_create
  *
  * @brief
  *    Allocates memory for new hash object and set initial values.
  *
+ * @param[in]    size            Maximum number of elements.
+ *
  * @retval pointer to new hash object - on success
  * @retval NULL - on failure
  ***************************************************************************/
-IBPROF_HASH_OBJECT *ibprof_hash_create(void);
+IBPROF_HASH_OBJECT *ibprof_hash_create(int size);
 
 /**
  * ibprof_hash_destroy
@@ -90,6 +143,119 @@ IBPROF_HASH_OBJECT *ibprof_hash_create(void);
  ***************************************************************************/
 void ibprof_hash_destroy(IBPROF_HASH_OBJECT *hash_obj);
 
+/**
+ * ibprof_hash_clear
+ *
+ * @brief
+ *    Removes all elements from hash object.
+ *
+ * @param[in]    hash_obj        Hash object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hash_clear(IBPROF_HASH_OBJECT *hash_obj);
+
+/**
+ * ibprof_hash_merge
+ *
+ * @brief
+ *    Accumulates all elements of source hash object into destination one.
+ *    Source can be updated by its owner thread at the same time.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    src_obj         Source hash object.
+ *
+ * @retval (count) - number of merged elements
+ ***************************************************************************/
+int ibprof_hash_merge(IBPROF_HASH_OBJECT *dst_obj, IBPROF_HASH_OBJECT *src_obj);
+
+/**
+ * ibprof_hash_subtract
+ *
+ * @brief
+ *    Turns statistics of destination hash object into increment since
+ *    earlier state of the same statistics kept in source hash object.
+ *    Bounds of durations
+ *    are restored from histograms. Elements without calls are removed.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    src_obj         Source hash object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hash_subtract(IBPROF_HASH_OBJECT *dst_obj, IBPROF_HASH_OBJECT *src_obj);
+
+/**
+ * ibprof_hash_entry_accumulate
+ *
+ * @brief
+ *    Accumulates statistics of an element into destination element
+ *    with the same key.
+ *
+ * @param[in]    dst             Destination element.
+ * @param[in]    src             Element to be added.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hash_entry_accumulate(IBPROF_HASH_OBJ *dst, IBPROF_HASH_OBJ *src);
+
+/**
+ * ibprof_hash_accumulate
+ *
+ * @brief
+ *    Accumulates statistics of an element into destination hash object.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    src             Element to be added.
+ *
+ * @retval (0) - on success
+ * @retval (-1) - on failure
+ ***************************************************************************/
+int ibprof_hash_accumulate(IBPROF_HASH_OBJECT *dst_obj, IBPROF_HASH_OBJ *src);
+
+/**
+ * ibprof_hash_entry_init
+ *
+ * @brief
+ *    Set initial values of an element except a key.
+ *    Allocated name and histogram are kept.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_hash_entry_init(IBPROF_HASH_OBJ *entry)
+{
+	entry->count = 0;
+	entry->samples = 0;
+	entry->t_start = UNDEFINED_VALUE;
+	entry->t_tot = 0;
+	entry->t_self = 0;
+	entry->t_max = 0;
+	entry->t_min = INT64_MAX;
+	entry->mode_data.err = 0;
+	entry->bytes = 0;
+	if (entry->hist)
+		sys_memset(entry->hist, 0, ibprof_hist_size * sizeof(uint64_t));
+}
+
+/**
+ * ibprof_hash_entry_hist
+ *
+ * @brief
+ *    Put a value into histogram of an element.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_hash_entry_hist(IBPROF_HASH_OBJ *entry, int64_t tm)
+{
+	if (ibprof_hist_size) {
+		/* Publish allocated histogram for concurrent merge */
+		if (!entry->hist)
+			__atomic_store_n(&entry->hist, ibprof_hist_create(), __ATOMIC_RELEASE);
+		if (entry->hist)
+			ibprof_hist_add(entry->hist, tm);
+	}
+}
+
 /**
  * ibprof_hash_find
  *
@@ -118,14 +284,9 @@ static INLINE IBPROF_HASH_OBJ *ibprof_hash_find(IBPROF_HASH_OBJECT *hash_obj,
 
 		if ((hash_obj->count < hash_obj->size) &&
 			(entry->key == HASH_KEY_INVALID)) {
-			sys_memset(entry, 0, sizeof(*entry));
-			entry->key = key;
-			entry->count = 0;
-			entry->t_start = UNDEFINED_VALUE;
-			entry->t_tot = 0.0;
-			entry->t_max = 0.0;
-			entry->t_min = DBL_MAX;
-			entry->call_name[0]=0;
+			ibprof_hash_entry_init(entry);
+			/* Publish initialized entry for concurrent merge */
+			__atomic_store_n(&entry->key, key, __ATOMIC_RELEASE);
 			hash_obj->count++;
 			break;
 		} else {
@@ -144,29 +305,56 @@ static INLINE IBPROF_HASH_OBJ *ibprof_hash_find(IBPROF_HASH_OBJECT *hash_obj,
 }
 
 /**
- * ibprof_hash_update
+ * ibprof_hash_update_opt
  *
  * @brief
- *    Update element in hash object.
+ *    Update element in hash object with set of features known
+ *    at compile time (IBPROF_UPDATE_xxx), so branches of disabled
+ *    features are removed from the caller.
+ *
+ * @param[in]    hash_obj        Hash object.
+ * @param[in]    entry           Element to update.
+ * @param[in]    tm              Time spent in a call.
+ * @param[in]    opt             Features (constant expression).
  *
  * @return @a none
  ***************************************************************************/
-static INLINE void ibprof_hash_update(IBPROF_HASH_OBJECT *hash_obj,
+static INLINE void ibprof_hash_update_opt(IBPROF_HASH_OBJECT *hash_obj,
 					IBPROF_HASH_OBJ *entry,
-					double tm)
+					int64_t tm,
+					int opt)
 {
 	if (entry) {
 		entry->count++;
-		if (entry->count > ibprof_conf_get_int(IBPROF_WARMUP_NUMBER)){
+		if (!(opt & IBPROF_UPDATE_WARMUP) ||
+			(entry->count > ibprof_warmup_number)) {
+			entry->samples++;
 			entry->t_tot += tm;
 			entry->t_max = sys_max(entry->t_max, tm);
 			entry->t_min = sys_min(entry->t_min, tm);
+			if (opt & IBPROF_UPDATE_HIST)
+				ibprof_hash_entry_hist(entry, tm);
 		}
 	}
 
 	return;
 }
 
+/**
+ * ibprof_hash_update
+ *
+ * @brief
+ *    Update element in hash object.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_hash_update(IBPROF_HASH_OBJECT *hash_obj,
+					IBPROF_HASH_OBJ *entry,
+					int64_t tm)
+{
+	ibprof_hash_update_opt(hash_obj, entry, tm, IBPROF_UPDATE_ALL);
+}
+
 /**
  * ibprof_hash_update_ex
  *
@@ -178,15 +366,17 @@ static INLINE void ibprof_hash_update(IBPROF_HASH_OBJECT *hash_obj,
  ***************************************************************************/
 static INLINE void ibprof_hash_update_ex(IBPROF_HASH_OBJECT *hash_obj,
 					IBPROF_HASH_OBJ *entry,
-					double tm,
+					int64_t tm,
 					void *ctx)
 {
 	if (entry) {
 		entry->count++;
-		if (entry->count > ibprof_conf_get_int(IBPROF_WARMUP_NUMBER)){
+		if (entry->count > ibprof_warmup_number){
+			entry->samples++;
 			entry->t_tot += tm;
 			entry->t_max = sys_max(entry->t_max, tm);
 			entry->t_min = sys_min(entry->t_min, tm);
+			ibprof_hash_entry_hist(entry, tm);
 			if (ctx) {
 				/* Update mode specific data */
 				switch (ibprof_conf_get_mode(HASH_KEY_GET_MODULE(entry->key))) {
@@ -205,6 +395,73 @@ static INLINE void ibprof_hash_update_ex(IBPROF_HASH_OBJECT *hash_obj,
 	return;
 }
 
+/**
+ * ibprof_hash_update_size_opt
+ *
+ * @brief
+ *    Update element that collects calls of the same message size class
+ *    with set of features known at compile time (IBPROF_UPDATE_xxx).
+ *
+ * @param[in]    hash_obj        Hash object.
+ * @param[in]    key             Key of a call regardless of size.
+ * @param[in]    tm              Time spent in a call.
+ * @param[in]    size            Message size.
+ * @param[in]    opt             Features (constant expression).
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_hash_update_size_opt(IBPROF_HASH_OBJECT *hash_obj,
+					HASH_KEY key,
+					int64_t tm,
+					int64_t size,
+					int opt)
+{
+	IBPROF_HASH_OBJ *entry = NULL;
+
+	entry = ibprof_hash_find(hash_obj, key | HASH_SIZE_CLASS(size));
+	if (entry) {
+		ibprof_hash_update_opt(hash_obj, entry, tm, opt);
+		if (!(opt & IBPROF_UPDATE_WARMUP) ||
+			(entry->count > ibprof_warmup_number))
+			entry->bytes += size;
+	}
+
+	return;
+}
+
+/**
+ * ibprof_hash_update_size
+ *
+ * @brief
+ *    Update element that collects calls of the same message size class.
+ *
+ * @param[in]    hash_obj        Hash object.
+ * @param[in]    key             Key of a call regardless of size.
+ * @param[in]    tm              Time spent in a call.
+ * @param[in]    size            Message size.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_hash_update_size(IBPROF_HASH_OBJECT *hash_obj,
+					HASH_KEY key,
+					int64_t tm,
+					int64_t size)
+{
+	ibprof_hash_update_size_opt(hash_obj, key, tm, size, IBPROF_UPDATE_ALL);
+}
+
+/**
+ * ibprof_hash_update_features
+ *
+ * @brief
+ *    Return set of statistics update features (IBPROF_UPDATE_xxx)
+ *    required by current configuration. Modules use it to select
+ *    wrappers specialized for the set on initialization.
+ *
+ * @return set of features
+ ***************************************************************************/
+int ibprof_hash_update_features(void);
+
 /**
  * ibprof_hash_module_total
  *
@@ -229,6 +486,20 @@ char *ibprof_hash_dump(IBPROF_HASH_OBJECT *hash_obj,
 		int module, int call, int rank,
 		const char *(*format)(int module, const char* call_name, const char* stats_fmt, ...));
 
+/**
+ * ibprof_hash_dump_size
+ *
+ * @brief
+ *    Dump collected calls split by message size class.
+ *    Statistics are passed to format as count, total, avg, max, min
+ *    and bandwidth (MB/s), call_name is size class description.
+ *
+ * @return formatted string
+ ***************************************************************************/
+char *ibprof_hash_dump_size(IBPROF_HASH_OBJECT *hash_obj,
+		int module, int call, int rank,
+		const char *(*format)(int module, const char* call_name, const char* stats_fmt, ...));
+
 /**
  * ibprof_hash_count
  *
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+int ibprof_hist_bits = 0;
+
+int ibprof_hist_size = 0;
+
+/*
+ * Restore bucket range from its index
+ */
+static void __hist_bucket(int i, int64_t *low, int64_t *high)
+{
+	int shift = sys_max((i >> ibprof_hist_bits) - 1, 0);
+
+	*low = (int64_t)(i - (shift << ibprof_hist_bits)) << shift;
+	*high = *low + ((int64_t)1 << shift) - 1;
+}
+
+/**
+ * ibprof_hist_init
+ *
+ * @brief
+ *    Set histogram precision.
+ *
+ * @param[in]    bits            Number of sub-bucket bits (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_hist_init(int bits)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+
+	if ((bits < 0) || (bits > HIST_MAX_BITS)) {
+		status = IBPROF_ERR_BAD_ARGUMENT;
+		IBPROF_WARN("%s : error=%d - Histogram bits %d is out of range [0..%d], %d is used\n",
+				__FUNCTION__, status, bits, HIST_MAX_BITS, HIST_MAX_BITS);
+		bits = HIST_MAX_BITS;
+	}
+
+	ibprof_hist_bits = bits;
+	ibprof_hist_size = (bits ? ((64 - bits) << bits) : 0);
+
+	return status;
+}
+
+/**
+ * ibprof_hist_create
+ *
+ * @brief
+ *    Allocates memory for new histogram.
+ *
+ * @retval pointer to new histogram - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+uint64_t *ibprof_hist_create(void)
+{
+	if (!ibprof_hist_size)
+		return NULL;
+
+	return (uint64_t *) sys_malloc(ibprof_hist_size * sizeof(uint64_t));
+}
+
+/**
+ * ibprof_hist_merge
+ *
+ * @brief
+ *    Accumulates source histogram into destination one.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hist_merge(uint64_t *dst, const uint64_t *src)
+{
+	int i = 0;
+
+	for (i = 0; i < ibprof_hist_size; i++)
+		dst[i] += src[i];
+}
+
+/**
+ * ibprof_hist_subtract
+ *
+ * @brief
+ *    Removes samples of source histogram from destination one.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hist_subtract(uint64_t *dst, const uint64_t *src)
+{
+	int i = 0;
+
+	for (i = 0; i < ibprof_hist_size; i++)
+		dst[i] -= sys_min(dst[i], src[i]);
+}
+
+/**
+ * ibprof_hist_range
+ *
+ * @brief
+ *    Return bounds of non-empty buckets.
+ *
+ * @param[in]    hist            Histogram.
+ * @param[out]   min             Low bound of the first non-empty bucket.
+ * @param[out]   max             High bound of the last non-empty bucket.
+ *
+ * @retval (0) - on success
+ * @retval (-1) - histogram is empty
+ ***************************************************************************/
+int ibprof_hist_range(const uint64_t *hist, int64_t *min, int64_t *max)
+{
+	int64_t low, high;
+	int first = -1;
+	int last = -1;
+	int i = 0;
+
+	if (!hist)
+		return -1;
+
+	for (i = 0; i < ibprof_hist_size; i++) {
+		if (hist[i]) {
+			first = (first < 0 ? i : first);
+			last = i;
+		}
+	}
+	if (first < 0)
+		return -1;
+
+	__hist_bucket(first, &low, &high);
+	*min = low;
+	__hist_bucket(last, &low, &high);
+	*max = high;
+
+	return 0;
+}
+
+/**
+ * ibprof_hist_percentile
+ *
+ * @brief
+ *    Return value below which given percent of samples falls.
+ *
+ * @param[in]    hist            Histogram.
+ * @param[in]    percent         Percentile (0-100).
+ *
+ * @retval (value) - middle of bucket that contains percentile
+ ***************************************************************************/
+int64_t ibprof_hist_percentile(const uint64_t *hist, double percent)
+{
+	uint64_t total = 0;
+	uint64_t rank = 0;
+	uint64_t sum = 0;
+	int64_t low, high;
+	int i = 0;
+
+	if (!hist)
+		return 0;
+
+	for (i = 0; i < ibprof_hist_size; i++)
+		total += hist[i];
+	if (!total)
+		return 0;
+
+	rank = (uint64_t)(total * percent / 100.0 + 0.5);
+	rank = sys_max(rank, 1);
+
+	for (i = 0; i < ibprof_hist_size - 1; i++) {
+		sum += hist[i];
+		if (sum >= rank)
+			break;
+	}
+
+	__hist_bucket(i, &low, &high);
+
+	return low + (high - low) / 2;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_hist.h
+ *
+ * @brief This file is place for latency histogram
+ *         declaration and operations definition.
+ *
+ * Histogram is log-linear (HDR-like): every power of two range of values
+ * is split into 2^bits linear sub-buckets, so relative error of reported
+ * value does not exceed 2^-bits. Value v goes to the bucket
+ *
+ *     shift = msb(v | 2^bits) - bits
+ *     index = (shift << bits) + (v >> shift)
+ *
+ * that is calculated without branches.
+ *
+ **/
+#ifndef _IBPROF_HIST_H_
+#define _IBPROF_HIST_H_
+
+#define HIST_MAX_BITS     7 /* Limits memory per call to 57 * 128 counters */
+
+extern int ibprof_hist_bits;
+
+extern int ibprof_hist_size;
+
+/**
+ * ibprof_hist_init
+ *
+ * @brief
+ *    Set histogram precision.
+ *
+ * @param[in]    bits            Number of sub-bucket bits (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_hist_init(int bits);
+
+/**
+ * ibprof_hist_create
+ *
+ * @brief
+ *    Allocates memory for new histogram.
+ *
+ * @retval pointer to new histogram - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+uint64_t *ibprof_hist_create(void);
+
+/**
+ * ibprof_hist_merge
+ *
+ * @brief
+ *    Accumulates source histogram into destination one.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hist_merge(uint64_t *dst, const uint64_t *src);
+
+/**
+ * ibprof_hist_subtract
+ *
+ * @brief
+ *    Removes samples of source histogram from destination one.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_hist_subtract(uint64_t *dst, const uint64_t *src);
+
+/**
+ * ibprof_hist_range
+ *
+ * @brief
+ *    Return bounds of non-empty buckets.
+ *
+ * @param[in]    hist            Histogram.
+ * @param[out]   min             Low bound of the first non-empty bucket.
+ * @param[out]   max             High bound of the last non-empty bucket.
+ *
+ * @retval (0) - on success
+ * @retval (-1) - histogram is empty
+ ***************************************************************************/
+int ibprof_hist_range(const uint64_t *hist, int64_t *min, int64_t *max);
+
+/**
+ * ibprof_hist_percentile
+ *
+ * @brief
+ *    Return value below which given percent of samples falls.
+ *
+ * @param[in]    hist            Histogram.
+ * @param[in]    percent         Percentile (0-100).
+ *
+ * @retval (value) - middle of bucket that contains percentile
+ ***************************************************************************/
+int64_t ibprof_hist_percentile(const uint64_t *hist, double percent);
+
+/**
+ * ibprof_hist_index
+ *
+ * @brief
+ *    Calculate bucket index for a value.
+ *
+ * @retval (index) - bucket index
+ ***************************************************************************/
+static INLINE int ibprof_hist_index(int64_t value)
+{
+	uint64_t v = (uint64_t)(value > 0 ? value : 0);
+	int shift = (63 - __builtin_clzll(v | (1ULL << ibprof_hist_bits))) - ibprof_hist_bits;
+
+	return (shift << ibprof_hist_bits) + (int)(v >> shift);
+}
+
+/**
+ * ibprof_hist_add
+ *
+ * @brief
+ *    Add a value into histogram.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_hist_add(uint64_t *hist, int64_t value)
+{
+	hist[ibprof_hist_index(value)]++;
+}
+
+#endif /* _IBPROF_HIST_H_ */
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+/*
+ * Registered names are never changed after publication,
+ * so they are looked up without the lock
+ */
+typedef struct _INTERVAL_NAME {
+	int id;
+	char *name;
+	struct _INTERVAL_NAME *next;
+} INTERVAL_NAME;
+
+int ibprof_interval_calls = 0;
+
+static INTERVAL_NAME *interval_names = NULL;
+static int interval_last = HASH_MAX_CALL;
+
+static int __interval_call_compare(const void *a, const void *b)
+{
+	int64_t t_a = (*(IBPROF_HASH_OBJ * const *)a)->t_tot;
+	int64_t t_b = (*(IBPROF_HASH_OBJ * const *)b)->t_tot;
+
+	return (t_a > t_b ? -1 : (t_a < t_b));
+}
+
+static const char *__interval_name(int id)
+{
+	INTERVAL_NAME *item = NULL;
+
+	for (item = __atomic_load_n(&interval_names, __ATOMIC_ACQUIRE); item; item = item->next)
+		if (item->id == id)
+			return item->name;
+
+	return NULL;
+}
+
+static void __interval_leave(IBPROF_INTERVAL_STACK *stack, IBPROF_HASH_OBJECT *hash_obj,
+			int64_t t_end)
+{
+	IBPROF_INTERVAL_FRAME *frame = &stack->frame[--stack->depth];
+	IBPROF_HASH_OBJ *entry = NULL;
+	const char *name = NULL;
+	int64_t tm = ibprof_clock_sub(t_end - frame->t_start);
+	int64_t t_self = sys_max(tm - frame->t_nested, 0);
+
+	if (stack->depth)
+		stack->frame[stack->depth - 1].t_nested += tm;
+
+	/* Element is dropped if statistics were dumped since the interval is entered */
+	entry = frame->entry;
+	if (!entry || (entry->key != frame->key))
+		entry = ibprof_hash_find(hash_obj, frame->key);
+	if (!entry)
+		return;
+
+	if (!entry->call_name &&
+		(name = __interval_name(HASH_KEY_GET_INTERVAL(frame->key))))
+		__atomic_store_n(&entry->call_name, sys_strdup(name), __ATOMIC_RELEASE);
+
+	entry->count++;
+	if (entry->count > ibprof_warmup_number) {
+		entry->samples++;
+		/* Time of recursive entry is covered by the outermost one */
+		if (!frame->recursive)
+			entry->t_tot += tm;
+		entry->t_self += t_self;
+		entry->t_max = sys_max(entry->t_max, tm);
+		entry->t_min = sys_min(entry->t_min, tm);
+		ibprof_hash_entry_hist(entry, tm);
+	}
+}
+
+/**
+ * ibprof_interval_init
+ *
+ * @brief
+ *    Set if library calls are charged to user intervals.
+ *
+ * @param[in]    calls           Charge library calls (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_interval_init(int calls)
+{
+	ibprof_interval_calls = (calls != 0);
+
+	return IBPROF_ERR_NONE;
+}
+
+/**
+ * ibprof_interval_register_name
+ *
+ * @brief
+ *    Return handle of named interval. Handle of new name is allocated,
+ *    the same name always gets the same handle.
+ *
+ * @param[in]    name            Name of interval.
+ *
+ * @retval (handle) - on success
+ * @retval (-1) - on failure
+ ***************************************************************************/
+int ibprof_interval_register_name(const char *name)
+{
+	INTERVAL_NAME *item = NULL;
+	int id = UNDEFINED_VALUE;
+
+	if (!ibprof_obj || !name)
+		return UNDEFINED_VALUE;
+
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	for (item = interval_names; item; item = item->next) {
+		if (!sys_strcmp(item->name, name)) {
+			id = item->id;
+			break;
+		}
+	}
+
+	if (!item && (interval_last < INTERVAL_MAX_ID) &&
+		(item = (INTERVAL_NAME *)sys_malloc(sizeof(*item)))) {
+		item->name = sys_strdup(name);
+		if (item->name) {
+			item->id = id = ++interval_last;
+			item->next = interval_names;
+			__atomic_store_n(&interval_names, item, __ATOMIC_RELEASE);
+		} else
+			sys_free(item);
+	}
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+	return id;
+}
+
+/**
+ * ibprof_interval_destroy
+ *
+ * @brief
+ *    Releases registered names.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_destroy(void)
+{
+	INTERVAL_NAME *item = NULL;
+
+	while ((item = interval_names)) {
+		interval_names = item->next;
+		sys_free(item->name);
+		sys_free(item);
+	}
+	interval_last = HASH_MAX_CALL;
+}
+
+/**
+ * ibprof_interval_push
+ *
+ * @brief
+ *    Enter an interval on stack of the thread.
+ *
+ * @param[in]    stack           Interval stack of the thread.
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    id              Interval id or handle.
+ * @param[in]    rank            Process rank.
+ * @param[in]    name            Name of interval or NULL.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_push(IBPROF_INTERVAL_STACK *stack, IBPROF_HASH_OBJECT *hash_obj,
+			int id, int rank, const char *name)
+{
+	IBPROF_INTERVAL_FRAME *frame = NULL;
+	IBPROF_HASH_OBJ *entry = NULL;
+	HASH_KEY key = HASH_KEY_SET_INTERVAL(id, rank);
+	int i = 0;
+
+	/* Intervals beyond maximum depth are not measured */
+	if (stack->lost || (stack->depth == INTERVAL_MAX_DEPTH)) {
+		stack->lost++;
+		return;
+	}
+
+	/* Name is known to calls charged to the interval before it is left */
+	entry = ibprof_hash_find(hash_obj, key);
+	if (entry && !entry->call_name && (name || (name = __interval_name(id))))
+		__atomic_store_n(&entry->call_name, sys_strdup(name), __ATOMIC_RELEASE);
+
+	frame = &stack->frame[stack->depth];
+	frame->key = key;
+	frame->entry = entry;
+	frame->t_nested = 0;
+	frame->recursive = 0;
+	for (i = 0; (i < stack->depth) && !frame->recursive; i++)
+		frame->recursive = (stack->frame[i].key == key);
+	stack->depth++;
+
+	frame->t_start = ibprof_clock_ticks();
+}
+
+/**
+ * ibprof_interval_pop
+ *
+ * @brief
+ *    Leave an interval on stack of the thread and update its statistics.
+ *    Intervals entered after it and not left yet are left too.
+ *
+ * @param[in]    stack           Interval stack of the thread.
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    id              Interval id or handle.
+ * @param[in]    rank            Process rank.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_pop(IBPROF_INTERVAL_STACK *stack, IBPROF_HASH_OBJECT *hash_obj,
+			int id, int rank)
+{
+	int64_t t_end = ibprof_clock_ticks();
+	HASH_KEY key = HASH_KEY_SET_INTERVAL(id, rank);
+	int depth = 0;
+
+	if (stack->lost) {
+		stack->lost--;
+		return;
+	}
+
+	/* Interval that was not entered is ignored */
+	for (depth = stack->depth; depth > 0; depth--)
+		if (stack->frame[depth - 1].key == key)
+			break;
+
+	while (depth && (stack->depth >= depth))
+		__interval_leave(stack, hash_obj, t_end);
+}
+
+/**
+ * ibprof_interval_charge_name
+ *
+ * @brief
+ *    Set name of user interval to element that collects library call
+ *    charged to the interval.
+ *
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    entry           Element of library call.
+ * @param[in]    key             Key of user interval.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_charge_name(IBPROF_HASH_OBJECT *hash_obj, IBPROF_HASH_OBJ *entry,
+			HASH_KEY key)
+{
+	IBPROF_HASH_OBJ *interval = ibprof_hash_find(hash_obj, key);
+	const char *name = (interval ? interval->call_name : NULL);
+
+	if (!name)
+		name = __interval_name(HASH_KEY_GET_INTERVAL(key));
+	if (name)
+		__atomic_store_n(&entry->call_name, sys_strdup(name), __ATOMIC_RELEASE);
+}
+
+/**
+ * ibprof_interval_call_gather
+ *
+ * @brief
+ *    Collect library calls charged to user interval. Result is
+ *    sorted by total time and should be released by the caller.
+ *
+ * @param[in]    hash_obj        Hash object.
+ * @param[in]    key             Key of user interval.
+ * @param[out]   result          Array of elements.
+ *
+ * @retval (count) - number of elements
+ ***************************************************************************/
+int ibprof_interval_call_gather(IBPROF_HASH_OBJECT *hash_obj, HASH_KEY key,
+			IBPROF_HASH_OBJ ***result)
+{
+	IBPROF_HASH_OBJ **entries = NULL;
+	IBPROF_HASH_OBJ *entry = NULL;
+	int size = HASH_SIZE_INTERVAL(HASH_KEY_GET_INTERVAL(key));
+	int rank = HASH_KEY_GET_RANK(key);
+	int count = 0;
+	int i = 0;
+
+	*result = NULL;
+	if (!ibprof_interval_calls || !hash_obj || !hash_obj->count)
+		return 0;
+
+	entries = (IBPROF_HASH_OBJ **)sys_malloc(hash_obj->count * sizeof(*entries));
+	if (!entries)
+		return 0;
+
+	for (i = 0; (i < hash_obj->size) && (count < hash_obj->count); i++) {
+		entry = &hash_obj->hash_table[i];
+		if ((entry->key == HASH_KEY_INVALID) || (entry->count <= 0) ||
+			(HASH_KEY_GET_SIZE(entry->key) != size) ||
+			(HASH_KEY_GET_RANK(entry->key) != rank))
+			continue;
+		entries[count++] = entry;
+	}
+
+	if (!count) {
+		sys_free(entries);
+		return 0;
+	}
+
+	qsort(entries, count, sizeof(*entries), __interval_call_compare);
+	*result = entries;
+
+	return count;
+}
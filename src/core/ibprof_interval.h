@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_interval.h
+ *
+ * @brief This file is place for user defined intervals
+ *         declaration and operations definition.
+ *
+ * Every thread keeps a stack of entered intervals, so intervals can be
+ * nested, entered recursively and by several threads at the same time.
+ * Inclusive time of an interval is charged to its enclosing one as time
+ * of nested intervals, and self time is the rest. Recursive entry of
+ * the same interval is counted as a call, but its inclusive time is
+ * already covered by the outermost entry.
+ *
+ * Names are registered once and get handles above HASH_MAX_CALL, so ids
+ * of ibprof_interval_start() are not affected. Registry is only looked
+ * up when a name is required for output.
+ *
+ * Library calls can be charged to the innermost interval entered by
+ * the calling thread (IBPROF_INTERVAL_CALLS). Time measured for call
+ * statistics is reused, such elements are kept in hash object of the
+ * thread with interval id in size field of a call key and interval
+ * name as call name.
+ *
+ **/
+#ifndef _IBPROF_INTERVAL_H_
+#define _IBPROF_INTERVAL_H_
+
+#define INTERVAL_MAX_DEPTH    (64) /* Depth of per-thread interval stack */
+#define INTERVAL_MAX_ID       (INT32_MAX - HASH_MAX_SIZE_CLASS) /* Interval id fits size field of a call key */
+
+/**
+ * @struct _IBPROF_INTERVAL_FRAME
+ * @brief Interval entered by a thread
+ */
+typedef struct _IBPROF_INTERVAL_FRAME {
+	HASH_KEY key; /**< key of interval statistics */
+	IBPROF_HASH_OBJ *entry; /**< element of interval statistics (checked by key on use) */
+	int64_t t_start; /**< start timer (ticks) */
+	int64_t t_nested; /**< time of nested intervals (ticks) */
+	int recursive; /**< interval is entered by an enclosing frame too */
+} IBPROF_INTERVAL_FRAME;
+
+/**
+ * @struct _IBPROF_INTERVAL_STACK
+ * @brief Stack of intervals entered by a thread
+ */
+typedef struct _IBPROF_INTERVAL_STACK {
+	IBPROF_INTERVAL_FRAME frame[INTERVAL_MAX_DEPTH]; /**< entered intervals */
+	int depth; /**< number of frames in use */
+	int lost; /**< intervals entered beyond maximum depth */
+} IBPROF_INTERVAL_STACK;
+
+extern int ibprof_interval_calls;
+
+/**
+ * ibprof_interval_init
+ *
+ * @brief
+ *    Set if library calls are charged to user intervals.
+ *
+ * @param[in]    calls           Charge library calls (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_interval_init(int calls);
+
+/**
+ * ibprof_interval_register_name
+ *
+ * @brief
+ *    Return handle of named interval. Handle of new name is allocated,
+ *    the same name always gets the same handle.
+ *
+ * @param[in]    name            Name of interval.
+ *
+ * @retval (handle) - on success
+ * @retval (-1) - on failure
+ ***************************************************************************/
+int ibprof_interval_register_name(const char *name);
+
+/**
+ * ibprof_interval_destroy
+ *
+ * @brief
+ *    Releases registered names.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_destroy(void);
+
+/**
+ * ibprof_interval_push
+ *
+ * @brief
+ *    Enter an interval on stack of the thread.
+ *
+ * @param[in]    stack           Interval stack of the thread.
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    id              Interval id or handle.
+ * @param[in]    rank            Process rank.
+ * @param[in]    name            Name of interval or NULL.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_push(IBPROF_INTERVAL_STACK *stack, IBPROF_HASH_OBJECT *hash_obj,
+			int id, int rank, const char *name);
+
+/**
+ * ibprof_interval_pop
+ *
+ * @brief
+ *    Leave an interval on stack of the thread and update its statistics.
+ *    Intervals entered after it and not left yet are left too.
+ *
+ * @param[in]    stack           Interval stack of the thread.
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    id              Interval id or handle.
+ * @param[in]    rank            Process rank.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_pop(IBPROF_INTERVAL_STACK *stack, IBPROF_HASH_OBJECT *hash_obj,
+			int id, int rank);
+
+/**
+ * ibprof_interval_call_gather
+ *
+ * @brief
+ *    Collect library calls charged to user interval. Result is
+ *    sorted by total time and should be released by the caller.
+ *
+ * @param[in]    hash_obj        Hash object.
+ * @param[in]    key             Key of user interval.
+ * @param[out]   result          Array of elements.
+ *
+ * @retval (count) - number of elements
+ ***************************************************************************/
+int ibprof_interval_call_gather(IBPROF_HASH_OBJECT *hash_obj, HASH_KEY key,
+			IBPROF_HASH_OBJ ***result);
+
+/**
+ * ibprof_interval_charge_name
+ *
+ * @brief
+ *    Set name of user interval to element that collects library call
+ *    charged to the interval.
+ *
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    entry           Element of library call.
+ * @param[in]    key             Key of user interval.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_interval_charge_name(IBPROF_HASH_OBJECT *hash_obj, IBPROF_HASH_OBJ *entry,
+			HASH_KEY key);
+
+/**
+ * ibprof_interval_charge
+ *
+ * @brief
+ *    Charge library call to the innermost interval entered by the thread.
+ *
+ * @param[in]    stack           Interval stack of the thread.
+ * @param[in]    hash_obj        Hash object of the thread.
+ * @param[in]    key             Key of a call regardless of size.
+ * @param[in]    tm              Time spent in a call.
+ * @param[in]    opt             Features (constant expression).
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_interval_charge(IBPROF_INTERVAL_STACK *stack,
+			IBPROF_HASH_OBJECT *hash_obj, HASH_KEY key, int64_t tm, int opt)
+{
+	IBPROF_INTERVAL_FRAME *frame = NULL;
+	IBPROF_HASH_OBJ *entry = NULL;
+
+	if (!(opt & IBPROF_UPDATE_INTERVAL) || !ibprof_interval_calls || !stack->depth)
+		return;
+
+	frame = &stack->frame[stack->depth - 1];
+	entry = ibprof_hash_find(hash_obj,
+			key | HASH_SIZE_INTERVAL(HASH_KEY_GET_INTERVAL(frame->key)));
+	if (entry && !entry->call_name)
+		ibprof_interval_charge_name(hash_obj, entry, frame->key);
+	ibprof_hash_update_opt(hash_obj, entry, tm, opt & IBPROF_UPDATE_WARMUP);
+}
+
+#endif /* _IBPROF_INTERVAL_H_ */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_itree.h"
+
+/* Nodes with equal start are ordered by address */
+#define ITREE_LESS(a, b) \
+	(((a)->start < (b)->start) || (((a)->start == (b)->start) && ((a) < (b))))
+
+static void __itree_update(IBPROF_ITREE_NODE *node)
+{
+	node->max_end = node->end;
+	if (node->left && (node->left->max_end > node->max_end))
+		node->max_end = node->left->max_end;
+	if (node->right && (node->right->max_end > node->max_end))
+		node->max_end = node->right->max_end;
+}
+
+static IBPROF_ITREE_NODE *__itree_rotate_right(IBPROF_ITREE_NODE *node)
+{
+	IBPROF_ITREE_NODE *top = node->left;
+
+	node->left = top->right;
+	top->right = node;
+	__itree_update(node);
+	__itree_update(top);
+
+	return top;
+}
+
+static IBPROF_ITREE_NODE *__itree_rotate_left(IBPROF_ITREE_NODE *node)
+{
+	IBPROF_ITREE_NODE *top = node->right;
+
+	node->right = top->left;
+	top->left = node;
+	__itree_update(node);
+	__itree_update(top);
+
+	return top;
+}
+
+static IBPROF_ITREE_NODE *__itree_insert(IBPROF_ITREE_NODE *root, IBPROF_ITREE_NODE *node)
+{
+	if (!root)
+		return node;
+
+	if (ITREE_LESS(node, root)) {
+		root->left = __itree_insert(root->left, node);
+		if (root->left->priority > root->priority)
+			return __itree_rotate_right(root);
+	} else {
+		root->right = __itree_insert(root->right, node);
+		if (root->right->priority > root->priority)
+			return __itree_rotate_left(root);
+	}
+	__itree_update(root);
+
+	return root;
+}
+
+static IBPROF_ITREE_NODE *__itree_join(IBPROF_ITREE_NODE *left, IBPROF_ITREE_NODE *right)
+{
+	if (!left)
+		return right;
+	if (!right)
+		return left;
+
+	if (left->priority > right->priority) {
+		left->right = __itree_join(left->right, right);
+		__itree_update(left);
+		return left;
+	}
+	right->left = __itree_join(left, right->left);
+	__itree_update(right);
+
+	return right;
+}
+
+static IBPROF_ITREE_NODE *__itree_remove(IBPROF_ITREE_NODE *root, IBPROF_ITREE_NODE *node)
+{
+	if (!root)
+		return NULL;
+
+	if (root == node)
+		return __itree_join(root->left, root->right);
+
+	if (ITREE_LESS(node, root))
+		root->left = __itree_remove(root->left, node);
+	else
+		root->right = __itree_remove(root->right, node);
+	__itree_update(root);
+
+	return root;
+}
+
+/**
+ * ibprof_itree_insert
+ *
+ * @brief
+ *    Adds node to the tree, equal ranges are allowed.
+ *
+ * @param[in,out] root           Tree root.
+ * @param[in]    node            Node with start and end set.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_itree_insert(IBPROF_ITREE_NODE **root, IBPROF_ITREE_NODE *node)
+{
+	node->left = NULL;
+	node->right = NULL;
+	node->max_end = node->end;
+	node->priority = (uint32_t)((((uint64_t)(uintptr_t)node) * 0x9E3779B97F4A7C15ULL) >> 32);
+
+	*root = __itree_insert(*root, node);
+}
+
+/**
+ * ibprof_itree_remove
+ *
+ * @brief
+ *    Removes node from the tree.
+ *
+ * @param[in,out] root           Tree root.
+ * @param[in]    node            Node in the tree.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_itree_remove(IBPROF_ITREE_NODE **root, IBPROF_ITREE_NODE *node)
+{
+	*root = __itree_remove(*root, node);
+}
+
+/**
+ * ibprof_itree_match
+ *
+ * @brief
+ *    Checks how range relates to nodes of the tree.
+ *
+ * @param[in]    root            Tree root.
+ * @param[in]    start           First address of range.
+ * @param[in]    end             Address next to the last one of range.
+ *
+ * @return match type
+ ***************************************************************************/
+IBPROF_ITREE_MATCH ibprof_itree_match(IBPROF_ITREE_NODE *root, uintptr_t start, uintptr_t end)
+{
+	IBPROF_ITREE_MATCH match = IBPROF_ITREE_NONE;
+	IBPROF_ITREE_MATCH sub = IBPROF_ITREE_NONE;
+
+	/* Nothing in subtree ends after the range starts */
+	if (!root || (root->max_end <= start))
+		return IBPROF_ITREE_NONE;
+
+	if ((root->start < end) && (start < root->end)) {
+		if ((root->start == start) && (root->end == end))
+			return IBPROF_ITREE_EXACT;
+		match = IBPROF_ITREE_OVERLAP;
+	}
+
+	sub = ibprof_itree_match(root->left, start, end);
+	if (sub == IBPROF_ITREE_EXACT)
+		return sub;
+	if (sub > match)
+		match = sub;
+
+	/* Right subtree starts after the range ends */
+	if (root->start < end) {
+		sub = ibprof_itree_match(root->right, start, end);
+		if (sub > match)
+			match = sub;
+	}
+
+	return match;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_itree.h
+ *
+ * @brief This file is place for interval tree
+ *         declaration and operations definition.
+ *
+ * Tree keeps address ranges [start, end) ordered by start. It is a treap:
+ * priority of a node is derived from its address, so tree is balanced
+ * in average without random generator. Every node keeps maximum end of
+ * its subtree, that allows to skip subtrees that can not overlap
+ * a range. Nodes are embedded in caller objects, tree does not allocate
+ * memory and is not thread safe.
+ *
+ **/
+#ifndef _IBPROF_ITREE_H_
+#define _IBPROF_ITREE_H_
+
+/**
+ * @struct _IBPROF_ITREE_NODE
+ * @brief Node of interval tree
+ */
+typedef struct _IBPROF_ITREE_NODE {
+	uintptr_t start; /**< first address of range */
+	uintptr_t end; /**< address next to the last one of range */
+	uintptr_t max_end; /**< maximum end in subtree */
+	uint32_t priority; /**< heap priority */
+	struct _IBPROF_ITREE_NODE *left; /**< nodes that start before */
+	struct _IBPROF_ITREE_NODE *right; /**< nodes that start after */
+} IBPROF_ITREE_NODE;
+
+/**
+ * @enum IBPROF_ITREE_MATCH
+ * @brief Result of range lookup.
+ */
+typedef enum {
+	IBPROF_ITREE_NONE = 0, /**< range does not overlap tree */
+	IBPROF_ITREE_OVERLAP, /**< range overlaps some node */
+	IBPROF_ITREE_EXACT /**< tree has node with the same range */
+} IBPROF_ITREE_MATCH;
+
+/**
+ * ibprof_itree_insert
+ *
+ * @brief
+ *    Adds node to the tree, equal ranges are allowed.
+ *
+ * @param[in,out] root           Tree root.
+ * @param[in]    node            Node with start and end set.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_itree_insert(IBPROF_ITREE_NODE **root, IBPROF_ITREE_NODE *node);
+
+/**
+ * ibprof_itree_remove
+ *
+ * @brief
+ *    Removes node from the tree.
+ *
+ * @param[in,out] root           Tree root.
+ * @param[in]    node            Node in the tree.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_itree_remove(IBPROF_ITREE_NODE **root, IBPROF_ITREE_NODE *node);
+
+/**
+ * ibprof_itree_match
+ *
+ * @brief
+ *    Checks how range relates to nodes of the tree.
+ *
+ * @param[in]    root            Tree root.
+ * @param[in]    start           First address of range.
+ * @param[in]    end             Address next to the last one of range.
+ *
+ * @return match type
+ ***************************************************************************/
+IBPROF_ITREE_MATCH ibprof_itree_match(IBPROF_ITREE_NODE *root, uintptr_t start, uintptr_t end);
+
+#endif /* _IBPROF_ITREE_H_ */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+#include "ibprof_live.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+/*
+ * Record of the segment is bound to call of a module
+ */
+typedef struct {
+	int module;
+	int call;
+} LIVE_SOURCE;
+
+static struct {
+	int active; /* publisher thread is running */
+	pthread_t thread; /* publisher thread */
+	pthread_mutex_t mutex; /* protects stop flag */
+	pthread_cond_t cond; /* signalled on termination request */
+	int stop; /* termination request */
+	char name[64]; /* segment name */
+	size_t size; /* segment size */
+	IBPROF_LIVE_HEADER *header; /* mapped segment */
+	IBPROF_LIVE_RECORD *records; /* records inside segment */
+	IBPROF_LIVE_RECORD *staging; /* records being gathered */
+	LIVE_SOURCE *source; /* call of every record */
+	uint32_t count; /* number of records */
+} live_ctx;
+
+/****************************************************************************
+ * Static Function Declarations
+ ***************************************************************************/
+static void __live_gather(void)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_LIVE_RECORD *record = NULL;
+	IBPROF_HASH_OBJ *entry = NULL;
+	int64_t skip = 0;
+	int generation = 0;
+	uint32_t i = 0;
+
+	/* Objects of exited threads are released under the lock */
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+	generation = ibprof_obj->generation;
+
+	for (i = 0; i < live_ctx.count; i++) {
+		record = &live_ctx.staging[i];
+		record->count = 0;
+		record->samples = 0;
+		record->t_tot = 0;
+		record->t_max = 0;
+		record->t_min = INT64_MAX;
+		record->err = 0;
+
+		/* Call tables are read while owners update them as it is done by merge */
+		for (thread_obj = ibprof_obj->thread_list; thread_obj; thread_obj = thread_obj->next) {
+			if (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) != generation)
+				continue;
+
+			entry = &thread_obj->call_table[live_ctx.source[i].module][live_ctx.source[i].call];
+			if (entry->count <= 0)
+				continue;
+			skip = thread_obj->sample_skip[live_ctx.source[i].module][live_ctx.source[i].call];
+			record->count += entry->count + skip;
+			record->samples += ibprof_sample_scale(entry->samples, entry->count, skip);
+			record->t_tot += ibprof_sample_scale(entry->t_tot, entry->count, skip);
+			record->t_max = sys_max(record->t_max, entry->t_max);
+			record->t_min = sys_min(record->t_min, entry->t_min);
+			record->err += entry->mode_data.err;
+		}
+	}
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+}
+
+static void __live_publish(void)
+{
+	IBPROF_LIVE_HEADER *header = live_ctx.header;
+	uint64_t seq = header->seq;
+
+	__live_gather();
+
+	/* Sequence lock: readers retry while it is odd or changed */
+	__atomic_store_n(&header->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	sys_memcpy(live_ctx.records, live_ctx.staging, live_ctx.count * sizeof(IBPROF_LIVE_RECORD));
+	header->t_update = ibprof_task_wall_time(ibprof_obj->task_obj->t_start);
+
+	__atomic_store_n(&header->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void *__live_thread(void *arg)
+{
+	struct timespec deadline;
+	int interval = live_ctx.header->interval;
+	UNREFERENCED_PARAMETER(arg);
+
+	pthread_mutex_lock(&live_ctx.mutex);
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	while (!live_ctx.stop) {
+		deadline.tv_nsec += (long)(interval % 1000) * 1000000L;
+		deadline.tv_sec += interval / 1000 + deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		while (!live_ctx.stop &&
+			(pthread_cond_timedwait(&live_ctx.cond, &live_ctx.mutex, &deadline) != ETIMEDOUT))
+			;
+
+		pthread_mutex_unlock(&live_ctx.mutex);
+		__live_publish();
+		pthread_mutex_lock(&live_ctx.mutex);
+	}
+
+	pthread_mutex_unlock(&live_ctx.mutex);
+
+	return NULL;
+}
+
+static uint32_t __live_sources(LIVE_SOURCE *source)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	uint32_t count = 0;
+	int i = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id == IBPROF_MODULE_INVALID) ||
+			(module_obj->id >= IBPROF_MODULE_USER) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if ((module_call->call < 0) || (module_call->call > HASH_MAX_CALL))
+				continue;
+			if (source) {
+				source[count].module = module_obj->id;
+				source[count].call = module_call->call;
+				sys_snprintf_safe(live_ctx.records[count].module,
+						sizeof(live_ctx.records[count].module), "%s", module_obj->name);
+				sys_snprintf_safe(live_ctx.records[count].name,
+						sizeof(live_ctx.records[count].name), "%s", module_call->name);
+			}
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * ibprof_live_init
+ *
+ * @brief
+ *    Creates live segment and starts publisher thread
+ *    if IBPROF_LIVE_INTERVAL is set.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_live_init(void)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	IBPROF_TASK_OBJECT *task_obj = ibprof_obj->task_obj;
+	IBPROF_LIVE_HEADER *header = NULL;
+	int interval = ibprof_conf_get_int(IBPROF_LIVE_INTERVAL);
+	void *addr = MAP_FAILED;
+	int fd = -1;
+
+	sys_memset(&live_ctx, 0, sizeof(live_ctx));
+	if (interval <= 0)
+		return status;
+
+	live_ctx.count = __live_sources(NULL);
+	live_ctx.size = sizeof(IBPROF_LIVE_HEADER) + live_ctx.count * sizeof(IBPROF_LIVE_RECORD);
+	sys_snprintf_safe(live_ctx.name, sizeof(live_ctx.name), "%s%d",
+			IBPROF_LIVE_PREFIX, task_obj->pid);
+
+	fd = shm_open(live_ctx.name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if ((fd < 0) || ftruncate(fd, live_ctx.size) ||
+		((addr = mmap(NULL, live_ctx.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+		status = IBPROF_ERR_NOT_EXIST;
+		IBPROF_ERROR("%s : error=%d - Can't create shared memory segment '%s'\n",
+				__FUNCTION__, status, live_ctx.name);
+		goto err;
+	}
+	close(fd);
+	fd = -1;
+
+	live_ctx.header = (IBPROF_LIVE_HEADER *)addr;
+	live_ctx.records = (IBPROF_LIVE_RECORD *)(live_ctx.header + 1);
+	live_ctx.staging = (IBPROF_LIVE_RECORD *) sys_malloc(live_ctx.count * sizeof(IBPROF_LIVE_RECORD) + 1);
+	live_ctx.source = (LIVE_SOURCE *) sys_malloc(live_ctx.count * sizeof(LIVE_SOURCE) + 1);
+	if (!live_ctx.staging || !live_ctx.source) {
+		status = IBPROF_ERR_NO_MEMORY;
+		IBPROF_ERROR("%s : error=%d - Can't allocate memory\n",
+				__FUNCTION__, status);
+		goto err;
+	}
+
+	/* Segment is zero filled by ftruncate(), names are set once */
+	__live_sources(live_ctx.source);
+	sys_memcpy(live_ctx.staging, live_ctx.records, live_ctx.count * sizeof(IBPROF_LIVE_RECORD));
+
+	header = live_ctx.header;
+	header->version = IBPROF_LIVE_VERSION;
+	header->header_size = sizeof(IBPROF_LIVE_HEADER);
+	header->record_size = sizeof(IBPROF_LIVE_RECORD);
+	header->record_count = live_ctx.count;
+	header->freq = ibprof_clock_freq;
+	header->pid = task_obj->pid;
+	header->rank = task_obj->procid;
+	header->jobid = task_obj->jobid;
+	header->interval = interval;
+	sys_snprintf_safe(header->host, sizeof(header->host), "%s", task_obj->host);
+	sys_memcpy(header->cmd, task_obj->cmdline,
+			sys_min(sys_strlen(task_obj->cmdline), sizeof(header->cmd) - 1));
+	header->seq = 0;
+	/* Magic is set last: readers ignore segment until it is complete */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	sys_memcpy(header->magic, IBPROF_LIVE_MAGIC, sizeof(header->magic));
+
+	pthread_mutex_init(&live_ctx.mutex, NULL);
+	pthread_cond_init(&live_ctx.cond, NULL);
+	if (pthread_create(&live_ctx.thread, NULL, __live_thread, NULL)) {
+		status = IBPROF_ERR_INCORRECT;
+		IBPROF_ERROR("%s : error=%d - Can't start publisher thread\n",
+				__FUNCTION__, status);
+		pthread_cond_destroy(&live_ctx.cond);
+		pthread_mutex_destroy(&live_ctx.mutex);
+		goto err;
+	}
+
+	live_ctx.active = 1;
+
+	return status;
+
+err:
+	if (fd >= 0)
+		close(fd);
+	if (addr != MAP_FAILED)
+		munmap(addr, live_ctx.size);
+	shm_unlink(live_ctx.name);
+	sys_free(live_ctx.staging);
+	sys_free(live_ctx.source);
+	sys_memset(&live_ctx, 0, sizeof(live_ctx));
+
+	return status;
+}
+
+/**
+ * ibprof_live_exit
+ *
+ * @brief
+ *    Stops publisher thread and removes live segment.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_live_exit(void)
+{
+	if (!live_ctx.active)
+		return;
+
+	pthread_mutex_lock(&live_ctx.mutex);
+	live_ctx.stop = 1;
+	pthread_cond_signal(&live_ctx.cond);
+	pthread_mutex_unlock(&live_ctx.mutex);
+
+	pthread_join(live_ctx.thread, NULL);
+
+	pthread_cond_destroy(&live_ctx.cond);
+	pthread_mutex_destroy(&live_ctx.mutex);
+
+	munmap(live_ctx.header, live_ctx.size);
+	shm_unlink(live_ctx.name);
+	sys_free(live_ctx.staging);
+	sys_free(live_ctx.source);
+	sys_memset(&live_ctx, 0, sizeof(live_ctx));
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_live.h
+ *
+ * @brief This file is place for live counters
+ *         declaration and operations definition.
+ *
+ * Process publishes statistics of every known call in POSIX shared memory
+ * segment IBPROF_LIVE_PREFIX<pid> (/dev/shm/ibprof-live.<pid>) that can be
+ * read by external tool (ibprof-top) at any moment:
+ *
+ *     IBPROF_LIVE_HEADER
+ *     record_count * IBPROF_LIVE_RECORD
+ *
+ * Single publisher thread refreshes records periodically. Consistency of
+ * records is protected by sequence lock: header.seq is odd while records
+ * are updated, reader should retry if it was odd or changed during copy.
+ *
+ * Layout part of this header is shared with tools and should not depend
+ * on library internals.
+ *
+ **/
+#ifndef _IBPROF_LIVE_H_
+#define _IBPROF_LIVE_H_
+
+#include <stdint.h>
+
+#define IBPROF_LIVE_MAGIC        "IBPLIVE"
+#define IBPROF_LIVE_VERSION      1
+#define IBPROF_LIVE_PREFIX       "/ibprof-live."
+
+/**
+ * @struct _IBPROF_LIVE_HEADER
+ * @brief Live segment header
+ */
+typedef struct _IBPROF_LIVE_HEADER {
+	char magic[8]; /**< IBPROF_LIVE_MAGIC */
+	uint32_t version; /**< IBPROF_LIVE_VERSION */
+	uint32_t header_size; /**< size of IBPROF_LIVE_HEADER (offset of records) */
+	uint32_t record_size; /**< size of IBPROF_LIVE_RECORD */
+	uint32_t record_count; /**< number of records following header */
+	double freq; /**< clock ticks per second */
+	int32_t pid; /**< process id */
+	int32_t rank; /**< process rank */
+	int32_t jobid; /**< job id */
+	int32_t interval; /**< update period in milliseconds */
+	char host[64]; /**< host name */
+	char cmd[128]; /**< command name */
+	uint64_t seq __attribute__((aligned(64))); /**< sequence lock */
+	double t_update; /**< time of last update (sec since process start) */
+} IBPROF_LIVE_HEADER;
+
+/**
+ * @struct _IBPROF_LIVE_RECORD
+ * @brief Cumulative statistics of single call
+ */
+typedef struct _IBPROF_LIVE_RECORD {
+	char module[16]; /**< module name */
+	char name[48]; /**< call name */
+	int64_t count; /**< number of calls */
+	int64_t t_tot; /**< total time (clock ticks) */
+	int64_t t_max; /**< maximum time (clock ticks) */
+	int64_t t_min; /**< minimum time (clock ticks) */
+	int64_t err; /**< number of injected errors */
+	int64_t samples; /**< number of calls in t_tot (count without warmup) */
+} IBPROF_LIVE_RECORD;
+
+#if defined(_IBPROF_DEF_H_)
+/**
+ * ibprof_live_init
+ *
+ * @brief
+ *    Creates live segment and starts publisher thread
+ *    if IBPROF_LIVE_INTERVAL is set.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_live_init(void);
+
+/**
+ * ibprof_live_exit
+ *
+ * @brief
+ *    Stops publisher thread and removes live segment.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_live_exit(void);
+#endif /* _IBPROF_DEF_H_ */
+
+#endif /* _IBPROF_LIVE_H_ */
@@ -0,0 +1,649 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+#include "ibprof_io.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <signal.h>
+
+#define NODE_MAGIC           "IBPNODE"
+#define NODE_VERSION         3
+#define NODE_MAX_ENTRIES     (512) /* Calls deposited by single rank */
+#define NODE_ATTACH_USEC     (10000000) /* Time to wait for segment creator */
+#define NODE_RANK_ENV        "IBPROF_NODE_RANK_PID" /* Inherited by processes started by a rank */
+
+/* States of a slot */
+#define NODE_SLOT_FREE       (0)
+#define NODE_SLOT_JOINED     (1) /* taken by running rank */
+#define NODE_SLOT_DONE       (2) /* statistics are deposited */
+
+/*
+ * Segment layout: header followed by one slot per rank of the node
+ */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t size; /* number of slots */
+	int32_t joined; /* number of slots taken */
+	int32_t leader; /* set by the rank that outputs report */
+	uint64_t stamp; /* launch the segment is created by */
+} NODE_HEADER;
+
+typedef struct {
+	int32_t module;
+	int32_t call;
+	char name[48];
+	int64_t count;
+	double t_tot; /* sec */
+} NODE_ENTRY;
+
+typedef struct {
+	int32_t rank;
+	int32_t pid;
+	int32_t count; /* number of entries */
+	int32_t state; /* NODE_SLOT_xxx */
+	double wall_time; /* sec */
+	uint64_t file_dev; /* dump file of the rank */
+	uint64_t file_ino;
+	char file[256];
+	NODE_ENTRY entry[NODE_MAX_ENTRIES];
+} NODE_SLOT;
+
+static struct {
+	int size; /* number of ranks on the node */
+	char name[256]; /* segment name */
+	uint64_t stamp; /* launch of the process */
+	NODE_HEADER *header; /* attached segment */
+	int slot; /* slot taken by the process */
+	int pid; /* process that took the slot */
+} node_ctx;
+
+/****************************************************************************
+ * Static Function Declarations
+ ***************************************************************************/
+static size_t __node_segment_size(void)
+{
+	return sizeof(NODE_HEADER) + node_ctx.size * sizeof(NODE_SLOT);
+}
+
+/*
+ * Start time of parent process (clock ticks since boot) distinguishes
+ * launches by the same parent pid
+ */
+static uint64_t __node_parent_start(void)
+{
+	char path[64];
+	char buf[1024];
+	char *str = NULL;
+	FILE *file = NULL;
+	uint64_t start = 0;
+	int i = 0;
+
+	sys_snprintf_safe(path, sizeof(path), "/proc/%d/stat", (int)getppid());
+	file = sys_fopen(path, "r");
+	if (!file)
+		return 0;
+	str = sys_fgets(buf, sizeof(buf), file);
+	sys_fclose(file);
+
+	/* Field 22 (starttime) is counted after command name that can contain spaces */
+	if (str)
+		str = sys_strrchr(buf, ')');
+	for (i = 2; str && (i < 22); i++)
+		str = sys_strchr(str + 1, ' ');
+	if (str)
+		start = sys_strtoull(str + 1, NULL, 10);
+
+	return start;
+}
+
+/*
+ * FNV-1a hash of segment name is the stamp of launch
+ */
+static uint64_t __node_stamp(const char *name)
+{
+	uint64_t stamp = 14695981039346656037ULL;
+
+	for (; *name; name++) {
+		stamp ^= (unsigned char)*name;
+		stamp *= 1099511628211ULL;
+	}
+
+	return stamp;
+}
+
+/*
+ * Segment of another launch that was not removed by crashed leader is
+ * replaced if it is still under the same name
+ */
+static int __node_remove_stale(int fd)
+{
+	struct stat stale, current;
+	int ret = -1;
+
+	if (fstat(fd, &stale))
+		return ret;
+
+	ret = shm_open(node_ctx.name, O_RDONLY, 0600);
+	if (ret < 0)
+		return (errno == ENOENT ? 0 : -1);
+	if (!fstat(ret, &current) &&
+		(stale.st_dev == current.st_dev) && (stale.st_ino == current.st_ino)) {
+		close(ret);
+		ret = shm_unlink(node_ctx.name);
+		if (!ret)
+			IBPROF_WARN("%s : stale node segment '%s' is replaced\n", __FUNCTION__, node_ctx.name);
+		return ((ret && (errno != ENOENT)) ? -1 : 0);
+	}
+	close(ret);
+
+	return 0;
+}
+
+static NODE_HEADER *__node_attach(void)
+{
+	NODE_HEADER *header = NULL;
+	struct stat statbuf;
+	size_t size = __node_segment_size();
+	void *addr = MAP_FAILED;
+	int creator = 0;
+	int stale = 0;
+	int fd = -1;
+	int usec = 0;
+
+again:
+	fd = shm_open(node_ctx.name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0) {
+		creator = 1;
+		if (ftruncate(fd, size))
+			goto err;
+	} else if (errno == EEXIST) {
+		/* Creator can be still resizing the segment */
+		fd = shm_open(node_ctx.name, O_RDWR, 0600);
+		while ((fd >= 0) && !fstat(fd, &statbuf) &&
+			((size_t)statbuf.st_size < size) && (usec < NODE_ATTACH_USEC)) {
+			usleep(1000);
+			usec += 1000;
+		}
+		if ((fd < 0) || fstat(fd, &statbuf))
+			goto err;
+		if ((size_t)statbuf.st_size != size)
+			goto stale;
+	} else
+		goto err;
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		goto err;
+	close(fd);
+	fd = -1;
+
+	header = (NODE_HEADER *)addr;
+	if (creator) {
+		header->version = NODE_VERSION;
+		header->size = node_ctx.size;
+		header->joined = 0;
+		header->leader = 0;
+		header->stamp = node_ctx.stamp;
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		sys_memcpy(header->magic, NODE_MAGIC, sizeof(header->magic));
+	} else {
+		while (sys_memcmp((const void *)header->magic, NODE_MAGIC, sizeof(header->magic)) &&
+			(usec < NODE_ATTACH_USEC)) {
+			usleep(1000);
+			usec += 1000;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		}
+		if (sys_memcmp(header->magic, NODE_MAGIC, sizeof(header->magic)) ||
+			(header->version != NODE_VERSION) || (header->size != (uint32_t)node_ctx.size) ||
+			(header->stamp != node_ctx.stamp))
+			goto stale;
+	}
+
+	return header;
+
+stale:
+	/* Segment is replaced once, other ranks of the launch attach to new one */
+	if (!stale && !__node_remove_stale(fd)) {
+		if (addr != MAP_FAILED)
+			munmap(addr, size);
+		close(fd);
+		addr = MAP_FAILED;
+		fd = -1;
+		usec = 0;
+		stale = 1;
+		goto again;
+	}
+
+err:
+	IBPROF_WARN("%s : can't attach node segment '%s'\n", __FUNCTION__, node_ctx.name);
+	if (fd >= 0)
+		close(fd);
+	if (addr != MAP_FAILED)
+		munmap(addr, size);
+
+	return NULL;
+}
+
+static const char *__node_call_name(int module, int call)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	int i = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id != module) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if (module_call->call == call)
+				return module_call->name;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Dump file of the rank is kept to remove it if it is left empty
+ */
+static void __node_file(NODE_SLOT *slot)
+{
+	struct stat statbuf;
+	char fd_path[64];
+	ssize_t len = -1;
+
+	slot->file[0] = '\0';
+	if (!ibprof_dump_file || (ibprof_dump_file == stdout) || (ibprof_dump_file == stderr))
+		return;
+
+	sys_snprintf_safe(fd_path, sizeof(fd_path), "/proc/self/fd/%d", fileno(ibprof_dump_file));
+	len = readlink(fd_path, slot->file, sizeof(slot->file) - 1);
+	if ((len <= 0) || fstat(fileno(ibprof_dump_file), &statbuf)) {
+		slot->file[0] = '\0';
+		return;
+	}
+	slot->file[len] = '\0';
+	slot->file_dev = statbuf.st_dev;
+	slot->file_ino = statbuf.st_ino;
+}
+
+/*
+ * Ranks that write own files leave them empty, the leader removes them
+ * after its report is written (shared file is the file of the leader)
+ */
+static void __node_file_cleanup(NODE_HEADER *header, int leader_slot)
+{
+	NODE_SLOT *slots = (NODE_SLOT *)(header + 1);
+	NODE_SLOT *leader = &slots[leader_slot];
+	struct stat statbuf;
+	int i = 0;
+
+	for (i = 0; i < (int)header->size; i++) {
+		if ((i == leader_slot) || !slots[i].file[0])
+			continue;
+		if (leader->file[0] && (slots[i].file_dev == leader->file_dev) &&
+			(slots[i].file_ino == leader->file_ino))
+			continue;
+		if (!sys_fstat(slots[i].file, &statbuf) && !statbuf.st_size &&
+			((uint64_t)statbuf.st_dev == slots[i].file_dev) &&
+			((uint64_t)statbuf.st_ino == slots[i].file_ino))
+			sys_fremove(slots[i].file);
+	}
+}
+
+/*
+ * Copy totals of every call (message size classes are not reduced)
+ */
+static void __node_deposit(NODE_SLOT *slot, IBPROF_HASH_OBJECT *hash_obj)
+{
+	IBPROF_TASK_OBJECT *task_obj = ibprof_obj->task_obj;
+	IBPROF_HASH_OBJ *src = NULL;
+	NODE_ENTRY *entry = NULL;
+	const char *name = NULL;
+	int i = 0;
+
+	slot->rank = task_obj->procid;
+	slot->wall_time = task_obj->wall_time;
+	slot->count = 0;
+	__node_file(slot);
+
+	for (i = 0; i < hash_obj->size; i++) {
+		src = &hash_obj->hash_table[i];
+		if ((src->key == HASH_KEY_INVALID) || HASH_KEY_GET_SIZE(src->key) || (src->count <= 0))
+			continue;
+		if (slot->count == NODE_MAX_ENTRIES) {
+			IBPROF_WARN("%s : only %d calls are reduced\n", __FUNCTION__, NODE_MAX_ENTRIES);
+			break;
+		}
+
+		entry = &slot->entry[slot->count++];
+		entry->module = HASH_KEY_GET_MODULE(src->key);
+		entry->call = (entry->module == IBPROF_MODULE_USER ?
+				HASH_KEY_GET_INTERVAL(src->key) : HASH_KEY_GET_CALL(src->key));
+		entry->count = src->count;
+		entry->t_tot = ibprof_clock_to_sec(src->t_tot);
+
+		name = (entry->module == IBPROF_MODULE_USER ? src->call_name :
+				__node_call_name(entry->module, entry->call));
+		if (name)
+			sys_snprintf_safe(entry->name, sizeof(entry->name), "%s", name);
+		else
+			sys_snprintf_safe(entry->name, sizeof(entry->name), "%d", entry->call);
+	}
+}
+
+/*
+ * Square root by Newton iterations (library does not link libm)
+ */
+static double __node_sqrt(double value)
+{
+	double root = value;
+	int i = 0;
+
+	if (value <= 0)
+		return 0;
+	for (i = 0; i < 64; i++)
+		root = 0.5 * (root + value / root);
+
+	return root;
+}
+
+static int __node_call_compare(const void *a, const void *b)
+{
+	const IBPROF_NODE_CALL *call1 = (const IBPROF_NODE_CALL *)a;
+	const IBPROF_NODE_CALL *call2 = (const IBPROF_NODE_CALL *)b;
+
+	if (call1->module != call2->module)
+		return call1->module - call2->module;
+	if (call1->module == IBPROF_MODULE_USER)
+		return sys_strcmp(call1->name, call2->name);
+	return call1->call - call2->call;
+}
+
+/*
+ * Merge all slots into report and output it
+ */
+static void __node_report(NODE_HEADER *header)
+{
+	IBPROF_NODE_REPORT report;
+	IBPROF_NODE_CALL *call = NULL;
+	NODE_SLOT *slots = (NODE_SLOT *)(header + 1);
+	NODE_SLOT *slot = NULL;
+	NODE_ENTRY *entry = NULL;
+	int max_calls = 0;
+	int i, j, k, r;
+
+	sys_memset(&report, 0, sizeof(report));
+	report.host = ibprof_obj->task_obj->host;
+
+	for (i = 0; i < (int)header->size; i++)
+		max_calls += slots[i].count;
+
+	report.ranks = (IBPROF_NODE_RANK *) sys_malloc(header->size * sizeof(IBPROF_NODE_RANK));
+	report.calls = (IBPROF_NODE_CALL *) sys_malloc((max_calls + 1) * sizeof(IBPROF_NODE_CALL));
+	if (!report.ranks || !report.calls) {
+		IBPROF_ERROR("%s : error=%d - Can't allocate memory\n",
+				__FUNCTION__, IBPROF_ERR_NO_MEMORY);
+		goto out;
+	}
+
+	/* Ranks that exited without deposit are left out */
+	for (i = 0, r = 0; i < (int)header->size; i++) {
+		slot = &slots[i];
+		if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != NODE_SLOT_DONE) {
+			if (i < header->joined)
+				report.rank_lost++;
+			continue;
+		}
+		report.ranks[r].rank = slot->rank;
+		report.ranks[r].pid = slot->pid;
+		report.ranks[r].wall_time = slot->wall_time;
+		report.ranks[r].t_tot = 0;
+
+		for (j = 0; j < slot->count; j++) {
+			entry = &slot->entry[j];
+			report.ranks[r].t_tot += entry->t_tot;
+
+			for (k = 0; k < report.call_count; k++) {
+				call = &report.calls[k];
+				/* Interval ids are assigned by every rank, names are common */
+				if ((call->module == entry->module) &&
+					((entry->module == IBPROF_MODULE_USER) ?
+					!sys_strcmp(call->name, entry->name) : (call->call == entry->call)))
+					break;
+			}
+			call = &report.calls[k];
+			if (k == report.call_count) {
+				report.call_count++;
+				sys_memset(call, 0, sizeof(*call));
+				call->module = entry->module;
+				call->call = entry->call;
+				call->name = entry->name;
+				call->t_min = entry->t_tot;
+				call->min_rank = slot->rank;
+				call->t_max = entry->t_tot;
+				call->max_rank = slot->rank;
+			}
+			call->ranks++;
+			call->count += entry->count;
+			call->t_tot += entry->t_tot;
+			if (entry->t_tot < call->t_min) {
+				call->t_min = entry->t_tot;
+				call->min_rank = slot->rank;
+			}
+			if (entry->t_tot > call->t_max) {
+				call->t_max = entry->t_tot;
+				call->max_rank = slot->rank;
+			}
+		}
+		report.t_mean += report.ranks[r].t_tot;
+		r++;
+	}
+	report.rank_count = r;
+
+	report.t_mean /= report.rank_count;
+	for (i = 0; i < report.rank_count; i++)
+		report.t_sigma += (report.ranks[i].t_tot - report.t_mean) *
+				(report.ranks[i].t_tot - report.t_mean);
+	report.t_sigma = __node_sqrt(report.t_sigma / report.rank_count);
+
+	qsort(report.calls, report.call_count, sizeof(IBPROF_NODE_CALL), __node_call_compare);
+
+	ibprof_io_plain_node_dump(ibprof_dump_file, ibprof_obj, &report);
+	sys_fflush(ibprof_dump_file);
+
+out:
+	sys_free(report.ranks);
+	sys_free(report.calls);
+}
+
+/*
+ * The rank is leader if every other rank that took a slot has deposited
+ * its statistics or is dead. Slot state is published before the check,
+ * so at least one of ranks finishing at the same time sees all slots done.
+ */
+static int __node_leader(NODE_HEADER *header)
+{
+	NODE_SLOT *slots = (NODE_SLOT *)(header + 1);
+	int i = 0;
+
+	for (i = 0; i < sys_min(__atomic_load_n(&header->joined, __ATOMIC_SEQ_CST), (int)header->size); i++) {
+		switch (__atomic_load_n(&slots[i].state, __ATOMIC_SEQ_CST)) {
+		case NODE_SLOT_DONE:
+			break;
+
+		case NODE_SLOT_JOINED:
+			/* Rank is crashed */
+			if (kill(slots[i].pid, 0) && (errno == ESRCH))
+				break;
+			return 0;
+
+		default:
+			/* Slot is taken but pid is not set yet */
+			return 0;
+		}
+	}
+
+	return (__atomic_exchange_n(&header->leader, 1, __ATOMIC_ACQ_REL) == 0);
+}
+
+/**
+ * ibprof_node_init
+ *
+ * @brief
+ *    Enables node level reduction if IBPROF_NODE_REDUCE is set and
+ *    number of ranks on the node is known. The process takes a slot of
+ *    node segment, so ranks that exit without statistics are detected.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_node_init(void)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	IBPROF_TASK_OBJECT *task_obj = ibprof_obj->task_obj;
+	const char *launch = NULL;
+	NODE_SLOT *slots = NULL;
+	char buf[64];
+	char *str = NULL;
+	int session = 0;
+
+	sys_memset(&node_ctx, 0, sizeof(node_ctx));
+	if (!ibprof_conf_get_int(IBPROF_NODE_REDUCE))
+		return status;
+
+	/* Process started by a rank writes own statistics */
+	if (getenv(NODE_RANK_ENV))
+		return IBPROF_ERR_UNSUPPORTED;
+
+	if (format_dump != ibprof_io_plain_dump) {
+		status = IBPROF_ERR_UNSUPPORTED;
+		IBPROF_WARN("%s : error=%d - Node reduction supports plain format only\n",
+				__FUNCTION__, status);
+		return status;
+	}
+
+	node_ctx.size = (ibprof_conf_get_int(IBPROF_NODE_SIZE) > 0 ?
+			ibprof_conf_get_int(IBPROF_NODE_SIZE) : sys_localsize());
+	if (node_ctx.size <= 1) {
+		status = IBPROF_ERR_UNSUPPORTED;
+		IBPROF_WARN("%s : error=%d - Number of ranks on the node is unknown, "
+				"set IBPROF_NODE_SIZE\n", __FUNCTION__, status);
+		node_ctx.size = 0;
+		return status;
+	}
+
+	/* Ranks of the same launch on the node share the segment: steps of a job
+	 * are told by launch id, launches by the same parent by its start time
+	 */
+	session = (task_obj->jobid >= 0 ? task_obj->jobid : (int)getppid());
+	launch = sys_launchid();
+	if (!launch) {
+		sys_snprintf_safe(buf, sizeof(buf), "%llu", (unsigned long long)__node_parent_start());
+		launch = buf;
+	}
+	sys_snprintf_safe(node_ctx.name, sizeof(node_ctx.name), "/ibprof-node.%d.%d.%s.%s",
+			(int)getuid(), session, launch, task_obj->host);
+	for (str = node_ctx.name + 1; *str; str++)
+		if (*str == '/')
+			*str = '_';
+	node_ctx.stamp = __node_stamp(node_ctx.name);
+
+	node_ctx.header = __node_attach();
+	if (!node_ctx.header) {
+		status = IBPROF_ERR_NOT_EXIST;
+		goto err;
+	}
+	slots = (NODE_SLOT *)(node_ctx.header + 1);
+
+	node_ctx.slot = __atomic_fetch_add(&node_ctx.header->joined, 1, __ATOMIC_SEQ_CST);
+	if (node_ctx.slot >= node_ctx.size) {
+		/* Segment is left by previous run or number of ranks is wrong */
+		status = IBPROF_ERR_INCORRECT;
+		IBPROF_WARN("%s : error=%d - Node segment '%s' is full, check IBPROF_NODE_SIZE\n",
+				__FUNCTION__, status, node_ctx.name);
+		goto err;
+	}
+	node_ctx.pid = task_obj->pid;
+	slots[node_ctx.slot].pid = node_ctx.pid;
+	__atomic_store_n(&slots[node_ctx.slot].state, NODE_SLOT_JOINED, __ATOMIC_SEQ_CST);
+
+	sys_snprintf_safe(buf, sizeof(buf), "%d", node_ctx.pid);
+	setenv(NODE_RANK_ENV, buf, 1);
+
+	return status;
+
+err:
+	/* Statistics of the process are output by itself */
+	if (node_ctx.header)
+		munmap(node_ctx.header, __node_segment_size());
+	sys_memset(&node_ctx, 0, sizeof(node_ctx));
+
+	return status;
+}
+
+/**
+ * ibprof_node_dump
+ *
+ * @brief
+ *    Deposits final statistics of the process into node segment.
+ *    The last rank of the node outputs merged report, ranks that
+ *    exited without statistics are not waited for.
+ *
+ * @param[out]   leader          Set if the process has output the report.
+ *
+ * @retval (0) - statistics are handled by node reduction
+ * @retval (errno) - reduction is not available, process should output
+ *                   own statistics
+ ***************************************************************************/
+IBPROF_ERROR ibprof_node_dump(int *leader)
+{
+	NODE_HEADER *header = node_ctx.header;
+	NODE_SLOT *slots = NULL;
+
+	if (!header || !ibprof_obj)
+		return IBPROF_ERR_UNSUPPORTED;
+
+	/* Forked child shares the mapping but not the slot */
+	if (node_ctx.pid != (int)getpid()) {
+		munmap(header, __node_segment_size());
+		node_ctx.header = NULL;
+		return IBPROF_ERR_UNSUPPORTED;
+	}
+	slots = (NODE_SLOT *)(header + 1);
+
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	ibprof_thread_gather(ibprof_obj->hash_obj, ibprof_obj->thread_list,
+			ibprof_obj->generation);
+	__node_deposit(&slots[node_ctx.slot], ibprof_obj->hash_obj);
+	__atomic_store_n(&slots[node_ctx.slot].state, NODE_SLOT_DONE, __ATOMIC_SEQ_CST);
+
+	*leader = __node_leader(header);
+	if (*leader) {
+		__node_report(header);
+		__node_file_cleanup(header, node_ctx.slot);
+		shm_unlink(node_ctx.name);
+	}
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+	munmap(header, __node_segment_size());
+	node_ctx.header = NULL;
+
+	return IBPROF_ERR_NONE;
+}
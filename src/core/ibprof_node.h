@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_node.h
+ *
+ * @brief This file is place for node level reduction
+ *         declaration and operations definition.
+ *
+ * When IBPROF_NODE_REDUCE is set ranks of the same host deposit their final
+ * statistics into shared memory segment instead of output. The last rank
+ * that deposits own statistics becomes leader: it merges all slots and
+ * outputs single table per node with min/avg/max across ranks and outlier
+ * ranks. Nobody waits for other ranks at exit.
+ *
+ **/
+#ifndef _IBPROF_NODE_H_
+#define _IBPROF_NODE_H_
+
+/**
+ * @struct _IBPROF_NODE_CALL
+ * @brief Statistics of a call across ranks of the node
+ */
+typedef struct _IBPROF_NODE_CALL {
+	int module; /**< module id */
+	int call; /**< call number */
+	const char *name; /**< call name */
+	int ranks; /**< number of ranks that used the call */
+	int64_t count; /**< number of calls of all ranks */
+	double t_tot; /**< total time of all ranks (sec) */
+	double t_min; /**< minimal total time of a rank (sec) */
+	double t_max; /**< maximal total time of a rank (sec) */
+	int min_rank; /**< rank with minimal time */
+	int max_rank; /**< rank with maximal time */
+} IBPROF_NODE_CALL;
+
+/**
+ * @struct _IBPROF_NODE_RANK
+ * @brief Summary of a rank of the node
+ */
+typedef struct _IBPROF_NODE_RANK {
+	int rank; /**< process rank */
+	int pid; /**< process id */
+	double wall_time; /**< wall time (sec) */
+	double t_tot; /**< time spent in all calls (sec) */
+} IBPROF_NODE_RANK;
+
+/**
+ * @struct _IBPROF_NODE_REPORT
+ * @brief Merged statistics of the node
+ */
+typedef struct _IBPROF_NODE_REPORT {
+	const char *host; /**< host name */
+	int rank_count; /**< number of ranks */
+	int rank_lost; /**< number of ranks exited without statistics */
+	IBPROF_NODE_RANK *ranks; /**< summary of every rank */
+	int call_count; /**< number of calls */
+	IBPROF_NODE_CALL *calls; /**< calls ordered by module and call number (intervals by name) */
+	double t_mean; /**< mean of time spent in calls by a rank (sec) */
+	double t_sigma; /**< standard deviation of time spent in calls by a rank (sec) */
+} IBPROF_NODE_REPORT;
+
+/**
+ * ibprof_node_init
+ *
+ * @brief
+ *    Enables node level reduction if IBPROF_NODE_REDUCE is set and
+ *    number of ranks on the node is known. The process takes a slot of
+ *    node segment, so ranks that exit without statistics are detected.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_node_init(void);
+
+/**
+ * ibprof_node_dump
+ *
+ * @brief
+ *    Deposits final statistics of the process into node segment.
+ *    The last rank of the node outputs merged report, ranks that
+ *    exited without statistics are not waited for.
+ *
+ * @param[out]   leader          Set if the process has output the report.
+ *
+ * @retval (0) - statistics are handled by node reduction
+ * @retval (errno) - reduction is not available, process should output
+ *                   own statistics
+ ***************************************************************************/
+IBPROF_ERROR ibprof_node_dump(int *leader);
+
+#endif /* _IBPROF_NODE_H_ */
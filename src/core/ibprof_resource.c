@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+int ibprof_resource_size = 0;
+
+/*
+ * Weight of an object used for replacement: measured time and time
+ * of replaced objects it might include
+ */
+static int64_t __resource_weight(const IBPROF_RESOURCE_OBJ *entry)
+{
+	return entry->t_tot + entry->t_err;
+}
+
+static int __resource_key_compare(const void *a, const void *b)
+{
+	const IBPROF_RESOURCE_OBJ *entry_a = (const IBPROF_RESOURCE_OBJ *)a;
+	const IBPROF_RESOURCE_OBJ *entry_b = (const IBPROF_RESOURCE_OBJ *)b;
+
+	return (entry_a->key < entry_b->key ? -1 : (entry_a->key > entry_b->key));
+}
+
+static int __resource_weight_compare(const void *a, const void *b)
+{
+	int64_t weight_a = __resource_weight((const IBPROF_RESOURCE_OBJ *)a);
+	int64_t weight_b = __resource_weight((const IBPROF_RESOURCE_OBJ *)b);
+
+	return (weight_a > weight_b ? -1 : (weight_a < weight_b));
+}
+
+/**
+ * ibprof_resource_init
+ *
+ * @brief
+ *    Set number of objects kept per call.
+ *
+ * @param[in]    size            Number of objects (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_resource_init(int size)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+
+	if ((size < 0) || (size > RESOURCE_MAX_SIZE)) {
+		status = IBPROF_ERR_BAD_ARGUMENT;
+		IBPROF_WARN("%s : error=%d - Number of objects %d is out of range [0..%d], %d is used\n",
+				__FUNCTION__, status, size, RESOURCE_MAX_SIZE, RESOURCE_MAX_SIZE);
+		size = RESOURCE_MAX_SIZE;
+	}
+
+	ibprof_resource_size = size;
+
+	return status;
+}
+
+/**
+ * ibprof_resource_create
+ *
+ * @brief
+ *    Allocates memory for new table.
+ *
+ * @param[in]    format          printf format of object key.
+ *
+ * @retval pointer to new table - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_RESOURCE_TABLE *ibprof_resource_create(const char *format)
+{
+	IBPROF_RESOURCE_TABLE *table = NULL;
+
+	if (!ibprof_resource_size)
+		return NULL;
+
+	table = (IBPROF_RESOURCE_TABLE *) sys_malloc(sizeof(IBPROF_RESOURCE_TABLE) +
+			(ibprof_resource_size - 1) * sizeof(IBPROF_RESOURCE_OBJ));
+	if (table) {
+		sys_memset(table, 0, sizeof(IBPROF_RESOURCE_TABLE));
+		table->format = format;
+	}
+
+	return table;
+}
+
+/**
+ * ibprof_resource_find
+ *
+ * @brief
+ *    Return entry of given object, object with the least time
+ *    is replaced if table is full.
+ *
+ * @return pointer to entry
+ ***************************************************************************/
+IBPROF_RESOURCE_OBJ *ibprof_resource_find(IBPROF_RESOURCE_TABLE *table, uint64_t key)
+{
+	IBPROF_RESOURCE_OBJ *entry = NULL;
+	int victim = 0;
+	int i = 0;
+
+	for (i = 0; i < table->count; i++) {
+		if (table->entry[i].key == key) {
+			table->last = i;
+			return &table->entry[i];
+		}
+		if (__resource_weight(&table->entry[i]) < __resource_weight(&table->entry[victim]))
+			victim = i;
+	}
+
+	if (table->count < ibprof_resource_size) {
+		entry = &table->entry[table->count];
+		table->last = table->count;
+		sys_memset(entry, 0, sizeof(*entry));
+		entry->key = key;
+		/* Entry is complete before dump can see it */
+		__atomic_store_n(&table->count, table->count + 1, __ATOMIC_RELEASE);
+		return entry;
+	}
+
+	entry = &table->entry[victim];
+	table->last = victim;
+	entry->t_err = __resource_weight(entry);
+	entry->key = key;
+	entry->count = 0;
+	entry->t_tot = 0;
+	entry->t_max = 0;
+
+	return entry;
+}
+
+/**
+ * ibprof_resource_merge
+ *
+ * @brief
+ *    Adds objects of a call to destination table. Objects of
+ *    sampled call are scaled to all invocations.
+ *
+ * @param[in]    dst             Destination table.
+ * @param[in]    src             Table to be added.
+ * @param[in]    count           Number of measured invocations.
+ * @param[in]    skip            Number of invocations that were not measured.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_resource_merge(IBPROF_RESOURCE_TABLE *dst, const IBPROF_RESOURCE_TABLE *src,
+			int64_t count, int64_t skip)
+{
+	IBPROF_RESOURCE_OBJ *entry = NULL;
+	int count_src = __atomic_load_n(&src->count, __ATOMIC_ACQUIRE);
+	int i = 0;
+
+	/* Source can be updated by its owner thread at the same time */
+	for (i = 0; i < count_src; i++) {
+		entry = ibprof_resource_find(dst, src->entry[i].key);
+		entry->count += ibprof_sample_scale(src->entry[i].count, count, skip);
+		entry->t_tot += ibprof_sample_scale(src->entry[i].t_tot, count, skip);
+		entry->t_err += ibprof_sample_scale(src->entry[i].t_err, count, skip);
+		entry->t_max = sys_max(entry->t_max, src->entry[i].t_max);
+	}
+}
+
+/**
+ * ibprof_resource_gather
+ *
+ * @brief
+ *    Merges tables of a call collected by all threads in given generation
+ *    and returns objects with the most time (result should be released
+ *    by caller). Objects of sampled calls are scaled to all invocations.
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[out]   result          Objects sorted by estimated time.
+ * @param[out]   format          printf format of object key.
+ *
+ * @retval (count) - number of objects in result
+ ***************************************************************************/
+int ibprof_resource_gather(IBPROF_THREAD_OBJECT *thread_list, int generation,
+			int module, int call, IBPROF_RESOURCE_OBJ **result, const char **format)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_RESOURCE_TABLE *table = NULL;
+	IBPROF_RESOURCE_OBJ *entries = NULL;
+	int64_t calls = 0;
+	int64_t skip = 0;
+	int count = 0;
+	int i = 0;
+	int j = 0;
+	int k = 0;
+
+	*result = NULL;
+	*format = NULL;
+
+	for (thread_obj = thread_list; thread_obj; thread_obj = thread_obj->next) {
+		table = __atomic_load_n(&thread_obj->resource_table[module][call], __ATOMIC_ACQUIRE);
+		if (table && (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) == generation))
+			count += __atomic_load_n(&table->count, __ATOMIC_ACQUIRE);
+	}
+	if (!count)
+		return 0;
+
+	entries = (IBPROF_RESOURCE_OBJ *) sys_malloc(count * sizeof(IBPROF_RESOURCE_OBJ));
+	if (!entries)
+		return 0;
+
+	/* Tables can grow while they are copied, the rest is taken next time */
+	for (thread_obj = thread_list, i = 0; thread_obj && (i < count); thread_obj = thread_obj->next) {
+		table = __atomic_load_n(&thread_obj->resource_table[module][call], __ATOMIC_ACQUIRE);
+		if (!table || (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) != generation))
+			continue;
+		j = sys_min(__atomic_load_n(&table->count, __ATOMIC_ACQUIRE), count - i);
+		sys_memcpy(&entries[i], table->entry, j * sizeof(IBPROF_RESOURCE_OBJ));
+		*format = table->format;
+
+		/* Objects of sampled call are collected over measured invocations */
+		calls = thread_obj->call_table[module][call].count;
+		skip = thread_obj->sample_skip[module][call];
+		for (k = i; (skip > 0) && (k < i + j); k++) {
+			entries[k].count = ibprof_sample_scale(entries[k].count, calls, skip);
+			entries[k].t_tot = ibprof_sample_scale(entries[k].t_tot, calls, skip);
+			entries[k].t_err = ibprof_sample_scale(entries[k].t_err, calls, skip);
+		}
+		i += j;
+	}
+	count = i;
+
+	/* Object used by several threads is summed */
+	qsort(entries, count, sizeof(IBPROF_RESOURCE_OBJ), __resource_key_compare);
+	for (i = 0, j = 0; i < count; i++) {
+		if (j && (entries[j - 1].key == entries[i].key)) {
+			entries[j - 1].count += entries[i].count;
+			entries[j - 1].t_tot += entries[i].t_tot;
+			entries[j - 1].t_err += entries[i].t_err;
+			entries[j - 1].t_max = sys_max(entries[j - 1].t_max, entries[i].t_max);
+		} else
+			entries[j++] = entries[i];
+	}
+	count = j;
+
+	qsort(entries, count, sizeof(IBPROF_RESOURCE_OBJ), __resource_weight_compare);
+
+	*result = entries;
+
+	return sys_min(count, ibprof_resource_size);
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_resource.h
+ *
+ * @brief This file is place for resource attribution
+ *         declaration and operations definition.
+ *
+ * Data path calls can be attributed to the object they are applied to
+ * (QP, CQ, PD ...). Every thread keeps table of at most ibprof_resource_size
+ * objects per call. When table is full the object with the least total
+ * time is replaced by new one that inherits its time as possible
+ * overestimation (Space-Saving algorithm), so memory does not depend on
+ * number of objects and objects that take most of the time are kept.
+ *
+ **/
+#ifndef _IBPROF_RESOURCE_H_
+#define _IBPROF_RESOURCE_H_
+
+#define RESOURCE_MAX_SIZE     (1024) /* Limits linear search on update */
+
+/**
+ * @struct _IBPROF_RESOURCE_OBJ
+ * @brief Statistics of a call applied to single object
+ */
+typedef struct _IBPROF_RESOURCE_OBJ {
+	uint64_t key; /**< object (handle or number) */
+	int64_t count; /**< number of calls */
+	int64_t t_tot; /**< total time (ticks) */
+	int64_t t_max; /**< maximum time (ticks) */
+	int64_t t_err; /**< time inherited from replaced object (ticks) */
+} IBPROF_RESOURCE_OBJ;
+
+/**
+ * @struct _IBPROF_RESOURCE_TABLE
+ * @brief Bounded table of objects of a call
+ */
+typedef struct _IBPROF_RESOURCE_TABLE {
+	const char *format; /**< printf format of object key */
+	int count; /**< number of used entries */
+	int last; /**< last updated entry */
+	IBPROF_RESOURCE_OBJ entry[1]; /**< ibprof_resource_size entries */
+} IBPROF_RESOURCE_TABLE;
+
+struct _IBPROF_THREAD_OBJECT;
+
+extern int ibprof_resource_size;
+
+/**
+ * ibprof_resource_init
+ *
+ * @brief
+ *    Set number of objects kept per call.
+ *
+ * @param[in]    size            Number of objects (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_resource_init(int size);
+
+/**
+ * ibprof_resource_create
+ *
+ * @brief
+ *    Allocates memory for new table.
+ *
+ * @param[in]    format          printf format of object key.
+ *
+ * @retval pointer to new table - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_RESOURCE_TABLE *ibprof_resource_create(const char *format);
+
+/**
+ * ibprof_resource_find
+ *
+ * @brief
+ *    Return entry of given object, object with the least time
+ *    is replaced if table is full.
+ *
+ * @return pointer to entry
+ ***************************************************************************/
+IBPROF_RESOURCE_OBJ *ibprof_resource_find(IBPROF_RESOURCE_TABLE *table, uint64_t key);
+
+/**
+ * ibprof_resource_merge
+ *
+ * @brief
+ *    Adds objects of a call to destination table. Objects of
+ *    sampled call are scaled to all invocations.
+ *
+ * @param[in]    dst             Destination table.
+ * @param[in]    src             Table to be added.
+ * @param[in]    count           Number of measured invocations.
+ * @param[in]    skip            Number of invocations that were not measured.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_resource_merge(IBPROF_RESOURCE_TABLE *dst, const IBPROF_RESOURCE_TABLE *src,
+			int64_t count, int64_t skip);
+
+/**
+ * ibprof_resource_gather
+ *
+ * @brief
+ *    Merges tables of a call collected by all threads in given generation
+ *    and returns objects with the most time (result should be released
+ *    by caller). Objects of sampled calls are scaled to all invocations.
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[out]   result          Objects sorted by estimated time.
+ * @param[out]   format          printf format of object key.
+ *
+ * @retval (count) - number of objects in result
+ ***************************************************************************/
+int ibprof_resource_gather(struct _IBPROF_THREAD_OBJECT *thread_list, int generation,
+			int module, int call, IBPROF_RESOURCE_OBJ **result, const char **format);
+
+/**
+ * ibprof_resource_update
+ *
+ * @brief
+ *    Account call applied to given object.
+ *    It is called by the owner thread only.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_resource_update(IBPROF_RESOURCE_TABLE *table, uint64_t key, int64_t tm)
+{
+	IBPROF_RESOURCE_OBJ *entry = &table->entry[table->last];
+
+	/* Calls to the same object usually come in a row */
+	if (!table->count || (entry->key != key))
+		entry = ibprof_resource_find(table, key);
+
+	entry->count++;
+	entry->t_tot += tm;
+	if (tm > entry->t_max)
+		entry->t_max = tm;
+}
+
+#endif /* _IBPROF_RESOURCE_H_ */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+int ibprof_sample_active = 0;
+int ibprof_sample_rate[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+
+/**
+ * ibprof_sample_match
+ *
+ * @brief
+ *    Checks if call name is selected by a name given in configuration.
+ *
+ * @param[in]    call_name       Name of module call.
+ * @param[in]    name            Name given by user (not terminated).
+ * @param[in]    len             Length of name.
+ *
+ * @retval (1) - call is selected
+ * @retval (0) - otherwise
+ ***************************************************************************/
+int ibprof_sample_match(const char *call_name, const char *name, int len)
+{
+	int call_len = sys_strlen(call_name);
+
+	if (call_len < len)
+		return 0;
+	if (call_len == len)
+		return !sys_memcmp(call_name, name, len);
+
+	/* Suffix after library prefix */
+	return (call_name[call_len - len - 1] == '_') &&
+		!sys_memcmp(call_name + call_len - len, name, len);
+}
+
+static int __sample_set(IBPROF_MODULE_OBJECT **module_array, const char *name, int len, int rate)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	int matched = 0;
+	int i = 0;
+
+	for (i = 0; (module_obj = module_array[i]); i++) {
+		if ((module_obj->id == IBPROF_MODULE_INVALID) ||
+			(module_obj->id >= IBPROF_MODULE_USER) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if ((module_call->call < 0) || (module_call->call > HASH_MAX_CALL))
+				continue;
+			if (ibprof_sample_match(module_call->name, name, len)) {
+				ibprof_sample_rate[module_obj->id][module_call->call] = rate;
+				matched++;
+			}
+		}
+	}
+
+	return matched;
+}
+
+/**
+ * ibprof_sample_init
+ *
+ * @brief
+ *    Parses list of sampled calls in form "name:1/N,name:1/N".
+ *    Name matches call with the same name or with the same name
+ *    after library prefix (poll_cq matches ibv_poll_cq and ibv_exp_poll_cq).
+ *
+ * @param[in]    spec            List of sampled calls or NULL.
+ * @param[in]    module_array    Array of available modules.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_sample_init(const char *spec, IBPROF_MODULE_OBJECT **module_array)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	const char *item = spec;
+	const char *sep = NULL;
+	const char *rate_str = NULL;
+	char *end = NULL;
+	long rate = 0;
+	int len = 0;
+
+	sys_memset(ibprof_sample_rate, 0, sizeof(ibprof_sample_rate));
+	ibprof_sample_active = 0;
+
+	while (item && *item) {
+		sep = sys_strchr(item, ':');
+		if (!sep) {
+			status = IBPROF_ERR_BAD_ARGUMENT;
+			break;
+		}
+		len = (int)(sep - item);
+
+		/* Rate is given as "1/N" or "N" */
+		rate_str = sep + 1;
+		if ((rate_str[0] == '1') && (rate_str[1] == '/'))
+			rate_str += 2;
+		rate = sys_strtol(rate_str, &end, 0);
+		if ((end == rate_str) || (*end && (*end != ',')) || (rate < 1) || (rate > INT32_MAX)) {
+			status = IBPROF_ERR_BAD_ARGUMENT;
+			break;
+		}
+
+		if (len && __sample_set(module_array, item, len, (int)rate)) {
+			if (rate > 1)
+				ibprof_sample_active = 1;
+		} else {
+			IBPROF_WARN("IBPROF_SAMPLE : unknown call '%.*s'\n", len, item);
+		}
+
+		item = (*end ? end + 1 : end);
+	}
+
+	if (status != IBPROF_ERR_NONE) {
+		IBPROF_WARN("IBPROF_SAMPLE : incorrect value '%s', sampling is disabled\n", spec);
+		sys_memset(ibprof_sample_rate, 0, sizeof(ibprof_sample_rate));
+		ibprof_sample_active = 0;
+	}
+
+	return status;
+}
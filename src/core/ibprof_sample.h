@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_sample.h
+ *
+ * @brief This file is place for call sampling
+ *         declaration and operations definition.
+ *
+ * Calls that are made millions of times per second (polls, posts) can be
+ * measured on every Nth invocation only. Every thread keeps countdown per
+ * call, so the choice costs a decrement and does not need random
+ * generator. Skipped invocations are counted exactly and timing totals
+ * are scaled by the ratio of all invocations to measured ones on dump.
+ *
+ **/
+#ifndef _IBPROF_SAMPLE_H_
+#define _IBPROF_SAMPLE_H_
+
+extern int ibprof_sample_active;
+extern int ibprof_sample_rate[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+
+/**
+ * ibprof_sample_init
+ *
+ * @brief
+ *    Parses list of sampled calls in form "name:1/N,name:1/N".
+ *    Name matches call with the same name or with the same name
+ *    after library prefix (poll_cq matches ibv_poll_cq and ibv_exp_poll_cq).
+ *
+ * @param[in]    spec            List of sampled calls or NULL.
+ * @param[in]    module_array    Array of available modules.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_sample_init(const char *spec, IBPROF_MODULE_OBJECT **module_array);
+
+/**
+ * ibprof_sample_match
+ *
+ * @brief
+ *    Checks if call name is selected by a name given in configuration.
+ *
+ * @param[in]    call_name       Name of module call.
+ * @param[in]    name            Name given by user (not terminated).
+ * @param[in]    len             Length of name.
+ *
+ * @retval (1) - call is selected
+ * @retval (0) - otherwise
+ ***************************************************************************/
+int ibprof_sample_match(const char *call_name, const char *name, int len);
+
+/**
+ * ibprof_sample_scale
+ *
+ * @brief
+ *    Return value collected over measured invocations of a call
+ *    extrapolated to all invocations.
+ *
+ * @param[in]    value           Value collected over measured invocations.
+ * @param[in]    count           Number of measured invocations.
+ * @param[in]    skip            Number of skipped invocations.
+ *
+ * @return scaled value
+ ***************************************************************************/
+static INLINE int64_t ibprof_sample_scale(int64_t value, int64_t count, int64_t skip)
+{
+	if ((count <= 0) || (skip <= 0))
+		return value;
+
+	return value + (int64_t)((double)value * skip / count);
+}
+
+#endif /* _IBPROF_SAMPLE_H_ */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+#include "ibprof_io.h"
+
+static struct {
+	int active; /* snapshot thread is running */
+	pthread_t thread; /* snapshot thread */
+	pthread_mutex_t mutex; /* protects stop flag */
+	pthread_cond_t cond; /* signalled on termination request */
+	int stop; /* termination request */
+	int interval; /* period in seconds */
+	int delta; /* output statistics of last period only */
+	int count; /* number of snapshots done */
+	double t_last; /* time of previous snapshot (sec since start) */
+	int generation; /* dump generation of previous snapshot */
+	IBPROF_HASH_OBJECT *hash_obj; /* statistics at current snapshot */
+	IBPROF_HASH_OBJECT *prev_obj; /* statistics at previous snapshot (delta) */
+	IBPROF_HASH_OBJECT *next_obj; /* copy of statistics at current snapshot (delta) */
+} snapshot_ctx;
+
+/****************************************************************************
+ * Static Function Declarations
+ ***************************************************************************/
+static void __snapshot_dump(void)
+{
+	IBPROF_OBJECT dump_obj;
+	IBPROF_TASK_OBJECT task_obj;
+	IBPROF_HASH_OBJECT *temp_obj = NULL;
+	double t_now = 0;
+
+	sys_memset(&dump_obj, 0, sizeof(dump_obj));
+	dump_obj.hash_obj = snapshot_ctx.hash_obj;
+
+	/* Statistics are copied under the lock and formatted out of it */
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	ibprof_thread_gather(dump_obj.hash_obj, ibprof_obj->thread_list,
+			ibprof_obj->generation);
+	dump_obj.thread_list = ibprof_thread_copy(ibprof_obj->thread_list,
+			ibprof_obj->generation);
+	dump_obj.module_array = ibprof_obj->module_array;
+	dump_obj.generation = ibprof_obj->generation;
+	task_obj = *ibprof_obj->task_obj;
+	dump_obj.task_obj = &task_obj;
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+	/*
+	 * Statistics of threads are never dropped by snapshot (so no call is lost),
+	 * delta is found as difference with the state at previous snapshot
+	 */
+	if (snapshot_ctx.delta) {
+		ibprof_hash_clear(snapshot_ctx.next_obj);
+		ibprof_hash_merge(snapshot_ctx.next_obj, dump_obj.hash_obj);
+		if (snapshot_ctx.generation != dump_obj.generation)
+			ibprof_hash_clear(snapshot_ctx.prev_obj);
+		ibprof_hash_subtract(dump_obj.hash_obj, snapshot_ctx.prev_obj);
+
+		temp_obj = snapshot_ctx.prev_obj;
+		snapshot_ctx.prev_obj = snapshot_ctx.next_obj;
+		snapshot_ctx.next_obj = temp_obj;
+		snapshot_ctx.generation = dump_obj.generation;
+	}
+
+	t_now = ibprof_task_wall_time(task_obj.t_start);
+	task_obj.wall_time = (snapshot_ctx.delta ? t_now - snapshot_ctx.t_last : t_now);
+	snapshot_ctx.t_last = t_now;
+
+	dump_obj.snapshot = ++snapshot_ctx.count;
+	if (ibprof_hash_count(dump_obj.hash_obj)) {
+		flockfile(ibprof_dump_file);
+		format_dump(ibprof_dump_file, &dump_obj);
+		fflush(ibprof_dump_file);
+		funlockfile(ibprof_dump_file);
+	}
+
+	ibprof_thread_copy_destroy(dump_obj.thread_list);
+}
+
+static void *__snapshot_thread(void *arg)
+{
+	struct timespec deadline;
+	struct timespec now;
+	UNREFERENCED_PARAMETER(arg);
+
+	pthread_mutex_lock(&snapshot_ctx.mutex);
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += snapshot_ctx.interval;
+
+	while (!snapshot_ctx.stop) {
+		if (pthread_cond_timedwait(&snapshot_ctx.cond, &snapshot_ctx.mutex,
+				&deadline) != ETIMEDOUT)
+			continue;
+
+		pthread_mutex_unlock(&snapshot_ctx.mutex);
+		__snapshot_dump();
+		pthread_mutex_lock(&snapshot_ctx.mutex);
+
+		/* Keep period stable but do not try to catch up after long output */
+		deadline.tv_sec += snapshot_ctx.interval;
+		clock_gettime(CLOCK_REALTIME, &now);
+		if (deadline.tv_sec < now.tv_sec)
+			deadline.tv_sec = now.tv_sec + snapshot_ctx.interval;
+	}
+
+	pthread_mutex_unlock(&snapshot_ctx.mutex);
+
+	return NULL;
+}
+
+/**
+ * ibprof_snapshot_init
+ *
+ * @brief
+ *    Starts snapshot thread if IBPROF_DUMP_INTERVAL is set.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_snapshot_init(void)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+
+	sys_memset(&snapshot_ctx, 0, sizeof(snapshot_ctx));
+	snapshot_ctx.interval = ibprof_conf_get_int(IBPROF_DUMP_INTERVAL);
+	snapshot_ctx.delta = ibprof_conf_get_int(IBPROF_DUMP_DELTA);
+
+	if (snapshot_ctx.interval <= 0)
+		return status;
+
+	if (format_dump == ibprof_io_chrome_dump) {
+		status = IBPROF_ERR_UNSUPPORTED;
+		IBPROF_WARN("%s : error=%d - Snapshots are not supported by chrome format\n",
+				__FUNCTION__, status);
+		return status;
+	}
+
+	snapshot_ctx.hash_obj = ibprof_hash_create(HASH_MAX_SIZE);
+	if (!snapshot_ctx.hash_obj) {
+		status = IBPROF_ERR_NO_MEMORY;
+		IBPROF_ERROR("%s : error=%d - Can't create hash object\n",
+				__FUNCTION__, status);
+		goto err;
+	}
+
+	if (snapshot_ctx.delta) {
+		snapshot_ctx.prev_obj = ibprof_hash_create(HASH_MAX_SIZE);
+		snapshot_ctx.next_obj = ibprof_hash_create(HASH_MAX_SIZE);
+		if (!snapshot_ctx.prev_obj || !snapshot_ctx.next_obj) {
+			status = IBPROF_ERR_NO_MEMORY;
+			IBPROF_ERROR("%s : error=%d - Can't create hash object\n",
+					__FUNCTION__, status);
+			goto err;
+		}
+	}
+
+	pthread_mutex_init(&snapshot_ctx.mutex, NULL);
+	pthread_cond_init(&snapshot_ctx.cond, NULL);
+	if (pthread_create(&snapshot_ctx.thread, NULL, __snapshot_thread, NULL)) {
+		status = IBPROF_ERR_INCORRECT;
+		IBPROF_ERROR("%s : error=%d - Can't start snapshot thread\n",
+				__FUNCTION__, status);
+		pthread_cond_destroy(&snapshot_ctx.cond);
+		pthread_mutex_destroy(&snapshot_ctx.mutex);
+		goto err;
+	}
+
+	snapshot_ctx.active = 1;
+
+	return status;
+
+err:
+	ibprof_hash_destroy(snapshot_ctx.hash_obj);
+	ibprof_hash_destroy(snapshot_ctx.prev_obj);
+	ibprof_hash_destroy(snapshot_ctx.next_obj);
+	snapshot_ctx.hash_obj = NULL;
+	snapshot_ctx.prev_obj = NULL;
+	snapshot_ctx.next_obj = NULL;
+
+	return status;
+}
+
+/**
+ * ibprof_snapshot_exit
+ *
+ * @brief
+ *    Stops snapshot thread and releases its resources.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_snapshot_exit(void)
+{
+	if (!snapshot_ctx.active)
+		return;
+
+	pthread_mutex_lock(&snapshot_ctx.mutex);
+	snapshot_ctx.stop = 1;
+	pthread_cond_signal(&snapshot_ctx.cond);
+	pthread_mutex_unlock(&snapshot_ctx.mutex);
+
+	pthread_join(snapshot_ctx.thread, NULL);
+
+	pthread_cond_destroy(&snapshot_ctx.cond);
+	pthread_mutex_destroy(&snapshot_ctx.mutex);
+
+	ibprof_hash_destroy(snapshot_ctx.hash_obj);
+	ibprof_hash_destroy(snapshot_ctx.prev_obj);
+	ibprof_hash_destroy(snapshot_ctx.next_obj);
+	snapshot_ctx.hash_obj = NULL;
+	snapshot_ctx.prev_obj = NULL;
+	snapshot_ctx.next_obj = NULL;
+	snapshot_ctx.active = 0;
+}
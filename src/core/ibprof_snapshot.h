@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_snapshot.h
+ *
+ * @brief This file is place for periodic snapshot
+ *         declaration and operations definition.
+ *
+ * Snapshot thread wakes up every IBPROF_DUMP_INTERVAL seconds, gathers
+ * statistics of all threads and outputs them to dump file. Application
+ * threads are not stopped: they update own tables while those are merged.
+ *
+ * Delta snapshot (IBPROF_DUMP_DELTA=1) covers period since previous one.
+ * It is found as difference with statistics kept at previous snapshot,
+ * so threads statistics are not dropped and the final dump still reports
+ * the whole run. Cumulative snapshot covers period since the process start.
+ *
+ **/
+#ifndef _IBPROF_SNAPSHOT_H_
+#define _IBPROF_SNAPSHOT_H_
+
+/**
+ * ibprof_snapshot_init
+ *
+ * @brief
+ *    Starts snapshot thread if IBPROF_DUMP_INTERVAL is set.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_snapshot_init(void);
+
+/**
+ * ibprof_snapshot_exit
+ *
+ * @brief
+ *    Stops snapshot thread and releases its resources.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_snapshot_exit(void);
+
+#endif /* _IBPROF_SNAPSHOT_H_ */
@@ -0,0 +1,605 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+__thread IBPROF_THREAD_OBJECT *ibprof_thread_obj = NULL;	/* Statistics of the calling thread */
+
+int ibprof_thread_top = 0;
+
+static pthread_key_t thread_key;	/* Releases object of exited thread */
+static int thread_key_active = 0;
+static int thread_number = 0;
+
+static void __thread_detach(void *arg);
+
+static int __thread_call_compare(const void *a, const void *b)
+{
+	int64_t t_a = ((const IBPROF_THREAD_CALL *)a)->t_tot;
+	int64_t t_b = ((const IBPROF_THREAD_CALL *)b)->t_tot;
+
+	return (t_a > t_b ? -1 : (t_a < t_b));
+}
+
+/**
+ * ibprof_thread_init
+ *
+ * @brief
+ *    Set number of threads reported per call.
+ *
+ * @param[in]    top             Number of threads (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_thread_init(int top)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+
+	if (top < 0) {
+		status = IBPROF_ERR_BAD_ARGUMENT;
+		IBPROF_WARN("%s : error=%d - Number of threads %d is negative, 0 is used\n",
+				__FUNCTION__, status, top);
+		top = 0;
+	}
+
+	ibprof_thread_top = top;
+	thread_number = 0;
+
+	if (pthread_key_create(&thread_key, __thread_detach)) {
+		status = IBPROF_ERR_INCORRECT;
+		IBPROF_WARN("%s : error=%d - Can't create thread key, objects of exited threads are kept\n",
+				__FUNCTION__, status);
+	} else
+		thread_key_active = 1;
+
+	return status;
+}
+
+/**
+ * ibprof_thread_exit
+ *
+ * @brief
+ *    Stops releasing objects of exited threads. It is called before
+ *    the list of thread objects is destroyed.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_exit(void)
+{
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	if (thread_key_active) {
+		pthread_key_delete(thread_key);
+		thread_key_active = 0;
+	}
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+}
+
+/**
+ * ibprof_thread_create
+ *
+ * @brief
+ *    Allocates memory for new thread object and set initial values.
+ *
+ * @param[in]    rank            Process rank.
+ * @param[in]    generation      Current dump generation.
+ *
+ * @retval pointer to new thread object - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_THREAD_OBJECT *ibprof_thread_create(int rank, int generation)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	int module = 0;
+	int call = 0;
+
+	thread_obj = (IBPROF_THREAD_OBJECT *) sys_malloc(sizeof(IBPROF_THREAD_OBJECT));
+	if (thread_obj) {
+		thread_obj->hash_obj = ibprof_hash_create(HASH_THREAD_SIZE);
+		if (thread_obj->hash_obj) {
+			for (module = 0; module < IBPROF_MODULE_USER; module++) {
+				for (call = 0; call <= HASH_MAX_CALL; call++) {
+					ibprof_hash_entry_init(&thread_obj->call_table[module][call]);
+					thread_obj->call_table[module][call].key =
+						HASH_KEY_SET(module, call, rank, 0);
+					thread_obj->resource_table[module][call] = NULL;
+					thread_obj->counter_table[module][call] = NULL;
+					thread_obj->sample_countdown[module][call] = 0;
+					thread_obj->sample_skip[module][call] = 0;
+					thread_obj->fault_count[module][call] = 0;
+					thread_obj->fault_burst[module][call] = 0;
+				}
+			}
+			thread_obj->interval_stack.depth = 0;
+			thread_obj->interval_stack.lost = 0;
+			thread_obj->fault_rand = 0;
+			thread_obj->number = 0;
+			thread_obj->tid = sys_threadid();
+			thread_obj->generation = generation;
+			thread_obj->trace_ring = NULL;
+			thread_obj->next = NULL;
+		} else {
+			sys_free(thread_obj);
+			thread_obj = NULL;
+		}
+	}
+
+	return thread_obj;
+}
+
+/**
+ * ibprof_thread_destroy
+ *
+ * @brief
+ *    Releases all used resources and free memory allocated for internal object.
+ *
+ * @param[in]    thread_obj      Thread object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_destroy(IBPROF_THREAD_OBJECT *thread_obj)
+{
+	int module = 0;
+	int call = 0;
+
+	if (thread_obj) {
+		for (module = 0; module < IBPROF_MODULE_USER; module++) {
+			for (call = 0; call <= HASH_MAX_CALL; call++) {
+				sys_free(thread_obj->call_table[module][call].hist);
+				sys_free(thread_obj->resource_table[module][call]);
+				sys_free(thread_obj->counter_table[module][call]);
+			}
+		}
+		ibprof_hash_destroy(thread_obj->hash_obj);
+		ibprof_trace_ring_destroy(thread_obj->trace_ring);
+		sys_free(thread_obj);
+	}
+}
+
+/**
+ * ibprof_thread_reset
+ *
+ * @brief
+ *    Drops statistics collected by the thread and moves it to new generation.
+ *    It is called by the owner thread only.
+ *
+ * @param[in]    thread_obj      Thread object.
+ * @param[in]    generation      Current dump generation.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_reset(IBPROF_THREAD_OBJECT *thread_obj, int generation)
+{
+	int module = 0;
+	int call = 0;
+
+	for (module = 0; module < IBPROF_MODULE_USER; module++) {
+		for (call = 0; call <= HASH_MAX_CALL; call++) {
+			ibprof_hash_entry_init(&thread_obj->call_table[module][call]);
+			if (thread_obj->resource_table[module][call])
+				thread_obj->resource_table[module][call]->count = 0;
+			if (thread_obj->counter_table[module][call])
+				sys_memset(thread_obj->counter_table[module][call]->value, 0,
+						sizeof(thread_obj->counter_table[module][call]->value));
+			thread_obj->sample_countdown[module][call] = 0;
+			thread_obj->sample_skip[module][call] = 0;
+		}
+	}
+	ibprof_hash_clear(thread_obj->hash_obj);
+
+	/* Table is not visible for merge until it is cleaned */
+	__atomic_store_n(&thread_obj->generation, generation, __ATOMIC_RELEASE);
+}
+
+static void __thread_sample_scale(IBPROF_HASH_OBJ *dst, IBPROF_HASH_OBJ *src,
+			int64_t count, int64_t skip)
+{
+	*dst = *src;
+	dst->count = ibprof_sample_scale(src->count, count, skip);
+	dst->samples = ibprof_sample_scale(src->samples, count, skip);
+	dst->t_tot = ibprof_sample_scale(src->t_tot, count, skip);
+	dst->bytes = ibprof_sample_scale(src->bytes, count, skip);
+}
+
+static int __thread_merge_hash(IBPROF_HASH_OBJECT *dst_obj, IBPROF_THREAD_OBJECT *thread_obj)
+{
+	IBPROF_HASH_OBJ *src = NULL;
+	IBPROF_HASH_OBJ entry;
+	HASH_KEY key;
+	int merged = 0;
+	int module = 0;
+	int call = 0;
+	int i = 0;
+
+	/* Size classes of sampled calls are scaled as their aggregate */
+	for (i = 0; i < thread_obj->hash_obj->size; i++) {
+		src = &(thread_obj->hash_obj->hash_table[i]);
+		key = __atomic_load_n(&src->key, __ATOMIC_ACQUIRE);
+		if (key == HASH_KEY_INVALID || src->count <= 0)
+			continue;
+
+		module = HASH_KEY_GET_MODULE(key);
+		call = HASH_KEY_GET_CALL(key);
+		if ((module < IBPROF_MODULE_USER) && (thread_obj->sample_skip[module][call] > 0)) {
+			__thread_sample_scale(&entry, src,
+					thread_obj->call_table[module][call].count,
+					thread_obj->sample_skip[module][call]);
+			src = &entry;
+		}
+
+		if (ibprof_hash_accumulate(dst_obj, src))
+			break;
+		merged++;
+	}
+
+	return merged;
+}
+
+/*
+ * Return container of exited threads, it is kept at the tail of list
+ */
+static IBPROF_THREAD_OBJECT *__thread_retired(void)
+{
+	IBPROF_THREAD_OBJECT **tail = &ibprof_obj->thread_list;
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	for (; *tail; tail = &(*tail)->next)
+		thread_obj = *tail;
+
+	if (thread_obj && (thread_obj->number == IBPROF_THREAD_RETIRED)) {
+		if (thread_obj->generation != ibprof_obj->generation)
+			ibprof_thread_reset(thread_obj, ibprof_obj->generation);
+		return thread_obj;
+	}
+
+	thread_obj = ibprof_thread_create(ibprof_obj->task_obj->procid,
+			ibprof_obj->generation);
+	if (thread_obj) {
+		thread_obj->number = IBPROF_THREAD_RETIRED;
+		thread_obj->tid = 0;
+		*tail = thread_obj;
+	}
+
+	return thread_obj;
+}
+
+/*
+ * Accumulate all statistics of a thread with sampled calls scaled to all
+ * invocations. Thread can be updated by its owner at the same time.
+ */
+static void __thread_fold(IBPROF_THREAD_OBJECT *dst_obj, IBPROF_THREAD_OBJECT *thread_obj)
+{
+	IBPROF_HASH_OBJ *src = NULL;
+	IBPROF_HASH_OBJ entry;
+	IBPROF_COUNTER_TABLE *counter = NULL;
+	IBPROF_RESOURCE_TABLE *resource = NULL;
+	int64_t count = 0;
+	int64_t skip = 0;
+	int module = 0;
+	int call = 0;
+
+	for (module = 0; module < IBPROF_MODULE_USER; module++) {
+		for (call = 0; call <= HASH_MAX_CALL; call++) {
+			src = &thread_obj->call_table[module][call];
+			if (src->count <= 0)
+				continue;
+
+			count = src->count;
+			skip = thread_obj->sample_skip[module][call];
+			if (skip > 0) {
+				__thread_sample_scale(&entry, src, count, skip);
+				entry.count = count + skip;
+				src = &entry;
+			}
+			ibprof_hash_entry_accumulate(&dst_obj->call_table[module][call], src);
+
+			counter = __atomic_load_n(&thread_obj->counter_table[module][call], __ATOMIC_ACQUIRE);
+			if (counter) {
+				if (!dst_obj->counter_table[module][call])
+					__atomic_store_n(&dst_obj->counter_table[module][call],
+							ibprof_counter_create(counter->desc), __ATOMIC_RELEASE);
+				if (dst_obj->counter_table[module][call])
+					ibprof_counter_merge(dst_obj->counter_table[module][call],
+							counter, count, skip);
+			}
+
+			resource = __atomic_load_n(&thread_obj->resource_table[module][call], __ATOMIC_ACQUIRE);
+			if (resource) {
+				if (!dst_obj->resource_table[module][call])
+					__atomic_store_n(&dst_obj->resource_table[module][call],
+							ibprof_resource_create(resource->format), __ATOMIC_RELEASE);
+				if (dst_obj->resource_table[module][call])
+					ibprof_resource_merge(dst_obj->resource_table[module][call],
+							resource, count, skip);
+			}
+		}
+	}
+
+	__thread_merge_hash(dst_obj->hash_obj, thread_obj);
+}
+
+/*
+ * Statistics of exited thread are moved to container of exited threads
+ * and its object is released
+ */
+static void __thread_detach(void *arg)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = (IBPROF_THREAD_OBJECT *)arg;
+	IBPROF_THREAD_OBJECT *retired = NULL;
+	IBPROF_THREAD_OBJECT **prev = NULL;
+
+	if (!ibprof_obj)
+		return;
+
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	for (prev = &ibprof_obj->thread_list; *prev && (*prev != thread_obj); prev = &(*prev)->next)
+		;
+	if (thread_key_active && *prev) {
+		*prev = thread_obj->next;
+		/* Statistics collected before last dump are not taken */
+		if ((thread_obj->generation == ibprof_obj->generation) &&
+			(retired = __thread_retired()))
+			__thread_fold(retired, thread_obj);
+		ibprof_trace_ring_retire(thread_obj->trace_ring);
+		thread_obj->trace_ring = NULL;
+	} else
+		thread_obj = NULL;
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+	/* Calls made by destructors of other keys attach new object */
+	if (thread_obj) {
+		ibprof_thread_obj = NULL;
+		ibprof_thread_destroy(thread_obj);
+	}
+}
+
+/**
+ * ibprof_thread_merge
+ *
+ * @brief
+ *    Accumulates all statistics of thread object into hash object.
+ *    Thread object can be updated by its owner at the same time.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    thread_obj      Thread object.
+ *
+ * @retval (count) - number of merged elements
+ ***************************************************************************/
+int ibprof_thread_merge(IBPROF_HASH_OBJECT *dst_obj, IBPROF_THREAD_OBJECT *thread_obj)
+{
+	IBPROF_HASH_OBJ *src = NULL;
+	IBPROF_HASH_OBJ entry;
+	int merged = 0;
+	int module = 0;
+	int call = 0;
+
+	for (module = 0; module < IBPROF_MODULE_USER; module++) {
+		for (call = 0; call <= HASH_MAX_CALL; call++) {
+			src = &thread_obj->call_table[module][call];
+			if (src->count <= 0)
+				continue;
+
+			if (thread_obj->sample_skip[module][call] > 0) {
+				__thread_sample_scale(&entry, src, src->count,
+						thread_obj->sample_skip[module][call]);
+				entry.count = src->count + thread_obj->sample_skip[module][call];
+				src = &entry;
+			}
+
+			if (ibprof_hash_accumulate(dst_obj, src))
+				return merged;
+			merged++;
+		}
+	}
+
+	return merged + __thread_merge_hash(dst_obj, thread_obj);
+}
+
+/**
+ * ibprof_thread_gather
+ *
+ * @brief
+ *    Replaces content of hash object with statistics of all threads
+ *    collected in given generation. It should be called under the lock
+ *    of basis object.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ *
+ * @retval (count) - number of merged elements
+ ***************************************************************************/
+int ibprof_thread_gather(IBPROF_HASH_OBJECT *dst_obj, IBPROF_THREAD_OBJECT *thread_list,
+			int generation)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	int merged = 0;
+
+	ibprof_hash_clear(dst_obj);
+	for (thread_obj = thread_list; thread_obj; thread_obj = thread_obj->next) {
+		if (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) == generation)
+			merged += ibprof_thread_merge(dst_obj, thread_obj);
+	}
+
+	return merged;
+}
+
+/**
+ * ibprof_thread_copy
+ *
+ * @brief
+ *    Copies statistics of all threads collected in given generation to
+ *    private list that is read without the lock. Sampled calls are scaled
+ *    to all invocations. It should be called under the lock of basis object.
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ *
+ * @retval list of copies (released by ibprof_thread_copy_destroy())
+ ***************************************************************************/
+IBPROF_THREAD_OBJECT *ibprof_thread_copy(IBPROF_THREAD_OBJECT *thread_list, int generation)
+{
+	IBPROF_THREAD_OBJECT *copy_list = NULL;
+	IBPROF_THREAD_OBJECT **tail = &copy_list;
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	for (thread_obj = thread_list; thread_obj; thread_obj = thread_obj->next) {
+		if (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) != generation)
+			continue;
+
+		*tail = ibprof_thread_create(ibprof_obj->task_obj->procid, generation);
+		if (!*tail) {
+			IBPROF_ERROR("%s : error=%d - Can't allocate memory, statistics of "
+					"some threads are not output\n", __FUNCTION__, IBPROF_ERR_NO_MEMORY);
+			break;
+		}
+		(*tail)->number = thread_obj->number;
+		(*tail)->tid = thread_obj->tid;
+		__thread_fold(*tail, thread_obj);
+		tail = &(*tail)->next;
+	}
+
+	return copy_list;
+}
+
+/**
+ * ibprof_thread_copy_destroy
+ *
+ * @brief
+ *    Releases list of copies made by ibprof_thread_copy().
+ *
+ * @param[in]    copy_list       List of copies.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_copy_destroy(IBPROF_THREAD_OBJECT *copy_list)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	while ((thread_obj = copy_list)) {
+		copy_list = thread_obj->next;
+		ibprof_thread_destroy(thread_obj);
+	}
+}
+
+/**
+ * ibprof_thread_call_gather
+ *
+ * @brief
+ *    Collects statistics of a call made by every thread in given generation.
+ *    Result is sorted by total time and should be freed with sys_free().
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[out]   result          Threads sorted by total time.
+ * @param[out]   t_sum           Total time of the call in all threads.
+ *
+ * @retval (count) - number of threads in result (at most ibprof_thread_top)
+ ***************************************************************************/
+int ibprof_thread_call_gather(IBPROF_THREAD_OBJECT *thread_list, int generation,
+			int module, int call, IBPROF_THREAD_CALL **result, int64_t *t_sum)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_THREAD_CALL *entries = NULL;
+	IBPROF_HASH_OBJ *src = NULL;
+	int64_t skip = 0;
+	int count = 0;
+	int i = 0;
+
+	*result = NULL;
+	*t_sum = 0;
+
+	if (!ibprof_thread_top)
+		return 0;
+
+	for (thread_obj = thread_list; thread_obj; thread_obj = thread_obj->next)
+		count++;
+	if (!count)
+		return 0;
+
+	entries = (IBPROF_THREAD_CALL *) sys_malloc(count * sizeof(IBPROF_THREAD_CALL));
+	if (!entries)
+		return 0;
+
+	for (thread_obj = thread_list; thread_obj && (i < count); thread_obj = thread_obj->next) {
+		if (__atomic_load_n(&thread_obj->generation, __ATOMIC_ACQUIRE) != generation)
+			continue;
+		src = &thread_obj->call_table[module][call];
+		if (src->count <= 0)
+			continue;
+
+		/* Sampled calls are scaled as on merge */
+		skip = thread_obj->sample_skip[module][call];
+		entries[i].tid = thread_obj->tid;
+		entries[i].number = thread_obj->number;
+		entries[i].count = src->count + skip;
+		entries[i].samples = ibprof_sample_scale(src->samples, src->count, skip);
+		entries[i].t_tot = ibprof_sample_scale(src->t_tot, src->count, skip);
+		entries[i].t_max = src->t_max;
+		entries[i].err = src->mode_data.err;
+		*t_sum += entries[i].t_tot;
+		i++;
+	}
+	count = i;
+
+	qsort(entries, count, sizeof(IBPROF_THREAD_CALL), __thread_call_compare);
+
+	*result = entries;
+
+	return sys_min(count, ibprof_thread_top);
+}
+
+/**
+ * ibprof_thread_attach
+ *
+ * @brief
+ *    Creates thread object for the calling thread and registers it
+ *    in global list.
+ *
+ * @retval pointer to thread object - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_THREAD_OBJECT *ibprof_thread_attach(void)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	thread_obj = ibprof_thread_create(ibprof_obj->task_obj->procid,
+			ibprof_obj->generation);
+	if (thread_obj) {
+		/* Threads are numbered in order of first use, so error injection
+		 * sequence of a thread does not depend on its system id
+		 */
+		thread_obj->number = thread_number++;
+		thread_obj->fault_rand = ibprof_fault_seed(thread_obj->number);
+		thread_obj->next = ibprof_obj->thread_list;
+		ibprof_obj->thread_list = thread_obj;
+		ibprof_thread_obj = thread_obj;
+		if (thread_key_active)
+			pthread_setspecific(thread_key, thread_obj);
+	} else {
+		IBPROF_ERROR("%s : error=%d - Can't create thread object\n",
+				__FUNCTION__, IBPROF_ERR_NO_MEMORY);
+	}
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+	return thread_obj;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_thread.h
+ *
+ * @brief This file is place for thread
+ *         related data.
+ *
+ **/
+#ifndef _IBPROF_THREAD_H_
+#define _IBPROF_THREAD_H_
+
+#define HASH_THREAD_SIZE    (2039) /* Prime number used for per-thread tables */
+#define IBPROF_THREAD_RETIRED    (-1) /* Order number of container of exited threads */
+
+/**
+ * @struct _IBPROF_THREAD_OBJECT
+ * @brief Per-thread statistics container
+ *
+ * Every thread gathers its measurements in a private table so that
+ * the hot path never writes to memory shared with other threads.
+ * Tables are linked in a global list on first use and merged on dump.
+ * Calls of library modules are known at compile time and are kept
+ * in dense call_table indexed by module and call number directly,
+ * hash object holds dynamic keys (user defined intervals) only.
+ * When a thread exits its statistics are moved to a container of exited
+ * threads at the tail of list and its object is released.
+ */
+typedef struct _IBPROF_THREAD_OBJECT {
+	IBPROF_HASH_OBJ call_table[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< library calls */
+	IBPROF_HASH_OBJECT *hash_obj; /**< dynamic keys collected by the thread */
+	IBPROF_INTERVAL_STACK interval_stack; /**< user intervals entered by the thread */
+	IBPROF_TRACE_RING *trace_ring; /**< trace records (allocated on first use) */
+	IBPROF_RESOURCE_TABLE *resource_table[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< objects of calls (allocated on first use) */
+	IBPROF_COUNTER_TABLE *counter_table[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< counters of calls (allocated on first use) */
+	int sample_countdown[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< invocations left to next measured one */
+	int64_t sample_skip[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< invocations that were not measured */
+	int64_t fault_count[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< invocations in error injection mode */
+	int fault_burst[IBPROF_MODULE_USER][HASH_MAX_CALL + 1]; /**< failures left in current burst */
+	uint64_t fault_rand; /**< state of error and delay injection random generator */
+	int number; /**< order number of the thread in the process */
+	int tid; /**< thread id */
+	int generation; /**< dump generation collected statistics belong to */
+	struct _IBPROF_THREAD_OBJECT *next; /**< next registered thread */
+} IBPROF_THREAD_OBJECT;
+
+/**
+ * @struct _IBPROF_THREAD_CALL
+ * @brief Statistics of a call made by single thread
+ */
+typedef struct _IBPROF_THREAD_CALL {
+	int tid; /**< thread id */
+	int number; /**< order number of the thread in the process */
+	int64_t count; /**< number of calls */
+	int64_t samples; /**< number of calls timed after warmup */
+	int64_t t_tot; /**< total time (ticks) */
+	int64_t t_max; /**< maximum time (ticks) */
+	int64_t err; /**< number of injected errors */
+} IBPROF_THREAD_CALL;
+
+extern __thread IBPROF_THREAD_OBJECT *ibprof_thread_obj;
+
+extern int ibprof_thread_top;
+
+/**
+ * ibprof_thread_init
+ *
+ * @brief
+ *    Set number of threads reported per call.
+ *
+ * @param[in]    top             Number of threads (0 - disable).
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_thread_init(int top);
+
+/**
+ * ibprof_thread_exit
+ *
+ * @brief
+ *    Stops releasing objects of exited threads. It is called before
+ *    the list of thread objects is destroyed.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_exit(void);
+
+/**
+ * ibprof_thread_create
+ *
+ * @brief
+ *    Allocates memory for new thread object and set initial values.
+ *
+ * @param[in]    rank            Process rank.
+ * @param[in]    generation      Current dump generation.
+ *
+ * @retval pointer to new thread object - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_THREAD_OBJECT *ibprof_thread_create(int rank, int generation);
+
+/**
+ * ibprof_thread_destroy
+ *
+ * @brief
+ *    Releases all used resources and free memory allocated for internal object.
+ *
+ * @param[in]    thread_obj      Thread object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_destroy(IBPROF_THREAD_OBJECT *thread_obj);
+
+/**
+ * ibprof_thread_reset
+ *
+ * @brief
+ *    Drops statistics collected by the thread and moves it to new generation.
+ *    It is called by the owner thread only.
+ *
+ * @param[in]    thread_obj      Thread object.
+ * @param[in]    generation      Current dump generation.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_reset(IBPROF_THREAD_OBJECT *thread_obj, int generation);
+
+/**
+ * ibprof_thread_merge
+ *
+ * @brief
+ *    Accumulates all statistics of thread object into hash object.
+ *    Thread object can be updated by its owner at the same time.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    thread_obj      Thread object.
+ *
+ * @retval (count) - number of merged elements
+ ***************************************************************************/
+int ibprof_thread_merge(IBPROF_HASH_OBJECT *dst_obj, IBPROF_THREAD_OBJECT *thread_obj);
+
+/**
+ * ibprof_thread_gather
+ *
+ * @brief
+ *    Replaces content of hash object with statistics of all threads
+ *    collected in given generation. It should be called under the lock
+ *    of basis object.
+ *
+ * @param[in]    dst_obj         Destination hash object.
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ *
+ * @retval (count) - number of merged elements
+ ***************************************************************************/
+int ibprof_thread_gather(IBPROF_HASH_OBJECT *dst_obj, IBPROF_THREAD_OBJECT *thread_list,
+			int generation);
+
+/**
+ * ibprof_thread_copy
+ *
+ * @brief
+ *    Copies statistics of all threads collected in given generation to
+ *    private list that is read without the lock. Sampled calls are scaled
+ *    to all invocations. It should be called under the lock of basis object.
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ *
+ * @retval list of copies (released by ibprof_thread_copy_destroy())
+ ***************************************************************************/
+IBPROF_THREAD_OBJECT *ibprof_thread_copy(IBPROF_THREAD_OBJECT *thread_list, int generation);
+
+/**
+ * ibprof_thread_copy_destroy
+ *
+ * @brief
+ *    Releases list of copies made by ibprof_thread_copy().
+ *
+ * @param[in]    copy_list       List of copies.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_thread_copy_destroy(IBPROF_THREAD_OBJECT *copy_list);
+
+/**
+ * ibprof_thread_call_gather
+ *
+ * @brief
+ *    Collects statistics of a call made by every thread in given generation.
+ *    Result is sorted by total time and should be freed with sys_free().
+ *
+ * @param[in]    thread_list     List of thread objects.
+ * @param[in]    generation      Dump generation.
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[out]   result          Threads sorted by total time.
+ * @param[out]   t_sum           Total time of the call in all threads.
+ *
+ * @retval (count) - number of threads in result (at most ibprof_thread_top)
+ ***************************************************************************/
+int ibprof_thread_call_gather(IBPROF_THREAD_OBJECT *thread_list, int generation,
+			int module, int call, IBPROF_THREAD_CALL **result, int64_t *t_sum);
+
+/**
+ * ibprof_thread_attach
+ *
+ * @brief
+ *    Creates thread object for the calling thread and registers it
+ *    in global list.
+ *
+ * @retval pointer to thread object - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_THREAD_OBJECT *ibprof_thread_attach(void);
+
+#endif /* _IBPROF_THREAD_H_ */
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_cmn.h"
+#include "ibprof_conf.h"
+#include "ibprof_api.h"
+#include "ibprof_types.h"
+
+#include <fcntl.h>
+
+#define TRACE_WRITE_SIZE     (1 << 20) /* Size of single write to trace file */
+#define TRACE_IDLE_USEC      (1000) /* Writer sleeps when all rings are empty */
+
+int ibprof_trace_active = 0;
+
+static struct {
+	int fd; /* trace file */
+	pthread_t writer; /* writer thread */
+	volatile int stop; /* writer termination request */
+	char *buffer; /* staging buffer of TRACE_WRITE_SIZE bytes */
+	size_t buffer_len; /* amount of data in staging buffer */
+	uint64_t dropped; /* records lost by exited rings */
+	IBPROF_TRACE_RING *retired; /* rings of exited threads */
+	IBPROF_TRACE_RING **rings; /* rings of live threads pinned by writer */
+	int rings_size; /* capacity of rings array */
+} trace_ctx = { -1 };
+
+/****************************************************************************
+ * Static Function Declarations
+ ***************************************************************************/
+static int __trace_write(const void *data, size_t len)
+{
+	const char *ptr = (const char *)data;
+	ssize_t ret = 0;
+
+	while (len > 0) {
+		ret = write(trace_ctx.fd, ptr, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		ptr += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static void __trace_flush(void)
+{
+	if (trace_ctx.buffer_len) {
+		__trace_write(trace_ctx.buffer, trace_ctx.buffer_len);
+		trace_ctx.buffer_len = 0;
+	}
+}
+
+static void __trace_copy(const IBPROF_TRACE_RECORD *records, uint64_t count)
+{
+	size_t len = 0;
+
+	while (count) {
+		if ((trace_ctx.buffer_len + sizeof(*records)) > TRACE_WRITE_SIZE)
+			__trace_flush();
+
+		len = sys_min((size_t)count, (TRACE_WRITE_SIZE - trace_ctx.buffer_len) / sizeof(*records));
+		sys_memcpy(trace_ctx.buffer + trace_ctx.buffer_len, records, len * sizeof(*records));
+		trace_ctx.buffer_len += len * sizeof(*records);
+		records += len;
+		count -= len;
+	}
+}
+
+/*
+ * Move all available records of the ring to staging buffer
+ */
+static uint64_t __trace_drain(IBPROF_TRACE_RING *ring)
+{
+	uint64_t tail = ring->tail;
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	uint64_t first = 0;
+	uint64_t count = head - tail;
+
+	if (!count)
+		return 0;
+
+	/* Records can wrap around the end of ring */
+	first = sys_min(count, ring->mask + 1 - (tail & ring->mask));
+	__trace_copy(&ring->records[tail & ring->mask], first);
+	__trace_copy(&ring->records[0], count - first);
+
+	__atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+	return count;
+}
+
+/*
+ * Pin rings to be drained. It is called under the lock. Rings of live
+ * threads stay valid out of the lock because exited threads hand them
+ * over to writer that is the only one to release them.
+ */
+static int __trace_collect(IBPROF_TRACE_RING **retired)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_TRACE_RING **rings = NULL;
+	int count = 0;
+
+	for (thread_obj = ibprof_obj->thread_list; thread_obj; thread_obj = thread_obj->next)
+		count++;
+	if (count > trace_ctx.rings_size) {
+		rings = (IBPROF_TRACE_RING **) sys_malloc(count * 2 * sizeof(IBPROF_TRACE_RING *));
+		if (rings) {
+			sys_free(trace_ctx.rings);
+			trace_ctx.rings = rings;
+			trace_ctx.rings_size = count * 2;
+		}
+	}
+
+	/* Rings left out are drained on next pass */
+	count = 0;
+	for (thread_obj = ibprof_obj->thread_list;
+		thread_obj && (count < trace_ctx.rings_size); thread_obj = thread_obj->next) {
+		trace_ctx.rings[count] = __atomic_load_n(&thread_obj->trace_ring, __ATOMIC_ACQUIRE);
+		if (trace_ctx.rings[count])
+			count++;
+	}
+
+	*retired = trace_ctx.retired;
+	trace_ctx.retired = NULL;
+
+	return count;
+}
+
+/*
+ * Drain pinned rings and release rings of exited threads
+ */
+static uint64_t __trace_drain_rings(int count, IBPROF_TRACE_RING *retired)
+{
+	IBPROF_TRACE_RING *ring = NULL;
+	uint64_t total = 0;
+	int i = 0;
+
+	for (i = 0; i < count; i++)
+		total += __trace_drain(trace_ctx.rings[i]);
+
+	while ((ring = retired)) {
+		retired = ring->next;
+		total += __trace_drain(ring);
+		trace_ctx.dropped += ring->dropped;
+		ibprof_trace_ring_destroy(ring);
+	}
+
+	return total;
+}
+
+static void *__trace_writer(void *arg)
+{
+	IBPROF_TRACE_RING *retired = NULL;
+	uint64_t count = 0;
+	int rings = 0;
+	UNREFERENCED_PARAMETER(arg);
+
+	while (!trace_ctx.stop) {
+		/* Records are copied and written out of the lock */
+		ENTER_CRITICAL(&(ibprof_obj->lock));
+		rings = __trace_collect(&retired);
+		LEAVE_CRITICAL(&(ibprof_obj->lock));
+
+		count = __trace_drain_rings(rings, retired);
+		if (!count) {
+			__trace_flush();
+			usleep(TRACE_IDLE_USEC);
+		}
+	}
+
+	return NULL;
+}
+
+static int __trace_header(void)
+{
+	IBPROF_TRACE_HEADER header;
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	uint32_t entry[3];
+	int i = 0;
+
+	sys_memset(&header, 0, sizeof(header));
+	sys_memcpy(header.magic, IBPROF_TRACE_MAGIC, sizeof(header.magic));
+	header.version = IBPROF_TRACE_VERSION;
+	header.record_size = sizeof(IBPROF_TRACE_RECORD);
+	header.freq = ibprof_clock_freq;
+	header.pid = ibprof_obj->task_obj->pid;
+	header.rank = ibprof_obj->task_obj->procid;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id == IBPROF_MODULE_INVALID) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++)
+			header.name_count++;
+	}
+
+	if (__trace_write(&header, sizeof(header)))
+		return -1;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id == IBPROF_MODULE_INVALID) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			entry[0] = module_obj->id;
+			entry[1] = module_call->call;
+			entry[2] = sys_strlen(module_call->name);
+			if (__trace_write(entry, sizeof(entry)) ||
+				__trace_write(module_call->name, entry[2]))
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * ibprof_trace_init
+ *
+ * @brief
+ *    Opens trace file and starts writer thread if any module
+ *    is configured in trace mode.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_trace_init(void)
+{
+	IBPROF_ERROR status = IBPROF_ERR_NONE;
+	const char *file_name = ibprof_conf_get_string(IBPROF_TRACE_FILE);
+	int module = 0;
+
+	for (module = IBPROF_MODULE_IBV; module < IBPROF_MODULE_USER; module++) {
+		if (ibprof_conf_get_mode(module) == IBPROF_MODE_TRACE)
+			break;
+	}
+	if (module == IBPROF_MODULE_USER)
+		return status;
+
+	trace_ctx.buffer = sys_malloc(TRACE_WRITE_SIZE);
+	if (!trace_ctx.buffer) {
+		status = IBPROF_ERR_NO_MEMORY;
+		IBPROF_ERROR("%s : error=%d - Can't allocate trace buffer\n",
+				__FUNCTION__, status);
+		return status;
+	}
+
+	trace_ctx.fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ((trace_ctx.fd < 0) || __trace_header()) {
+		status = IBPROF_ERR_NOT_EXIST;
+		IBPROF_ERROR("%s : error=%d - Can't write trace file '%s'\n",
+				__FUNCTION__, status, file_name);
+		goto err;
+	}
+
+	trace_ctx.stop = 0;
+	trace_ctx.buffer_len = 0;
+	trace_ctx.dropped = 0;
+	trace_ctx.retired = NULL;
+	trace_ctx.rings = NULL;
+	trace_ctx.rings_size = 0;
+	if (pthread_create(&trace_ctx.writer, NULL, __trace_writer, NULL)) {
+		status = IBPROF_ERR_INCORRECT;
+		IBPROF_ERROR("%s : error=%d - Can't start trace writer\n",
+				__FUNCTION__, status);
+		goto err;
+	}
+
+	ibprof_trace_active = 1;
+
+	return status;
+
+err:
+	if (trace_ctx.fd >= 0)
+		close(trace_ctx.fd);
+	trace_ctx.fd = -1;
+	sys_free(trace_ctx.buffer);
+	trace_ctx.buffer = NULL;
+
+	return status;
+}
+
+/**
+ * ibprof_trace_exit
+ *
+ * @brief
+ *    Stops writer thread, flushes all rings and closes trace file.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_trace_exit(void)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_TRACE_RING *retired = NULL;
+
+	if (!ibprof_trace_active)
+		return;
+
+	ibprof_trace_active = 0;
+	trace_ctx.stop = 1;
+	pthread_join(trace_ctx.writer, NULL);
+
+	/* Rings of threads exiting from now on are released at once */
+	ENTER_CRITICAL(&(ibprof_obj->lock));
+
+	__trace_drain_rings(__trace_collect(&retired), retired);
+	__trace_flush();
+
+	for (thread_obj = ibprof_obj->thread_list; thread_obj; thread_obj = thread_obj->next) {
+		if (thread_obj->trace_ring)
+			trace_ctx.dropped += thread_obj->trace_ring->dropped;
+	}
+	if (trace_ctx.dropped)
+		IBPROF_WARN("%s : %lu trace records are dropped, increase IBPROF_TRACE_BUFFER\n",
+				__FUNCTION__, (unsigned long)trace_ctx.dropped);
+
+	close(trace_ctx.fd);
+	trace_ctx.fd = -1;
+	sys_free(trace_ctx.buffer);
+	trace_ctx.buffer = NULL;
+	sys_free(trace_ctx.rings);
+	trace_ctx.rings = NULL;
+	trace_ctx.rings_size = 0;
+
+	LEAVE_CRITICAL(&(ibprof_obj->lock));
+}
+
+/**
+ * ibprof_trace_ring_create
+ *
+ * @brief
+ *    Allocates ring for the calling thread.
+ *
+ * @retval pointer to new ring - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_TRACE_RING *ibprof_trace_ring_create(void)
+{
+	IBPROF_TRACE_RING *ring = NULL;
+	uint64_t size = 1;
+
+	/* Round number of records up to power of two */
+	while (size < (uint64_t)sys_max(ibprof_conf_get_int(IBPROF_TRACE_BUFFER), 2))
+		size <<= 1;
+
+	ring = (IBPROF_TRACE_RING *) sys_malloc(sizeof(IBPROF_TRACE_RING));
+	if (ring) {
+		ring->records = (IBPROF_TRACE_RECORD *) sys_malloc(size * sizeof(IBPROF_TRACE_RECORD));
+		if (ring->records) {
+			ring->mask = size - 1;
+			ring->dropped = 0;
+			ring->head = 0;
+			ring->tail = 0;
+			ring->next = NULL;
+		} else {
+			sys_free(ring);
+			ring = NULL;
+		}
+	}
+
+	return ring;
+}
+
+/**
+ * ibprof_trace_ring_destroy
+ *
+ * @brief
+ *    Releases ring memory.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_trace_ring_destroy(IBPROF_TRACE_RING *ring)
+{
+	if (ring) {
+		sys_free(ring->records);
+		sys_free(ring);
+	}
+}
+
+/**
+ * ibprof_trace_ring_retire
+ *
+ * @brief
+ *    Passes ring of exited thread to writer that releases it when
+ *    remaining records are written. It should be called under the lock
+ *    of basis object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_trace_ring_retire(IBPROF_TRACE_RING *ring)
+{
+	if (!ring)
+		return;
+
+	if (trace_ctx.fd < 0) {
+		ibprof_trace_ring_destroy(ring);
+		return;
+	}
+
+	ring->next = trace_ctx.retired;
+	trace_ctx.retired = ring;
+}
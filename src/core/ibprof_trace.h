@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_trace.h
+ *
+ * @brief This file is place for event trace
+ *         declaration and operations definition.
+ *
+ * Every call of a module in trace mode produces fixed size binary record
+ * that is appended to ring of the calling thread. Ring has single producer
+ * (owner thread) and single consumer (writer thread) so it does not need
+ * any locks. Writer thread drains all rings to trace file periodically.
+ *
+ * Trace file consists of header, table of call names and records:
+ *
+ *     IBPROF_TRACE_HEADER
+ *     name_count * { uint32_t module, uint32_t call, uint32_t len, char name[len] }
+ *     IBPROF_TRACE_RECORD ... (up to the end of file)
+ *
+ **/
+#ifndef _IBPROF_TRACE_H_
+#define _IBPROF_TRACE_H_
+
+#define IBPROF_TRACE_MAGIC       "IBPTRACE"
+#define IBPROF_TRACE_VERSION     1
+
+/**
+ * @struct _IBPROF_TRACE_HEADER
+ * @brief Trace file header
+ */
+typedef struct _IBPROF_TRACE_HEADER {
+	char magic[8]; /**< IBPROF_TRACE_MAGIC */
+	uint32_t version; /**< IBPROF_TRACE_VERSION */
+	uint32_t record_size; /**< size of IBPROF_TRACE_RECORD */
+	double freq; /**< clock ticks per second */
+	int32_t pid; /**< process id */
+	int32_t rank; /**< process rank */
+	uint32_t name_count; /**< number of call names following header */
+	uint32_t reserved;
+} IBPROF_TRACE_HEADER;
+
+/**
+ * @struct _IBPROF_TRACE_RECORD
+ * @brief Single traced call
+ */
+typedef struct _IBPROF_TRACE_RECORD {
+	int64_t t_start; /**< call start (clock ticks) */
+	int64_t t_dur; /**< call duration (clock ticks) */
+	int64_t size; /**< message size (-1 if unknown) */
+	uint64_t handle; /**< resource handle (0 if unknown) */
+	uint32_t tid; /**< thread id */
+	uint16_t module; /**< module id */
+	uint16_t call; /**< call number */
+} IBPROF_TRACE_RECORD;
+
+/**
+ * @struct _IBPROF_TRACE_RING
+ * @brief Per-thread ring of trace records
+ */
+typedef struct _IBPROF_TRACE_RING {
+	IBPROF_TRACE_RECORD *records; /**< storage */
+	uint64_t mask; /**< number of records - 1 */
+	uint64_t dropped; /**< records lost because ring was full */
+	uint64_t head __attribute__((aligned(64))); /**< next record to write (owner) */
+	uint64_t tail __attribute__((aligned(64))); /**< next record to read (writer) */
+	struct _IBPROF_TRACE_RING *next; /**< next ring of exited thread */
+} IBPROF_TRACE_RING;
+
+extern int ibprof_trace_active;
+
+/**
+ * ibprof_trace_init
+ *
+ * @brief
+ *    Opens trace file and starts writer thread if any module
+ *    is configured in trace mode.
+ *
+ * @retval (0) - on success
+ * @retval (errno) - on failure
+ ***************************************************************************/
+IBPROF_ERROR ibprof_trace_init(void);
+
+/**
+ * ibprof_trace_exit
+ *
+ * @brief
+ *    Stops writer thread, flushes all rings and closes trace file.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_trace_exit(void);
+
+/**
+ * ibprof_trace_ring_create
+ *
+ * @brief
+ *    Allocates ring for the calling thread.
+ *
+ * @retval pointer to new ring - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+IBPROF_TRACE_RING *ibprof_trace_ring_create(void);
+
+/**
+ * ibprof_trace_ring_destroy
+ *
+ * @brief
+ *    Releases ring memory.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_trace_ring_destroy(IBPROF_TRACE_RING *ring);
+
+/**
+ * ibprof_trace_ring_retire
+ *
+ * @brief
+ *    Passes ring of exited thread to writer that releases it when
+ *    remaining records are written. It should be called under the lock
+ *    of basis object.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_trace_ring_retire(IBPROF_TRACE_RING *ring);
+
+/**
+ * ibprof_trace_push
+ *
+ * @brief
+ *    Append record to the ring. It is called by the owner thread only.
+ *    Record is dropped if the ring is full.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_trace_push(IBPROF_TRACE_RING *ring,
+					const IBPROF_TRACE_RECORD *record)
+{
+	uint64_t head = ring->head;
+
+	if ((head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) > ring->mask) {
+		ring->dropped++;
+		return;
+	}
+
+	ring->records[head & ring->mask] = *record;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* _IBPROF_TRACE_H_ */
@@ -20,9 +20,20 @@
 #include "ibprof_cmn.h"
 #include "ibprof_api.h"
 #include "ibprof_task.h"
+#include "ibprof_clock.h"
+#include "ibprof_hist.h"
 #include "ibprof_hash.h"
-
-#define ibprof_timestamp_diff(t_val)   (ibprof_timestamp() - (t_val))
+#include "ibprof_interval.h"
+#include "ibprof_trace.h"
+#include "ibprof_snapshot.h"
+#include "ibprof_live.h"
+#include "ibprof_node.h"
+#include "ibprof_resource.h"
+#include "ibprof_counter.h"
+#include "ibprof_sample.h"
+#include "ibprof_fault.h"
+#include "ibprof_itree.h"
+#include "ibprof_thread.h"
 
 
 /**
@@ -31,10 +42,371 @@
  */
 typedef struct _IBPROF_OBJECT {
 	IBPROF_MODULE_OBJECT **module_array; /**< array of available modules */
-	IBPROF_HASH_OBJECT *hash_obj; /**< hash object */
+	IBPROF_HASH_OBJECT *hash_obj; /**< hash object (merged on dump) */
 	IBPROF_TASK_OBJECT *task_obj; /**< task object */
+	IBPROF_THREAD_OBJECT *thread_list; /**< per-thread statistics */
+	int generation; /**< dump generation */
+	int snapshot; /**< number of snapshot being output (0 - final dump) */
 	CRITICAL_SECTION lock; /**< protection object */
 } IBPROF_OBJECT;
 
+extern IBPROF_OBJECT *ibprof_obj;
+
+/**
+ * ibprof_thread_get
+ *
+ * @brief
+ *    Return statistics container of the calling thread.
+ *    It is registered in global list on first use.
+ *
+ * @retval pointer to thread object - on success
+ * @retval NULL - on failure
+ ***************************************************************************/
+static INLINE IBPROF_THREAD_OBJECT *ibprof_thread_get(void)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = ibprof_thread_obj;
+
+	if (!thread_obj)
+		return ibprof_thread_attach();
+
+	/* Statistics were dumped since last update */
+	if (thread_obj->generation != ibprof_obj->generation)
+		ibprof_thread_reset(thread_obj, ibprof_obj->generation);
+
+	return thread_obj;
+}
+
+/**
+ * ibprof_sample_call
+ *
+ * @brief
+ *    Decide if invocation of library call known at compile time
+ *    should be measured. Skipped invocations are counted.
+ *
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ *
+ * @retval (1) - invocation should be measured
+ * @retval (0) - otherwise
+ ***************************************************************************/
+static INLINE int ibprof_sample_call(int module, int call)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	int rate = 0;
+
+	if (!ibprof_sample_active || ((rate = ibprof_sample_rate[module][call]) <= 1))
+		return 1;
+
+	if (!ibprof_obj || !(thread_obj = ibprof_thread_get()))
+		return 1;
+
+	if (--thread_obj->sample_countdown[module][call] > 0) {
+		thread_obj->sample_skip[module][call]++;
+		return 0;
+	}
+	thread_obj->sample_countdown[module][call] = rate;
+
+	return 1;
+}
+
+/**
+ * ibprof_fault_call
+ *
+ * @brief
+ *    Decide if invocation of library call known at compile time
+ *    should fail in error injection mode. Error injection state is not
+ *    reset on dump, so Nth invocation is counted since start.
+ *
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ *
+ * @retval (1) - invocation should fail
+ * @retval (0) - otherwise
+ ***************************************************************************/
+static INLINE int ibprof_fault_call(int module, int call)
+{
+	const IBPROF_FAULT_POLICY *policy = &ibprof_fault_policy[module][call];
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	int64_t count = 0;
+	int fail = 0;
+
+	if (!policy->active)
+		return 0;
+
+	if (!ibprof_obj || !(thread_obj = ibprof_thread_get()))
+		return 0;
+
+	count = ++thread_obj->fault_count[module][call];
+	if (thread_obj->fault_burst[module][call] > 0) {
+		thread_obj->fault_burst[module][call]--;
+		return 1;
+	}
+
+	if (policy->after && ((ibprof_clock_ticks() - ibprof_fault_start) < policy->after))
+		return 0;
+
+	if (policy->nth && (count == policy->nth))
+		fail = 1;
+	else if (policy->ppm)
+		fail = ((ibprof_fault_rand(&thread_obj->fault_rand) % FAULT_PPM_MAX) < policy->ppm);
+	else
+		fail = !policy->nth;
+
+	if (fail && (policy->burst > 1))
+		thread_obj->fault_burst[module][call] = policy->burst - 1;
+
+	return fail;
+}
+
+/**
+ * ibprof_delay_call
+ *
+ * @brief
+ *    Busy-wait before invocation of library call known at compile time
+ *    in delay injection mode.
+ *
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_delay_call(int module, int call)
+{
+	const IBPROF_DELAY_POLICY *policy = &ibprof_delay_policy[module][call];
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	int64_t ns = policy->ns;
+
+	if (!ns && !policy->jitter)
+		return;
+
+	if (policy->jitter || (policy->ppm < FAULT_PPM_MAX)) {
+		if (!ibprof_obj || !(thread_obj = ibprof_thread_get()))
+			return;
+		if ((policy->ppm < FAULT_PPM_MAX) &&
+			((ibprof_fault_rand(&thread_obj->fault_rand) % FAULT_PPM_MAX) >= policy->ppm))
+			return;
+		if (policy->jitter)
+			ns += (int64_t)(ibprof_fault_rand(&thread_obj->fault_rand) %
+					((uint64_t)policy->jitter + 1));
+	}
+
+	ibprof_delay_wait(ns);
+}
+
+/**
+ * ibprof_update_call_opt
+ *
+ * @brief
+ *    Update statistics of library call known at compile time
+ *    with set of features known at compile time (IBPROF_UPDATE_xxx).
+ *    Negative size means that call size is unknown.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_update_call_opt(int module, int call, int64_t tm, int64_t size, int opt)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_HASH_OBJ *entry = NULL;
+
+	if (ibprof_obj && (thread_obj = ibprof_thread_get())) {
+		entry = &thread_obj->call_table[module][call];
+		ibprof_hash_update_opt(thread_obj->hash_obj, entry, tm, opt);
+		if (size >= 0)
+			ibprof_hash_update_size_opt(thread_obj->hash_obj, entry->key, tm, size, opt);
+		ibprof_interval_charge(&thread_obj->interval_stack, thread_obj->hash_obj,
+				entry->key, tm, opt);
+	}
+}
+
+/**
+ * ibprof_update_call
+ *
+ * @brief
+ *    Update statistics of library call known at compile time.
+ *    Slot is addressed directly by module and call number,
+ *    time is given in clock ticks.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_update_call(int module, int call, int64_t tm)
+{
+	ibprof_update_call_opt(module, call, tm, -1, IBPROF_UPDATE_ALL);
+}
+
+/**
+ * ibprof_update_call_ex
+ *
+ * @brief
+ *    Update statistics of library call known at compile time.
+ *    Provide additional mode related data
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_update_call_ex(int module, int call, int64_t tm, void *ctx)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+
+	if (ibprof_obj && (thread_obj = ibprof_thread_get())) {
+		ibprof_hash_update_ex(thread_obj->hash_obj,
+				&thread_obj->call_table[module][call], tm, ctx);
+		ibprof_interval_charge(&thread_obj->interval_stack, thread_obj->hash_obj,
+				thread_obj->call_table[module][call].key, tm, IBPROF_UPDATE_ALL);
+	}
+}
+
+
+/**
+ * ibprof_update_call_size
+ *
+ * @brief
+ *    Update statistics of library call known at compile time
+ *    and statistics of its message size class.
+ *    Negative size means that call size is unknown.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_update_call_size(int module, int call, int64_t tm, int64_t size)
+{
+	ibprof_update_call_opt(module, call, tm, size, IBPROF_UPDATE_ALL);
+}
+
+/**
+ * ibprof_update_call_size_ex
+ *
+ * @brief
+ *    Update statistics of library call known at compile time
+ *    and statistics of its message size class.
+ *    Provide additional mode related data
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_update_call_size_ex(int module, int call, int64_t tm, int64_t size, void *ctx)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_HASH_OBJ *entry = NULL;
+
+	if (ibprof_obj && (thread_obj = ibprof_thread_get())) {
+		entry = &thread_obj->call_table[module][call];
+		ibprof_hash_update_ex(thread_obj->hash_obj, entry, tm, ctx);
+		if (size >= 0)
+			ibprof_hash_update_size(thread_obj->hash_obj, entry->key, tm, size);
+		ibprof_interval_charge(&thread_obj->interval_stack, thread_obj->hash_obj,
+				entry->key, tm, IBPROF_UPDATE_ALL);
+	}
+}
+
+/**
+ * ibprof_update_call_resource
+ *
+ * @brief
+ *    Attribute library call known at compile time to the object
+ *    it is applied to. It is no-op if attribution is disabled.
+ *
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[in]    tm              Call duration in clock ticks.
+ * @param[in]    key             Object handle or number.
+ * @param[in]    format          printf format of object key.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_update_call_resource(int module, int call, int64_t tm,
+				uint64_t key, const char *format)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_RESOURCE_TABLE *table = NULL;
+
+	if (!ibprof_resource_size || !ibprof_obj || !(thread_obj = ibprof_thread_get()))
+		return;
+
+	table = thread_obj->resource_table[module][call];
+	if (!table) {
+		table = ibprof_resource_create(format);
+		if (!table)
+			return;
+		/* Table should be initialized before dump can see it */
+		__atomic_store_n(&thread_obj->resource_table[module][call], table, __ATOMIC_RELEASE);
+	}
+
+	ibprof_resource_update(table, key, tm);
+}
+
+/**
+ * ibprof_counter_get
+ *
+ * @brief
+ *    Return counters of library call known at compile time
+ *    for the calling thread. Counters are updated by caller directly.
+ *
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[in]    desc            Layout of counters.
+ *
+ * @retval pointer to counters - on success
+ * @retval NULL - counters are disabled or on failure
+ ***************************************************************************/
+static INLINE int64_t *ibprof_counter_get(int module, int call, const IBPROF_COUNTER_DESC *desc)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_COUNTER_TABLE *table = NULL;
+
+	if (!ibprof_counter_active || !ibprof_obj || !(thread_obj = ibprof_thread_get()))
+		return NULL;
+
+	table = thread_obj->counter_table[module][call];
+	if (!table) {
+		table = ibprof_counter_create(desc);
+		if (!table)
+			return NULL;
+		/* Table should be initialized before dump can see it */
+		__atomic_store_n(&thread_obj->counter_table[module][call], table, __ATOMIC_RELEASE);
+	}
+
+	return table->value;
+}
+
+/**
+ * ibprof_trace_call
+ *
+ * @brief
+ *    Append trace record of library call known at compile time
+ *    to the ring of the calling thread.
+ *
+ * @param[in]    module          Module id.
+ * @param[in]    call            Call number.
+ * @param[in]    t_start         Call start in clock ticks.
+ * @param[in]    t_dur           Call duration in clock ticks.
+ * @param[in]    size            Message size or -1.
+ * @param[in]    handle          Resource handle or 0.
+ *
+ * @return @a none
+ ***************************************************************************/
+static INLINE void ibprof_trace_call(int module, int call, int64_t t_start,
+				int64_t t_dur, int64_t size, uint64_t handle)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_TRACE_RECORD record;
+
+	if (!ibprof_trace_active || !ibprof_obj || !(thread_obj = ibprof_thread_get()))
+		return;
+
+	if (!thread_obj->trace_ring) {
+		IBPROF_TRACE_RING *ring = ibprof_trace_ring_create();
+
+		if (!ring)
+			return;
+		/* Ring should be initialized before writer can see it */
+		__atomic_store_n(&thread_obj->trace_ring, ring, __ATOMIC_RELEASE);
+	}
+
+	record.t_start = t_start;
+	record.t_dur = t_dur;
+	record.size = size;
+	record.handle = handle;
+	record.tid = thread_obj->tid;
+	record.module = module;
+	record.call = call;
+	ibprof_trace_push(thread_obj->trace_ring, &record);
+}
 
 #endif /* _IBPROF_TYPES_H_ */
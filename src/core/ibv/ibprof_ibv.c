@@ -34,13 +34,41 @@ struct ibv_ctx_t {
 	struct ibv_ctx_t        *next;
 };
 
+/* Amount of data described by a chain of work requests */
+static inline int64_t ibv_send_wr_size(struct ibv_send_wr *wr)
+{
+	int64_t size = 0;
+	int i = 0;
+
+	for (; wr; wr = wr->next) {
+		for (i = 0; i < wr->num_sge; i++)
+			size += wr->sg_list[i].length;
+	}
+
+	return size;
+}
+
+static inline int64_t ibv_recv_wr_size(struct ibv_recv_wr *wr)
+{
+	int64_t size = 0;
+	int i = 0;
+
+	for (; wr; wr = wr->next) {
+		for (i = 0; i < wr->num_sge; i++)
+			size += wr->sg_list[i].length;
+	}
+
+	return size;
+}
+
 /* Legacy VERBS API */
 /* libibverbs 1.1.2 and earlier differs in legacy API */
 
 #ifdef IBV_API_LEGACY
 	#define HAVE_IBV_REG_MR_FUNC(TYPE) \
 		struct ibv_mr* TYPE ## ibv_reg_mr(struct ibv_pd *pd, void *addr, size_t length, enum ibv_access_flags access) \
-		{ FUNC_BODY_PTR(TYPE, _, ibv_reg_mr, reg_mr, , pd, addr, length, access) }
+		{ FUNC_BODY_PTR_STAT(TYPE, _, ibv_reg_mr, reg_mr, , length, \
+			ibv_reg_mr_stat(TBL_CALL_NUMBER(ibv_reg_mr), addr, length, ret, tm_diff), pd, addr, length, access) }
 	#define HAVE_IBV_MODIFY_QP_FUNC(TYPE) \
 		int TYPE ## ibv_modify_qp(struct ibv_qp *qp, struct ibv_qp_attr *attr, enum ibv_qp_attr_mask attr_mask) \
 		{ FUNC_BODY_INT(TYPE, _, ibv_modify_qp, modify_qp, , qp, attr, attr_mask) }
@@ -56,7 +84,8 @@ struct ibv_ctx_t {
 #else
 	#define HAVE_IBV_REG_MR_FUNC(TYPE) \
 		struct ibv_mr* TYPE ## ibv_reg_mr(struct ibv_pd *pd, void *addr, size_t length, int access) \
-		{ FUNC_BODY_PTR(TYPE, _, ibv_reg_mr, reg_mr, , pd, addr, length, access) }
+		{ FUNC_BODY_PTR_STAT(TYPE, _, ibv_reg_mr, reg_mr, , length, \
+			ibv_reg_mr_stat(TBL_CALL_NUMBER(ibv_reg_mr), addr, length, ret, tm_diff), pd, addr, length, access) }
 	#define HAVE_IBV_MODIFY_QP_FUNC(TYPE) \
 		int TYPE ## ibv_modify_qp(struct ibv_qp *qp, struct ibv_qp_attr *attr, int attr_mask) \
 		{ FUNC_BODY_INT(TYPE, _, ibv_modify_qp, modify_qp, , qp, attr, attr_mask) }
@@ -205,7 +234,8 @@ struct ibv_ctx_t {
 #ifdef HAVE_IBV_EXP_POLL_CQ_QP
 	#define HAVE_IBV_EXP_POLL_CQ_FUNC(TYPE) \
         int TYPE ## ibv_exp_poll_cq(struct ibv_cq *ibcq, int num_entries, struct ibv_exp_wc *wc, uint32_t wc_size) \
-        { FUNC_BODY_INT(TYPE, _EXP, ibv_exp_poll_cq, drv_exp_ibv_poll_cq, ibcq->context, ibcq, num_entries, wc, wc_size) }
+        { FUNC_BODY_INT_STAT(TYPE, _EXP, ibv_exp_poll_cq, drv_exp_ibv_poll_cq, ibcq->context, -1, \
+            ibv_poll_cq_stat(TBL_CALL_NUMBER(ibv_exp_poll_cq), num_entries, ret, tm_diff), ibcq, num_entries, wc, wc_size) }
 	#define HAVE_IBV_EXP_POLL_CQ_OP(OP) \
 		OP(ibv_exp_poll_cq)
 	#define HAVE_IBV_EXP_POLL_CQ_CHECK() \
@@ -289,7 +319,8 @@ struct ibv_ctx_t {
 #ifdef HAVE_IBV_EXP_REG_MR
 	#define HAVE_IBV_EXP_REG_MR_FUNC(TYPE) \
         struct ibv_mr* TYPE ## ibv_exp_reg_mr(struct ibv_exp_reg_mr_in *in) \
-        { FUNC_BODY_PTR(TYPE, _EXP, ibv_exp_reg_mr, lib_exp_reg_mr, in->pd->context, in) }
+        { FUNC_BODY_PTR_STAT(TYPE, _EXP, ibv_exp_reg_mr, lib_exp_reg_mr, in->pd->context, in->length, \
+            ibv_reg_mr_stat(TBL_CALL_NUMBER(ibv_exp_reg_mr), in->addr, in->length, ret, tm_diff), in) }
 	#define HAVE_IBV_EXP_REG_MR_OP(OP) \
 		OP(ibv_exp_reg_mr)
 	#define HAVE_IBV_EXP_REG_MR_CHECK() \
@@ -320,6 +351,7 @@ struct ibv_ctx_t {
         { \
             void *ret, *f;                                                   \
             int flip_ret = 0;                                                \
+            uintptr_t call_handle = (uintptr_t)context;                      \
             FUNC_BODY_RESOLVE_EXP(ibv_exp_create_cq, exp_create_cq, context) \
             PRE_##TYPE(ibv_exp_create_cq)                                    \
             ret = ((typeof(cur_ibv_ctx->item_exp.exp_create_cq))             \
@@ -327,6 +359,7 @@ struct ibv_ctx_t {
             POST_##TYPE(ibv_exp_create_cq)                                   \
             PRETEND_USED(ibv_exp_create_cq);                                 \
             PRETEND_USED(flip_ret);                                          \
+            PRETEND_USED(call_handle);                                       \
             return ret;                                                      \
         }
 	#define HAVE_IBV_EXP_CREATE_CQ_OP(OP) \
@@ -544,12 +577,492 @@ struct ibv_module_api_t ibv_##TYPE##_funcs = { \
 	OP_ON_MEMBERS_LIST(PREFIX##_##TYPE) \
 };
 
+/*
+ * Opened contexts are found by address in open addressing table.
+ * Data path readers do not take any lock: table slots are published with
+ * release semantic and closed contexts are replaced by a tombstone and
+ * retired until module exit, so a reader never sees freed memory.
+ * Writers (open/close) are serialized by the module lock.
+ */
+#define IBV_CTX_TABLE_BITS   (8)
+#define IBV_CTX_TABLE_SIZE   (1 << IBV_CTX_TABLE_BITS)
+#define IBV_CTX_HASH(addr) \
+	((unsigned)((((uint64_t)(addr)) >> 6) * 0x9E3779B97F4A7C15ULL >> (64 - IBV_CTX_TABLE_BITS)))
+
+/*
+ * Registered memory regions are kept in interval tree by address range
+ * and in hash table by handle (ibv_dereg_mr knows handle only).
+ * Ranges of deregistered regions are remembered in direct mapped table
+ * to detect registration of the same buffer again.
+ */
+#define IBV_MR_TABLE_BITS    (10)
+#define IBV_MR_TABLE_SIZE    (1 << IBV_MR_TABLE_BITS)
+#define IBV_MR_HASH(addr) \
+	((unsigned)((((uint64_t)(addr)) >> 4) * 0x9E3779B97F4A7C15ULL >> (64 - IBV_MR_TABLE_BITS)))
+#define IBV_MR_HISTORY_BITS  (12)
+#define IBV_MR_HISTORY_SIZE  (1 << IBV_MR_HISTORY_BITS)
+#define IBV_MR_HISTORY_HASH(start, end) \
+	((unsigned)((((uint64_t)(start)) ^ (((uint64_t)(end)) << 21)) * 0x9E3779B97F4A7C15ULL >> (64 - IBV_MR_HISTORY_BITS)))
+
+struct ibv_mr_t {
+	IBPROF_ITREE_NODE node;
+	uintptr_t addr;
+	struct ibv_mr_t *next;
+};
+
+struct ibv_mr_range_t {
+	uintptr_t start;
+	uintptr_t end;
+};
+
 static struct module_context_t {
 	struct ibv_module_api_t noble;
 	struct ibv_module_api_t mean;
-	struct ibv_ctx_t *ibv_ctx;
+	struct ibv_ctx_t *ibv_ctx;	/* opened contexts */
+	struct ibv_ctx_t *ibv_ctx_retired;	/* closed contexts */
+	struct ibv_ctx_t *ibv_ctx_table[IBV_CTX_TABLE_SIZE];
+	IBPROF_ITREE_NODE *ibv_mr_tree;	/* registered regions by range */
+	struct ibv_mr_t *ibv_mr_table[IBV_MR_TABLE_SIZE];	/* registered regions by handle */
+	struct ibv_mr_range_t ibv_mr_history[IBV_MR_HISTORY_SIZE];	/* deregistered ranges */
+	int64_t ibv_mr_pinned;	/* bytes in registered regions */
+	int64_t ibv_mr_peak;	/* maximum of pinned bytes */
+	CRITICAL_SECTION lock;
 } ibv_module_context;
 
+static struct ibv_ctx_t ibv_ctx_tombstone;
+
+/* Opened context only */
+static inline struct ibv_ctx_t *ibv_ctx_lookup(uintptr_t addr)
+{
+	struct ibv_ctx_t *cur_ibv_ctx = NULL;
+	unsigned idx = IBV_CTX_HASH(addr);
+	int i = 0;
+
+	for (i = 0; i < IBV_CTX_TABLE_SIZE; i++) {
+		cur_ibv_ctx = __atomic_load_n(&ibv_module_context.ibv_ctx_table[idx], __ATOMIC_ACQUIRE);
+		if (!cur_ibv_ctx)
+			break;
+		if (cur_ibv_ctx->addr == addr)
+			return cur_ibv_ctx;
+		idx = (idx + 1) & (IBV_CTX_TABLE_SIZE - 1);
+	}
+
+	return NULL;
+}
+
+static inline struct ibv_ctx_t *ibv_ctx_find(uintptr_t addr)
+{
+	struct ibv_ctx_t *cur_ibv_ctx = ibv_ctx_lookup(addr);
+
+	if (cur_ibv_ctx)
+		return cur_ibv_ctx;
+
+	/* Wrapper in flight can outlive ibv_close_device() of its context */
+	for (cur_ibv_ctx = __atomic_load_n(&ibv_module_context.ibv_ctx_retired, __ATOMIC_ACQUIRE);
+		cur_ibv_ctx; cur_ibv_ctx = cur_ibv_ctx->next)
+		if (cur_ibv_ctx->addr == addr)
+			return cur_ibv_ctx;
+
+	return NULL;
+}
+
+/* Called under module lock */
+static inline int ibv_ctx_insert(struct ibv_ctx_t *new_ibv_ctx)
+{
+	unsigned idx = IBV_CTX_HASH(new_ibv_ctx->addr);
+	int i = 0;
+
+	for (i = 0; i < IBV_CTX_TABLE_SIZE; i++) {
+		if (!ibv_module_context.ibv_ctx_table[idx] ||
+			(ibv_module_context.ibv_ctx_table[idx] == &ibv_ctx_tombstone)) {
+			__atomic_store_n(&ibv_module_context.ibv_ctx_table[idx], new_ibv_ctx, __ATOMIC_RELEASE);
+			return 0;
+		}
+		idx = (idx + 1) & (IBV_CTX_TABLE_SIZE - 1);
+	}
+
+	return -1;
+}
+
+/* Called under module lock */
+static inline void ibv_ctx_remove(struct ibv_ctx_t *old_ibv_ctx)
+{
+	unsigned idx = IBV_CTX_HASH(old_ibv_ctx->addr);
+	int i = 0;
+
+	for (i = 0; i < IBV_CTX_TABLE_SIZE; i++) {
+		if (!ibv_module_context.ibv_ctx_table[idx])
+			break;
+		if (ibv_module_context.ibv_ctx_table[idx] == old_ibv_ctx) {
+			__atomic_store_n(&ibv_module_context.ibv_ctx_table[idx], &ibv_ctx_tombstone, __ATOMIC_RELEASE);
+			break;
+		}
+		idx = (idx + 1) & (IBV_CTX_TABLE_SIZE - 1);
+	}
+}
+
+/*
+ * Registrations keep set of registered ranges that is used by counters
+ * of later registrations and deregistrations, so they are measured on
+ * every invocation when counters are enabled.
+ */
+static inline int ibv_sample_call(int call)
+{
+	if (ibprof_counter_active &&
+		((call == TBL_CALL_NUMBER(ibv_reg_mr))
+#ifdef HAVE_IBV_EXP_REG_MR
+		|| (call == TBL_CALL_NUMBER(ibv_exp_reg_mr))
+#endif
+		))
+		return 1;
+
+	return ibprof_sample_call(IBPROF_MODULE_IBV, call);
+}
+
+/*
+ * Data path calls are attributed to the object they are applied to:
+ * QP number for posts, CQ for polls, SRQ for shared receives and PD
+ * for registrations. Call number is known at compile time, so only
+ * one branch is left in every wrapper.
+ */
+static inline void ibv_resource_update(int call, uintptr_t handle, int64_t tm)
+{
+	if (!ibprof_resource_size)
+		return;
+
+	if ((call == TBL_CALL_NUMBER(ibv_post_send)) ||
+		(call == TBL_CALL_NUMBER(ibv_post_recv)))
+		ibprof_update_call_resource(IBPROF_MODULE_IBV, call, tm,
+				((struct ibv_qp *)handle)->qp_num, "qp %lu");
+	else if (call == TBL_CALL_NUMBER(ibv_post_srq_recv))
+		ibprof_update_call_resource(IBPROF_MODULE_IBV, call, tm, handle, "srq 0x%lx");
+	else if (call == TBL_CALL_NUMBER(ibv_poll_cq))
+		ibprof_update_call_resource(IBPROF_MODULE_IBV, call, tm, handle, "cq 0x%lx");
+	else if (call == TBL_CALL_NUMBER(ibv_reg_mr))
+		ibprof_update_call_resource(IBPROF_MODULE_IBV, call, tm, handle, "pd 0x%lx");
+#ifdef HAVE_IBV_EXP_POLL_CQ_QP
+	else if (call == TBL_CALL_NUMBER(ibv_exp_poll_cq))
+		ibprof_update_call_resource(IBPROF_MODULE_IBV, call, tm, handle, "cq 0x%lx");
+#endif
+#ifdef HAVE_IBV_EXP_POST_SEND
+	else if (call == TBL_CALL_NUMBER(ibv_exp_post_send))
+		ibprof_update_call_resource(IBPROF_MODULE_IBV, call, tm,
+				((struct ibv_qp *)handle)->qp_num, "qp %lu");
+#endif
+}
+
+/*
+ * Completion queue efficiency: polls that return nothing burn CPU,
+ * polls that return all requested entries mean that CQ is drained
+ * slower than it is filled. Completions per poll are kept by power
+ * of two classes.
+ */
+enum {
+	IBV_POLL_CALLS = 0,
+	IBV_POLL_EMPTY,
+	IBV_POLL_FULL,
+	IBV_POLL_ERRORS,
+	IBV_POLL_REQUESTED,
+	IBV_POLL_COMPLETIONS,
+	IBV_POLL_TIME,
+	IBV_POLL_CLASS,
+	IBV_POLL_CLASS_MAX = 7
+};
+
+static const IBPROF_COUNTER_DESC ibv_poll_cq_desc[] = {
+	{ "polls", IBPROF_COUNTER_TOTAL, IBV_POLL_CALLS },
+	{ "empty", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "full (ret == num_entries)", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "errors", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "requested entries", IBPROF_COUNTER_AVERAGE, IBV_POLL_CALLS },
+	{ "completions", IBPROF_COUNTER_AVERAGE, IBV_POLL_CALLS },
+	{ "time", IBPROF_COUNTER_TIME, IBV_POLL_COMPLETIONS },
+	{ "returned 1", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "returned 2..3", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "returned 4..7", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "returned 8..15", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "returned 16..31", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "returned 32..63", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ "returned 64..", IBPROF_COUNTER_PERCENT, IBV_POLL_CALLS },
+	{ NULL, IBPROF_COUNTER_TOTAL, 0 }
+};
+
+static inline void ibv_poll_cq_stat(int call, int num_entries, int ret, int64_t tm)
+{
+	int64_t *value = ibprof_counter_get(IBPROF_MODULE_IBV, call, ibv_poll_cq_desc);
+
+	if (!value)
+		return;
+
+	value[IBV_POLL_CALLS]++;
+	value[IBV_POLL_REQUESTED] += num_entries;
+	value[IBV_POLL_TIME] += tm;
+	if (ret < 0)
+		value[IBV_POLL_ERRORS]++;
+	else if (ret == 0)
+		value[IBV_POLL_EMPTY]++;
+	else {
+		value[IBV_POLL_COMPLETIONS] += ret;
+		value[IBV_POLL_CLASS + ibprof_counter_class(ret, IBV_POLL_CLASS_MAX) - 1]++;
+		if (ret == num_entries)
+			value[IBV_POLL_FULL]++;
+	}
+}
+
+/*
+ * Work request batching: several work requests posted by one call share
+ * a doorbell, so cost of a post is shown per call and per work request.
+ * Work requests per post are kept by power of two classes.
+ */
+enum {
+	IBV_POST_CALLS = 0,
+	IBV_POST_ERRORS,
+	IBV_POST_WR,
+	IBV_POST_SGE,
+	IBV_POST_TIME,
+	IBV_POST_TIME_WR,
+	IBV_POST_CLASS,
+	IBV_POST_CLASS_MAX = 6,
+	IBV_POST_INLINE = IBV_POST_CLASS + IBV_POST_CLASS_MAX,
+	IBV_POST_SIGNALED,
+	IBV_POST_OPCODE
+};
+
+#define IBV_POST_DESC_COMMON \
+	{ "posts", IBPROF_COUNTER_TOTAL, IBV_POST_CALLS }, \
+	{ "errors", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS }, \
+	{ "work requests", IBPROF_COUNTER_AVERAGE, IBV_POST_CALLS }, \
+	{ "scatter/gather entries", IBPROF_COUNTER_AVERAGE, IBV_POST_WR }, \
+	{ "time", IBPROF_COUNTER_TIME, IBV_POST_CALLS }, \
+	{ "time", IBPROF_COUNTER_TIME, IBV_POST_WR }, \
+	{ "posted 1", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS }, \
+	{ "posted 2..3", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS }, \
+	{ "posted 4..7", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS }, \
+	{ "posted 8..15", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS }, \
+	{ "posted 16..31", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS }, \
+	{ "posted 32..", IBPROF_COUNTER_PERCENT, IBV_POST_CALLS },
+
+static const IBPROF_COUNTER_DESC ibv_post_send_desc[] = {
+	IBV_POST_DESC_COMMON
+	{ "inline", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "signaled", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "rdma write", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "rdma write with imm", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "send", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "send with imm", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "rdma read", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "atomic cmp and swp", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "atomic fetch and add", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ "other opcode", IBPROF_COUNTER_PERCENT, IBV_POST_WR },
+	{ NULL, IBPROF_COUNTER_TOTAL, 0 }
+};
+
+static const IBPROF_COUNTER_DESC ibv_post_recv_desc[] = {
+	IBV_POST_DESC_COMMON
+	{ NULL, IBPROF_COUNTER_TOTAL, 0 }
+};
+
+/* Opcodes below are reported by name, the rest as "other opcode" */
+#define IBV_POST_OPCODE_MAX   (IBV_WR_ATOMIC_FETCH_AND_ADD + 1)
+
+static inline void ibv_post_stat(int64_t *value, int wr_count, int sge_count, int ret, int64_t tm)
+{
+	value[IBV_POST_CALLS]++;
+	value[IBV_POST_WR] += wr_count;
+	value[IBV_POST_SGE] += sge_count;
+	value[IBV_POST_TIME] += tm;
+	value[IBV_POST_TIME_WR] += tm;
+	if (ret)
+		value[IBV_POST_ERRORS]++;
+	if (wr_count)
+		value[IBV_POST_CLASS + ibprof_counter_class(wr_count, IBV_POST_CLASS_MAX) - 1]++;
+}
+
+static inline void ibv_post_send_stat(int call, struct ibv_send_wr *wr, int ret, int64_t tm)
+{
+	int64_t *value = ibprof_counter_get(IBPROF_MODULE_IBV, call, ibv_post_send_desc);
+	int wr_count = 0;
+	int sge_count = 0;
+
+	if (!value)
+		return;
+
+	for (; wr; wr = wr->next) {
+		wr_count++;
+		sge_count += wr->num_sge;
+		if (wr->send_flags & IBV_SEND_INLINE)
+			value[IBV_POST_INLINE]++;
+		if (wr->send_flags & IBV_SEND_SIGNALED)
+			value[IBV_POST_SIGNALED]++;
+		if ((unsigned)wr->opcode < IBV_POST_OPCODE_MAX)
+			value[IBV_POST_OPCODE + wr->opcode]++;
+		else
+			value[IBV_POST_OPCODE + IBV_POST_OPCODE_MAX]++;
+	}
+
+	ibv_post_stat(value, wr_count, sge_count, ret, tm);
+}
+
+static inline void ibv_post_recv_stat(int call, struct ibv_recv_wr *wr, int ret, int64_t tm)
+{
+	int64_t *value = ibprof_counter_get(IBPROF_MODULE_IBV, call, ibv_post_recv_desc);
+	int wr_count = 0;
+	int sge_count = 0;
+
+	if (!value)
+		return;
+
+	for (; wr; wr = wr->next) {
+		wr_count++;
+		sge_count += wr->num_sge;
+	}
+
+	ibv_post_stat(value, wr_count, sge_count, ret, tm);
+}
+
+/*
+ * Memory registration: cost per MB, registration of a range that is
+ * registered already or overlaps registered one, registration of a range
+ * that was deregistered recently (registration cache misses) and peak
+ * of registered memory (overlapped regions are counted several times).
+ */
+enum {
+	IBV_REG_CALLS = 0,
+	IBV_REG_ERRORS,
+	IBV_REG_BYTES,
+	IBV_REG_TIME,
+	IBV_REG_TIME_MB,
+	IBV_REG_SAME,
+	IBV_REG_OVERLAP,
+	IBV_REG_AGAIN,
+	IBV_REG_PEAK
+};
+
+static const IBPROF_COUNTER_DESC ibv_reg_mr_desc[] = {
+	{ "registrations", IBPROF_COUNTER_TOTAL, IBV_REG_CALLS },
+	{ "errors", IBPROF_COUNTER_PERCENT, IBV_REG_CALLS },
+	{ "bytes", IBPROF_COUNTER_BYTES, IBV_REG_CALLS },
+	{ "time", IBPROF_COUNTER_TIME, IBV_REG_CALLS },
+	{ "time", IBPROF_COUNTER_TIME, IBV_REG_BYTES },
+	{ "range is registered", IBPROF_COUNTER_PERCENT, IBV_REG_CALLS },
+	{ "range overlaps registered", IBPROF_COUNTER_PERCENT, IBV_REG_CALLS },
+	{ "range was deregistered", IBPROF_COUNTER_PERCENT, IBV_REG_CALLS },
+	{ "peak registered bytes", IBPROF_COUNTER_PEAK, IBV_REG_CALLS },
+	{ NULL, IBPROF_COUNTER_TOTAL, 0 }
+};
+
+static inline void ibv_reg_mr_stat(int call, void *addr, size_t length, struct ibv_mr *mr, int64_t tm)
+{
+	int64_t *value = ibprof_counter_get(IBPROF_MODULE_IBV, call, ibv_reg_mr_desc);
+	struct ibv_mr_t *cur_ibv_mr = NULL;
+	struct ibv_mr_range_t *range = NULL;
+	IBPROF_ITREE_MATCH match = IBPROF_ITREE_NONE;
+	unsigned idx = 0;
+
+	if (!value)
+		return;
+
+	value[IBV_REG_CALLS]++;
+	value[IBV_REG_TIME] += tm;
+	value[IBV_REG_TIME_MB] += tm;
+	if (!mr) {
+		value[IBV_REG_ERRORS]++;
+		return;
+	}
+	value[IBV_REG_BYTES] += length;
+
+	cur_ibv_mr = sys_malloc(sizeof(*cur_ibv_mr));
+	if (!cur_ibv_mr)
+		return;
+	cur_ibv_mr->addr = (uintptr_t)mr;
+	cur_ibv_mr->node.start = (uintptr_t)addr;
+	cur_ibv_mr->node.end = (uintptr_t)addr + length;
+
+	ENTER_CRITICAL(&ibv_module_context.lock);
+
+	match = ibprof_itree_match(ibv_module_context.ibv_mr_tree,
+			cur_ibv_mr->node.start, cur_ibv_mr->node.end);
+	if (match == IBPROF_ITREE_EXACT)
+		value[IBV_REG_SAME]++;
+	else if (match == IBPROF_ITREE_OVERLAP)
+		value[IBV_REG_OVERLAP]++;
+
+	range = &ibv_module_context.ibv_mr_history[
+			IBV_MR_HISTORY_HASH(cur_ibv_mr->node.start, cur_ibv_mr->node.end)];
+	if ((range->start == cur_ibv_mr->node.start) && (range->end == cur_ibv_mr->node.end)) {
+		value[IBV_REG_AGAIN]++;
+		range->start = range->end = 0;
+	}
+
+	ibprof_itree_insert(&ibv_module_context.ibv_mr_tree, &cur_ibv_mr->node);
+	idx = IBV_MR_HASH(cur_ibv_mr->addr);
+	cur_ibv_mr->next = ibv_module_context.ibv_mr_table[idx];
+	ibv_module_context.ibv_mr_table[idx] = cur_ibv_mr;
+
+	ibv_module_context.ibv_mr_pinned += length;
+	if (ibv_module_context.ibv_mr_pinned > ibv_module_context.ibv_mr_peak)
+		ibv_module_context.ibv_mr_peak = ibv_module_context.ibv_mr_pinned;
+	value[IBV_REG_PEAK] = ibv_module_context.ibv_mr_peak;
+
+	LEAVE_CRITICAL(&ibv_module_context.lock);
+}
+
+/* Region is detached before ibv_dereg_mr() as handle can be reused right after it */
+static inline struct ibv_mr_t *ibv_dereg_mr_handler(struct ibv_mr *mr)
+{
+	struct ibv_mr_t *cur_ibv_mr = NULL;
+	struct ibv_mr_t **prev = NULL;
+
+	if (!ibprof_counter_active || !mr)
+		return NULL;
+
+	ENTER_CRITICAL(&ibv_module_context.lock);
+
+	prev = &ibv_module_context.ibv_mr_table[IBV_MR_HASH(mr)];
+	while (*prev && ((*prev)->addr != (uintptr_t)mr))
+		prev = &(*prev)->next;
+	cur_ibv_mr = *prev;
+	if (cur_ibv_mr) {
+		*prev = cur_ibv_mr->next;
+		ibprof_itree_remove(&ibv_module_context.ibv_mr_tree, &cur_ibv_mr->node);
+		ibv_module_context.ibv_mr_pinned -= cur_ibv_mr->node.end - cur_ibv_mr->node.start;
+	}
+
+	LEAVE_CRITICAL(&ibv_module_context.lock);
+
+	return cur_ibv_mr;
+}
+
+/* Region is returned back if ibv_dereg_mr() fails */
+static inline void ibv_dereg_mr_complete(struct ibv_mr_t *cur_ibv_mr, int ret)
+{
+	struct ibv_mr_range_t *range = NULL;
+	unsigned idx = 0;
+
+	if (!cur_ibv_mr)
+		return;
+
+	ENTER_CRITICAL(&ibv_module_context.lock);
+
+	if (ret) {
+		ibprof_itree_insert(&ibv_module_context.ibv_mr_tree, &cur_ibv_mr->node);
+		idx = IBV_MR_HASH(cur_ibv_mr->addr);
+		cur_ibv_mr->next = ibv_module_context.ibv_mr_table[idx];
+		ibv_module_context.ibv_mr_table[idx] = cur_ibv_mr;
+		ibv_module_context.ibv_mr_pinned += cur_ibv_mr->node.end - cur_ibv_mr->node.start;
+		cur_ibv_mr = NULL;
+	} else {
+		range = &ibv_module_context.ibv_mr_history[
+				IBV_MR_HISTORY_HASH(cur_ibv_mr->node.start, cur_ibv_mr->node.end)];
+		range->start = cur_ibv_mr->node.start;
+		range->end = cur_ibv_mr->node.end;
+	}
+
+	LEAVE_CRITICAL(&ibv_module_context.lock);
+
+	sys_free(cur_ibv_mr);
+}
+
 /*
  * How to fill the following list:
  * First, the function must be mentioned in (lib)ibverbs.
@@ -588,6 +1101,7 @@ static struct module_context_t {
         { \
             void* ret = NULL;                                  \
             int flip_ret = 0;                                  \
+            uintptr_t call_handle = (uintptr_t)device;         \
             EMPLOY_TYPE(ibv_open_device) *f;                   \
             FUNC_BODY_RESOLVE_(ibv_open_device)                \
             PRE_##TYPE(ibv_open_device)                        \
@@ -595,12 +1109,14 @@ static struct module_context_t {
             ibv_open_device_handler((struct ibv_context*)ret); \
             POST_RET_##TYPE(ibv_open_device)                   \
             PRETEND_USED(flip_ret);                            \
+            PRETEND_USED(call_handle);                         \
             return ret;                                        \
         }; \
         int TYPE ## ibv_close_device(struct ibv_context *context) \
         { \
             int ret;                                \
             int flip_ret = 1;                       \
+            uintptr_t call_handle = (uintptr_t)context; \
             EMPLOY_TYPE(ibv_close_device) *f;       \
             ibv_close_device_handler(context);      \
             FUNC_BODY_RESOLVE_(ibv_close_device)    \
@@ -608,6 +1124,7 @@ static struct module_context_t {
             ret = f(context);                       \
             POST_##TYPE(ibv_close_device)           \
             PRETEND_USED(flip_ret);                 \
+            PRETEND_USED(call_handle);              \
             return ret;                             \
         }; \
         int TYPE ## ibv_query_device(struct ibv_context *context, struct ibv_device_attr *device_attr) \
@@ -620,7 +1137,22 @@ static struct module_context_t {
         { FUNC_BODY_INT(TYPE, _, ibv_dealloc_pd, dealloc_pd, , pd) }; \
         HAVE_IBV_REG_MR_FUNC(TYPE) \
         int TYPE ## ibv_dereg_mr(struct ibv_mr *mr) \
-        { FUNC_BODY_INT(TYPE, _, ibv_dereg_mr, dereg_mr, , mr) }; \
+        { \
+            int ret;                                \
+            int flip_ret = 1;                       \
+            uintptr_t call_handle = (uintptr_t)mr;  \
+            struct ibv_mr_t *cur_ibv_mr = ibv_dereg_mr_handler(mr); \
+            EMPLOY_TYPE(ibv_dereg_mr) *f;           \
+            FUNC_BODY_RESOLVE_(ibv_dereg_mr)        \
+            PRE_##TYPE(ibv_dereg_mr)                \
+            INTERNAL_CHECK();                       \
+            ret = f(mr);                            \
+            ibv_dereg_mr_complete(cur_ibv_mr, ret); \
+            POST_RET_##TYPE(ibv_dereg_mr)           \
+            PRETEND_USED(flip_ret);                 \
+            PRETEND_USED(call_handle);              \
+            return ret;                             \
+        }; \
         struct ibv_comp_channel* TYPE ## ibv_create_comp_channel(struct ibv_context *context) \
         { FUNC_BODY_PTR(TYPE, _, ibv_create_comp_channel, , , context) }; \
         int TYPE ## ibv_destroy_comp_channel(struct ibv_comp_channel *channel) \
@@ -653,15 +1185,19 @@ static struct module_context_t {
 
 #define DECLARE_OPTION_FUNCTIONS_INLINE(TYPE) \
         int TYPE ## ibv_poll_cq(struct ibv_cq *cq, int ne, struct ibv_wc *wc) \
-        { FUNC_BODY_INT(TYPE, _IBV, ibv_poll_cq, poll_cq, cq->context, cq, ne, wc) }; \
+        { FUNC_BODY_INT_STAT(TYPE, _IBV, ibv_poll_cq, poll_cq, cq->context, -1, \
+            ibv_poll_cq_stat(TBL_CALL_NUMBER(ibv_poll_cq), ne, ret, tm_diff), cq, ne, wc) }; \
         int TYPE ## ibv_post_send(struct ibv_qp *ibqp, struct ibv_send_wr *wr, struct ibv_send_wr **bad_wr) \
-        { FUNC_BODY_INT(TYPE, _IBV, ibv_post_send, post_send, ibqp->context, ibqp, wr, bad_wr) }; \
+        { FUNC_BODY_INT_STAT(TYPE, _IBV, ibv_post_send, post_send, ibqp->context, ibv_send_wr_size(wr), \
+            ibv_post_send_stat(TBL_CALL_NUMBER(ibv_post_send), wr, ret, tm_diff), ibqp, wr, bad_wr) }; \
         int TYPE ## ibv_post_recv(struct ibv_qp *ibqp, struct ibv_recv_wr *wr, struct ibv_recv_wr **bad_wr) \
-        { FUNC_BODY_INT(TYPE, _IBV, ibv_post_recv, post_recv, ibqp->context, ibqp, wr, bad_wr) }; \
+        { FUNC_BODY_INT_STAT(TYPE, _IBV, ibv_post_recv, post_recv, ibqp->context, ibv_recv_wr_size(wr), \
+            ibv_post_recv_stat(TBL_CALL_NUMBER(ibv_post_recv), wr, ret, tm_diff), ibqp, wr, bad_wr) }; \
         int TYPE ## ibv_req_notify_cq(struct ibv_cq *cq, int solicited_only) \
         { FUNC_BODY_INT(TYPE, _IBV, ibv_req_notify_cq, req_notify_cq, cq->context, cq, solicited_only) }; \
         int TYPE ## ibv_post_srq_recv(struct ibv_srq *srq, struct ibv_recv_wr *recv_wr, struct ibv_recv_wr **bad_recv_wr) \
-        { FUNC_BODY_INT(TYPE, _IBV, ibv_post_srq_recv, post_srq_recv, srq->context, srq, recv_wr, bad_recv_wr) }; \
+        { FUNC_BODY_INT_STAT(TYPE, _IBV, ibv_post_srq_recv, post_srq_recv, srq->context, ibv_recv_wr_size(recv_wr), \
+            ibv_post_recv_stat(TBL_CALL_NUMBER(ibv_post_srq_recv), recv_wr, ret, tm_diff), srq, recv_wr, bad_recv_wr) }; \
         int TYPE ## ibv_query_port(struct ibv_context *context, uint8_t port_num, struct ibv_port_attr *port_attr) \
         { FUNC_BODY_INT(TYPE, _IBV, ibv_query_port, query_port, context, context, port_num, port_attr) }; \
 \
@@ -723,21 +1259,25 @@ static struct module_context_t {
 static inline void ibv_open_device_handler(struct ibv_context *ret)
 {
 	if (ret)  {
-		struct ibv_ctx_t *cur_ibv_ctx = ibv_module_context.ibv_ctx;
-		struct ibv_ctx_t *new_ibv_ctx = NULL;
+		struct ibv_ctx_t *cur_ibv_ctx = NULL;
+
+		ENTER_CRITICAL(&ibv_module_context.lock);
 
 		/* This protection is in place because this function is called
 		* twice: one with the prefix and suffix of choice (e.g. profiling)
 		* and once as the original function, replacing ibv_open_device() so
 		* that the LD_PRELOAD replaces the original, so we can hook it.
 		*/
-		if (cur_ibv_ctx && ((void*)cur_ibv_ctx->addr == ret)) {
+		if (ibv_ctx_lookup((uintptr_t)ret)) {
+			LEAVE_CRITICAL(&ibv_module_context.lock);
 			return;
 		}
 
-		new_ibv_ctx = sys_malloc(sizeof(*cur_ibv_ctx));
-		new_ibv_ctx->next = cur_ibv_ctx;
-		cur_ibv_ctx = ibv_module_context.ibv_ctx = new_ibv_ctx;
+		cur_ibv_ctx = sys_malloc(sizeof(*cur_ibv_ctx));
+		if (!cur_ibv_ctx) {
+			LEAVE_CRITICAL(&ibv_module_context.lock);
+			return;
+		}
 		cur_ibv_ctx->addr = (uintptr_t)ret;
 
 		/* Save original addresses of ops */
@@ -750,6 +1290,17 @@ static inline void ibv_open_device_handler(struct ibv_context *ret)
 		sys_memcpy(&(cur_ibv_ctx->item), ret, sizeof(cur_ibv_ctx->item));
 #endif /* IBV_API_EXT */
 
+		/* Context should be visible before its ops are replaced */
+		if (ibv_ctx_insert(cur_ibv_ctx)) {
+			IBPROF_WARN("%s : too many opened contexts, context %p is not profiled\n",
+					__FUNCTION__, (void *)ret);
+			sys_free(cur_ibv_ctx);
+			LEAVE_CRITICAL(&ibv_module_context.lock);
+			return;
+		}
+		cur_ibv_ctx->next = ibv_module_context.ibv_ctx;
+		ibv_module_context.ibv_ctx = cur_ibv_ctx;
+
 		/* Replace original ops with wrappers */
 		check_api(query_port);
 		check_api(poll_cq);
@@ -787,14 +1338,20 @@ static inline void ibv_open_device_handler(struct ibv_context *ret)
 		HAVE_IBV_EXP_QUERY_MKEY_CHECK();
 		HAVE_IBV_EXP_ALLOC_MKEY_LIST_MEMORY_CHECK();
 		HAVE_IBV_EXP_DEALLOC_MKEY_LIST_MEMORY_CHECK();
+
+		LEAVE_CRITICAL(&ibv_module_context.lock);
 	}
 }
 
 static inline void ibv_close_device_handler(struct ibv_context *context)
 {
 	if (ibv_module_context.ibv_ctx)	{
-		struct ibv_ctx_t *cur_ibv_ctx = ibv_module_context.ibv_ctx;
+		struct ibv_ctx_t *cur_ibv_ctx = NULL;
 		struct ibv_ctx_t *prev_ibv_ctx = NULL;
+
+		ENTER_CRITICAL(&ibv_module_context.lock);
+
+		cur_ibv_ctx = ibv_module_context.ibv_ctx;
 		while (cur_ibv_ctx && (cur_ibv_ctx->addr != (uintptr_t)context)) {
 			prev_ibv_ctx = cur_ibv_ctx;
 			cur_ibv_ctx = cur_ibv_ctx->next;
@@ -806,6 +1363,7 @@ static inline void ibv_close_device_handler(struct ibv_context *context)
          * that the LD_PRELOAD replaces the original, so we can hook it.
          */
 		if (!cur_ibv_ctx) {
+		    LEAVE_CRITICAL(&ibv_module_context.lock);
 		    return;
 		}
 
@@ -821,7 +1379,13 @@ static inline void ibv_close_device_handler(struct ibv_context *context)
 			prev_ibv_ctx->next = cur_ibv_ctx->next;
 		else
 			ibv_module_context.ibv_ctx = cur_ibv_ctx->next;
-		sys_free(cur_ibv_ctx);
+
+		/* Wrappers in flight can still use it, so release on exit only */
+		cur_ibv_ctx->next = ibv_module_context.ibv_ctx_retired;
+		__atomic_store_n(&ibv_module_context.ibv_ctx_retired, cur_ibv_ctx, __ATOMIC_RELEASE);
+		ibv_ctx_remove(cur_ibv_ctx);
+
+		LEAVE_CRITICAL(&ibv_module_context.lock);
 	}
 }
 
@@ -849,6 +1413,12 @@ DECLARE_OPTION(NONE)
 #define PREFIX_PROF(x) PROF##x,
 DECLARE_OPTION(PROF)
 
+#define PREFIX_PROF_HIST(x) PROF_HIST##x,
+DECLARE_OPTION(PROF_HIST)
+
+#define PREFIX_PROF_BASE(x) PROF_BASE##x,
+DECLARE_OPTION(PROF_BASE)
+
 #define PREFIX_VERBOSE(x) VERBOSE##x,
 DECLARE_OPTION(VERBOSE)
 
@@ -858,6 +1428,9 @@ DECLARE_OPTION(TRACE)
 #define PREFIX_ERR(x) ERR##x,
 DECLARE_OPTION(ERR)
 
+#define PREFIX_DELAY(x) DELAY##x,
+DECLARE_OPTION(DELAY)
+
 /****************************************************************************
  * Module configuration place
  ***************************************************************************/
@@ -909,6 +1482,14 @@ static IBPROF_ERROR __ibv_init(IBPROF_MODULE_OBJECT *mod_obj)
 	check_dlsym(ibv_detach_mcast);
 
 	ibv_module_context.ibv_ctx = NULL;
+	ibv_module_context.ibv_ctx_retired = NULL;
+	sys_memset(ibv_module_context.ibv_ctx_table, 0, sizeof(ibv_module_context.ibv_ctx_table));
+	ibv_module_context.ibv_mr_tree = NULL;
+	sys_memset(ibv_module_context.ibv_mr_table, 0, sizeof(ibv_module_context.ibv_mr_table));
+	sys_memset(ibv_module_context.ibv_mr_history, 0, sizeof(ibv_module_context.ibv_mr_history));
+	ibv_module_context.ibv_mr_pinned = 0;
+	ibv_module_context.ibv_mr_peak = 0;
+	INIT_CRITICAL(&ibv_module_context.lock);
 
 	switch (ibprof_conf_get_int(IBPROF_MODE_IBV)) {
 	case IBPROF_MODE_NONE:
@@ -920,7 +1501,19 @@ static IBPROF_ERROR __ibv_init(IBPROF_MODULE_OBJECT *mod_obj)
 		break;
 
 	case IBPROF_MODE_PROF:
-		src_api = &ibv_PROF_funcs;
+		/* Wrappers without checks of disabled features */
+		switch (ibprof_hash_update_features()) {
+		case IBPROF_UPDATE_HIST:
+			src_api = &ibv_PROF_HIST_funcs;
+			break;
+
+		case 0:
+			src_api = &ibv_PROF_BASE_funcs;
+			break;
+
+		default:
+			src_api = &ibv_PROF_funcs;
+		}
 		break;
 
 	case IBPROF_MODE_ERR:
@@ -931,6 +1524,10 @@ static IBPROF_ERROR __ibv_init(IBPROF_MODULE_OBJECT *mod_obj)
 		src_api = &ibv_TRACE_funcs;
 		break;
 
+	case IBPROF_MODE_DELAY:
+		src_api = &ibv_DELAY_funcs;
+		break;
+
 	default:
 		src_api = &ibv_NONE_funcs;
 	}
@@ -944,6 +1541,8 @@ static IBPROF_ERROR __ibv_exit(IBPROF_MODULE_OBJECT *mod_obj)
 {
 	IBPROF_ERROR status = IBPROF_ERR_NONE;
 	struct ibv_ctx_t *cur_ibv_ctx = ibv_module_context.ibv_ctx;
+	struct ibv_mr_t *cur_ibv_mr = NULL;
+	int i = 0;
 
 	while (cur_ibv_ctx) {
 		struct ibv_context *context = (struct ibv_context *)cur_ibv_ctx->addr;
@@ -961,6 +1560,23 @@ static IBPROF_ERROR __ibv_exit(IBPROF_MODULE_OBJECT *mod_obj)
 	}
 	ibv_module_context.ibv_ctx = NULL;
 
+	while (ibv_module_context.ibv_ctx_retired) {
+		cur_ibv_ctx = ibv_module_context.ibv_ctx_retired;
+		ibv_module_context.ibv_ctx_retired = cur_ibv_ctx->next;
+		sys_free(cur_ibv_ctx);
+	}
+	sys_memset(ibv_module_context.ibv_ctx_table, 0, sizeof(ibv_module_context.ibv_ctx_table));
+
+	for (i = 0; i < IBV_MR_TABLE_SIZE; i++) {
+		while (ibv_module_context.ibv_mr_table[i]) {
+			cur_ibv_mr = ibv_module_context.ibv_mr_table[i];
+			ibv_module_context.ibv_mr_table[i] = cur_ibv_mr->next;
+			sys_free(cur_ibv_mr);
+		}
+	}
+	ibv_module_context.ibv_mr_tree = NULL;
+	DELETE_CRITICAL(&ibv_module_context.lock);
+
 	return status;
 }
 
@@ -21,6 +21,17 @@
  * #define POST_RET_SUFFIX(func_name)
  * - what to do after the original is called (return value is "ret")
  *
+ * Calls that transfer data use POST_SIZE_SUFFIX(func_name, size) and
+ * POST_RET_SIZE_SUFFIX(func_name, size) where size is an expression
+ * evaluated after the original is called.
+ *
+ * Calls that have own counters use POST_RET_STAT_SUFFIX(func_name, size, stat)
+ * where stat is an expression evaluated in statistics collecting modes
+ * only, it can use "ret" and call duration "tm_diff".
+ *
+ * Profiling mode measures invocations selected by ibv_sample_call()
+ * only, the rest are counted and skipped.
+ *
  * Also, need to add a single line using this macro in the .c file.
  */
 
@@ -34,6 +45,9 @@
 #define PRE_NONE(func_name)
 #define POST_NONE(func_name)
 #define POST_RET_NONE(func_name)
+#define POST_SIZE_NONE(func_name, size)
+#define POST_RET_SIZE_NONE(func_name, size)
+#define POST_RET_STAT_NONE(func_name, size, stat)
 
 /* Verbose mode - output the name of the functions entered and left */
 #define PRE_VERBOSE(func_name) IBPROF_TRACE("IN %s:%s\n", __FILE__, __FUNCTION__);
@@ -41,36 +55,122 @@
     IBPROF_TRACE("OUT %s:%s\n", __FILE__, __FUNCTION__);
 #define POST_RET_VERBOSE(func_name) PRETEND_USED(flip_ret); \
     IBPROF_TRACE("OUT %s:%s\n", __FILE__, __FUNCTION__);
+#define POST_SIZE_VERBOSE(func_name, size) POST_VERBOSE(func_name)
+#define POST_RET_SIZE_VERBOSE(func_name, size) POST_RET_VERBOSE(func_name)
+#define POST_RET_STAT_VERBOSE(func_name, size, stat) POST_RET_VERBOSE(func_name)
 
 /* Profiling mode - collect timing information about function run-times */
 #define PRE_PROF(func_name) \
-	double tm_start; \
-	tm_start = ibprof_timestamp();
-#define POST_PROF(func_name) \
-	ibprof_update(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start));
-#define POST_RET_PROF(func_name) \
-	ibprof_update(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start));
+	int64_t tm_start = 0; \
+	int sampled = ibv_sample_call(TBL_CALL_NUMBER(func_name)); \
+	if (sampled) tm_start = ibprof_clock_ticks();
+#define POST_PROF(func_name) POST_SIZE_PROF(func_name, -1)
+#define POST_RET_PROF(func_name) POST_PROF(func_name)
+#define POST_SIZE_PROF(func_name, size) \
+	POST_RET_STAT_PROF_OPT(func_name, size, 0, IBPROF_UPDATE_ALL)
+#define POST_RET_SIZE_PROF(func_name, size) POST_SIZE_PROF(func_name, size)
+#define POST_RET_STAT_PROF(func_name, size, stat) \
+	POST_RET_STAT_PROF_OPT(func_name, size, stat, IBPROF_UPDATE_ALL)
+#define POST_RET_STAT_PROF_OPT(func_name, size, stat, opt) if (sampled) { \
+	int64_t tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_opt(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size), (opt)); \
+	ibv_resource_update(TBL_CALL_NUMBER(func_name), call_handle, tm_diff); \
+	(void)(stat); }
+
+/*
+ * Profiling mode specialized by statistics update features: the variant
+ * is selected on initialization by configuration, so warmup and histogram
+ * checks are not done on every call.
+ * PROF_HIST - no warmup, latency histogram is collected (default settings)
+ * PROF_BASE - no warmup, no histogram
+ * PROF is used when warmup is set or calls are charged to user intervals.
+ */
+#define PRE_PROF_HIST(func_name) PRE_PROF(func_name)
+#define POST_PROF_HIST(func_name) POST_SIZE_PROF_HIST(func_name, -1)
+#define POST_RET_PROF_HIST(func_name) POST_PROF_HIST(func_name)
+#define POST_SIZE_PROF_HIST(func_name, size) \
+	POST_RET_STAT_PROF_OPT(func_name, size, 0, IBPROF_UPDATE_HIST)
+#define POST_RET_SIZE_PROF_HIST(func_name, size) POST_SIZE_PROF_HIST(func_name, size)
+#define POST_RET_STAT_PROF_HIST(func_name, size, stat) \
+	POST_RET_STAT_PROF_OPT(func_name, size, stat, IBPROF_UPDATE_HIST)
+
+#define PRE_PROF_BASE(func_name) PRE_PROF(func_name)
+#define POST_PROF_BASE(func_name) POST_SIZE_PROF_BASE(func_name, -1)
+#define POST_RET_PROF_BASE(func_name) POST_PROF_BASE(func_name)
+#define POST_SIZE_PROF_BASE(func_name, size) \
+	POST_RET_STAT_PROF_OPT(func_name, size, 0, 0)
+#define POST_RET_SIZE_PROF_BASE(func_name, size) POST_SIZE_PROF_BASE(func_name, size)
+#define POST_RET_STAT_PROF_BASE(func_name, size, stat) \
+	POST_RET_STAT_PROF_OPT(func_name, size, stat, 0)
+
+/* Delay-injection mode - busy-wait before the call, time is profiled */
+#define PRE_DELAY(func_name) \
+	PRE_PROF(func_name) \
+	ibprof_delay_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name));
+#define POST_DELAY(func_name) POST_PROF(func_name)
+#define POST_RET_DELAY(func_name) POST_RET_PROF(func_name)
+#define POST_SIZE_DELAY(func_name, size) POST_SIZE_PROF(func_name, size)
+#define POST_RET_SIZE_DELAY(func_name, size) POST_RET_SIZE_PROF(func_name, size)
+#define POST_RET_STAT_DELAY(func_name, size, stat) POST_RET_STAT_PROF(func_name, size, stat)
 
 /* Error-injection mode - return an error with some probability */
 #define PRE_ERR(func_name) \
-	double tm_start; \
+	int64_t tm_start; \
 	int64_t err = 0; \
-	tm_start = ibprof_timestamp();
-#define POST_ERR(func_name) \
-	ibprof_update_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start), &err);
-#define POST_RET_ERR(func_name) \
-	if ((rand() % 100) < ibprof_conf_get_int(IBPROF_ERR_PERCENT)) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
+	tm_start = ibprof_clock_ticks();
+#define POST_ERR(func_name) { \
+	int64_t tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_diff, &err); \
+	ibv_resource_update(TBL_CALL_NUMBER(func_name), call_handle, tm_diff); }
+#define POST_RET_ERR(func_name) { \
+	int64_t tm_diff; \
+	if (ibprof_fault_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name))) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
+	err = (flip_ret ? (ret != 0) : (ret == 0)); \
+	tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_diff, &err); \
+	ibv_resource_update(TBL_CALL_NUMBER(func_name), call_handle, tm_diff); }
+#define POST_SIZE_ERR(func_name, size) { \
+	int64_t tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_size_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size), &err); \
+	ibv_resource_update(TBL_CALL_NUMBER(func_name), call_handle, tm_diff); }
+#define POST_RET_SIZE_ERR(func_name, size) { \
+	int64_t tm_diff; \
+	if (ibprof_fault_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name))) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
+	err = (flip_ret ? (ret != 0) : (ret == 0)); \
+	tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_size_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size), &err); \
+	ibv_resource_update(TBL_CALL_NUMBER(func_name), call_handle, tm_diff); }
+#define POST_RET_STAT_ERR(func_name, size, stat) { \
+	int64_t tm_diff; \
+	if (ibprof_fault_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name))) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
 	err = (flip_ret ? (ret != 0) : (ret == 0)); \
-	ibprof_update_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start), &err);
+	tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_update_call_size_ex(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_diff, (size), &err); \
+	ibv_resource_update(TBL_CALL_NUMBER(func_name), call_handle, tm_diff); \
+	(void)(stat); }
 
-/* TODO: Stack-tracing mode - collect information about the origin of function calls */
-#define PRE_TRACE(func_name)
-#define POST_TRACE(func_name)
-#define POST_RET_TRACE(func_name)
+/* Trace mode - record start and duration of every call to a trace file */
+#define PRE_TRACE(func_name) \
+	int64_t tm_start; \
+	tm_start = ibprof_clock_ticks();
+#define POST_TRACE(func_name) \
+	ibprof_trace_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_start, ibprof_clock_diff(tm_start), -1, call_handle);
+#define POST_RET_TRACE(func_name) \
+	ibprof_trace_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_start, ibprof_clock_diff(tm_start), -1, call_handle);
+#define POST_SIZE_TRACE(func_name, size) { \
+	int64_t tm_diff = ibprof_clock_diff(tm_start); \
+	ibprof_trace_call(IBPROF_MODULE_IBV, TBL_CALL_NUMBER(func_name), \
+            tm_start, tm_diff, (size), call_handle); }
+#define POST_RET_SIZE_TRACE(func_name, size) POST_SIZE_TRACE(func_name, size)
+#define POST_RET_STAT_TRACE(func_name, size, stat) POST_SIZE_TRACE(func_name, size)
 
 /*
  * Common macros, presenting the function stubs
@@ -78,14 +178,15 @@
 #define PRE_(func_name) f = ibv_module_context.mean.func_name;
 #define POST_(func_name)
 #define POST_RET_(func_name)
+#define POST_SIZE_(func_name, size)
+#define POST_RET_SIZE_(func_name, size)
+#define POST_RET_STAT_(func_name, size, stat)
 
-#define FUNC_BODY_RESOLVE_GET_CTX(context) ({                           \
-    struct ibv_ctx_t *cur_ibv_ctx = ibv_module_context.ibv_ctx;         \
-        while ((cur_ibv_ctx->addr != (uintptr_t)context) &&             \
-            cur_ibv_ctx->next)                                          \
-            cur_ibv_ctx = cur_ibv_ctx->next;                            \
-    cur_ibv_ctx;                                                        \
-    })
+/* First argument of a verbs call is the object it is applied to */
+#define IBV_CALL_HANDLE(handle, ...) ((uintptr_t)(handle))
+
+#define FUNC_BODY_RESOLVE_GET_CTX(context)                              \
+    ibv_ctx_find((uintptr_t)(context))
 
 #define FUNC_BODY_RESOLVE_(func_name, ...)                              \
     f = ibv_module_context.noble.func_name;
@@ -126,34 +227,96 @@
     int ret;                                                            \
     int flip_ret = 1;                                                   \
     EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
     FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
     PRE_##type(func_name)                                               \
     INTERNAL_CHECK();                                                   \
     ret = f(__VA_ARGS__);                                               \
     POST_RET_##type(func_name)                                          \
     PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);                                          \
     return ret;
 
 #define FUNC_BODY_VOID(type, ctx_type, func_name, ex_name, ctx, ...)    \
     int flip_ret = 0;                                                   \
     EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
     FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
     PRE_##type(func_name)                                               \
     INTERNAL_CHECK();                                                   \
     f(__VA_ARGS__);                                                     \
     POST_##type(func_name)                                              \
-    PRETEND_USED(flip_ret);
+    PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);
 
 #define FUNC_BODY_PTR(type, ctx_type, func_name, ex_name, ctx, ...)     \
     void* ret;                                                          \
     int flip_ret = 0;                                                   \
     EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
     FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
     PRE_##type(func_name)                                               \
     INTERNAL_CHECK();                                                   \
     ret = f(__VA_ARGS__);                                               \
     POST_RET_##type(func_name)                                          \
     PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);                                          \
+    return ret;
+
+#define FUNC_BODY_INT_SIZE(type, ctx_type, func_name, ex_name, ctx, size, ...) \
+    int ret;                                                            \
+    int flip_ret = 1;                                                   \
+    EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
+    FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
+    PRE_##type(func_name)                                               \
+    INTERNAL_CHECK();                                                   \
+    ret = f(__VA_ARGS__);                                               \
+    POST_RET_SIZE_##type(func_name, size)                               \
+    PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);                                          \
+    return ret;
+
+#define FUNC_BODY_INT_STAT(type, ctx_type, func_name, ex_name, ctx, size, stat, ...) \
+    int ret;                                                            \
+    int flip_ret = 1;                                                   \
+    EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
+    FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
+    PRE_##type(func_name)                                               \
+    INTERNAL_CHECK();                                                   \
+    ret = f(__VA_ARGS__);                                               \
+    POST_RET_STAT_##type(func_name, size, stat)                         \
+    PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);                                          \
+    return ret;
+
+#define FUNC_BODY_PTR_STAT(type, ctx_type, func_name, ex_name, ctx, size, stat, ...) \
+    void* ret;                                                          \
+    int flip_ret = 0;                                                   \
+    EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
+    FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
+    PRE_##type(func_name)                                               \
+    INTERNAL_CHECK();                                                   \
+    ret = f(__VA_ARGS__);                                               \
+    POST_RET_STAT_##type(func_name, size, stat)                         \
+    PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);                                          \
+    return ret;
+
+#define FUNC_BODY_PTR_SIZE(type, ctx_type, func_name, ex_name, ctx, size, ...) \
+    void* ret;                                                          \
+    int flip_ret = 0;                                                   \
+    EMPLOY_TYPE(func_name) *f;                                          \
+    uintptr_t call_handle = IBV_CALL_HANDLE(__VA_ARGS__, 0);            \
+    FUNC_BODY_RESOLVE##ctx_type(func_name, ex_name, ctx)                \
+    PRE_##type(func_name)                                               \
+    INTERNAL_CHECK();                                                   \
+    ret = f(__VA_ARGS__);                                               \
+    POST_RET_SIZE_##type(func_name, size)                               \
+    PRETEND_USED(flip_ret);                                             \
+    PRETEND_USED(call_handle);                                          \
     return ret;
 
 #define EMPLOY_TYPE(func_name) __type_of_##func_name
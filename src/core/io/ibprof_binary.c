@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_types.h"
+#include "ibprof_io.h"
+#include "ibprof_binary.h"
+
+static const char *_ibprof_module_name(IBPROF_OBJECT *ibprof_obj, int module);
+
+static const char *_ibprof_call_name(IBPROF_OBJECT *ibprof_obj, int module, int call);
+
+static void _ibprof_header_fill(IBPROF_BINARY_HEADER *header, IBPROF_OBJECT *ibprof_obj,
+		uint32_t record_count);
+
+static void _ibprof_record_fill(IBPROF_BINARY_RECORD *record, IBPROF_OBJECT *ibprof_obj,
+		IBPROF_HASH_OBJ *entry);
+
+static int _ibprof_thread_fill(IBPROF_BINARY_RECORD *records, IBPROF_OBJECT *ibprof_obj,
+		int max);
+
+static int _ibprof_write(int fd, const void *buf, size_t len);
+
+/**
+ * ibprof_io_binary_dump
+ *
+ * @brief
+ *    Dumps all gathered information in versioned binary format
+ *    (see ibprof_binary.h) that is merged across ranks by ibprof-merge.
+ *    Dump is written by single write() to the end of file, so ranks
+ *    can share the dump file.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_io_binary_dump(FILE* file, IBPROF_OBJECT *ibprof_obj)
+{
+	IBPROF_HASH_OBJECT *hash_obj = ibprof_obj->hash_obj;
+	IBPROF_BINARY_RECORD *records = NULL;
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	char *buffer = NULL;
+	size_t len = 0;
+	uint32_t count = 0;
+	int threads = 0;
+	int i = 0;
+
+	/* Every call has at most ibprof_thread_top thread records */
+	if (ibprof_thread_top) {
+		for (thread_obj = ibprof_obj->thread_list; thread_obj; thread_obj = thread_obj->next)
+			threads++;
+		threads = sys_min(threads, ibprof_thread_top) * ibprof_hash_count(hash_obj);
+	}
+
+	buffer = (char *)sys_malloc(sizeof(IBPROF_BINARY_HEADER) +
+			(ibprof_hash_count(hash_obj) + threads) * sizeof(IBPROF_BINARY_RECORD));
+	if (!buffer) {
+		IBPROF_ERROR("%s : error=%d - Can't allocate dump buffer\n",
+				__FUNCTION__, IBPROF_ERR_NO_MEMORY);
+		return;
+	}
+
+	records = (IBPROF_BINARY_RECORD *)(buffer + sizeof(IBPROF_BINARY_HEADER));
+	for (i = 0; i < hash_obj->size; i++) {
+		IBPROF_HASH_OBJ *entry = &hash_obj->hash_table[i];
+
+		if ((entry->key == HASH_KEY_INVALID) || (entry->count <= 0))
+			continue;
+		_ibprof_record_fill(&records[count++], ibprof_obj, entry);
+	}
+	count += _ibprof_thread_fill(&records[count], ibprof_obj, threads);
+
+	_ibprof_header_fill((IBPROF_BINARY_HEADER *)buffer, ibprof_obj, count);
+	len = sizeof(IBPROF_BINARY_HEADER) + count * sizeof(IBPROF_BINARY_RECORD);
+
+	sys_fflush(file);
+	if (_ibprof_write(fileno(file), buffer, len))
+		IBPROF_ERROR("%s : error=%d - Can't write dump\n",
+				__FUNCTION__, IBPROF_ERR_INCORRECT);
+
+	sys_free(buffer);
+}
+
+static const char *_ibprof_module_name(IBPROF_OBJECT *ibprof_obj, int module)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	int i = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if (module_obj->id == module)
+			return module_obj->name;
+	}
+
+	return "unknown";
+}
+
+static const char *_ibprof_call_name(IBPROF_OBJECT *ibprof_obj, int module, int call)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	int i = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id != module) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if (module_call->call == call)
+				return module_call->name;
+		}
+	}
+
+	return NULL;
+}
+
+static void _ibprof_header_fill(IBPROF_BINARY_HEADER *header, IBPROF_OBJECT *ibprof_obj,
+		uint32_t record_count)
+{
+	IBPROF_TASK_OBJECT *task_obj = ibprof_obj->task_obj;
+
+	sys_memset(header, 0, sizeof(*header));
+	sys_memcpy(header->magic, IBPROF_BINARY_MAGIC, sizeof(header->magic));
+	header->version = IBPROF_BINARY_VERSION;
+	header->header_size = sizeof(IBPROF_BINARY_HEADER);
+	header->record_size = sizeof(IBPROF_BINARY_RECORD);
+	header->record_count = record_count;
+	header->freq = ibprof_clock_freq;
+	header->jobid = task_obj->jobid;
+	header->rank = task_obj->procid;
+	header->pid = task_obj->pid;
+	header->tid = task_obj->tid;
+	header->snapshot = ibprof_obj->snapshot;
+	header->delta = (ibprof_obj->snapshot && ibprof_conf_get_int(IBPROF_DUMP_DELTA));
+	header->t_start = (int64_t)task_obj->t_start.tv_sec * 1000000 + task_obj->t_start.tv_usec;
+	header->wall_time = task_obj->wall_time;
+	sys_snprintf_safe(header->host, sizeof(header->host), "%s", task_obj->host);
+	sys_snprintf_safe(header->user, sizeof(header->user), "%s", task_obj->user);
+	sys_snprintf_safe(header->date, sizeof(header->date), "%s", task_obj->date);
+	sys_memcpy(header->cmdline, task_obj->cmdline,
+			sys_min(sys_strlen(task_obj->cmdline), sizeof(header->cmdline) - 1));
+}
+
+static void _ibprof_record_fill(IBPROF_BINARY_RECORD *record, IBPROF_OBJECT *ibprof_obj,
+		IBPROF_HASH_OBJ *entry)
+{
+	static const double percent[] = { 50.0, 90.0, 99.0, 99.9 };
+	const char *name = NULL;
+	int p = 0;
+
+	sys_memset(record, 0, sizeof(*record));
+	record->module = HASH_KEY_GET_MODULE(entry->key);
+	record->call = HASH_KEY_GET_CALL(entry->key);
+	record->size_class = HASH_KEY_GET_SIZE(entry->key);
+	record->flags = (record->module == IBPROF_MODULE_USER ? IBPROF_BINARY_FLAG_USER : 0);
+	if (HASH_KEY_IS_INTERVAL(entry->key)) {
+		record->size_class = 0;
+		record->flags = IBPROF_BINARY_FLAG_INTERVAL;
+		sys_snprintf_safe(record->interval, sizeof(record->interval), "%s",
+				(entry->call_name ? entry->call_name : "unknown"));
+	}
+
+	sys_snprintf_safe(record->module_name, sizeof(record->module_name), "%s",
+			_ibprof_module_name(ibprof_obj, record->module));
+	name = (record->module == IBPROF_MODULE_USER ? entry->call_name :
+			_ibprof_call_name(ibprof_obj, record->module, record->call));
+	if (name)
+		sys_snprintf_safe(record->name, sizeof(record->name), "%s", name);
+	else
+		sys_snprintf_safe(record->name, sizeof(record->name), "%d", record->call);
+
+	record->count = entry->count;
+	record->samples = entry->samples;
+	record->err = entry->mode_data.err;
+	record->bytes = entry->bytes;
+	record->t_tot = entry->t_tot;
+	record->t_self = entry->t_self;
+	record->t_min = entry->t_min;
+	record->t_max = entry->t_max;
+
+	if (ibprof_hist_size) {
+		for (p = 0; p < (int)(sizeof(percent) / sizeof(percent[0])); p++) {
+			record->t_pct[p] = ibprof_hist_percentile(entry->hist, percent[p]);
+			record->t_pct[p] = sys_max(sys_min(record->t_pct[p], entry->t_max), entry->t_min);
+		}
+	}
+}
+
+static int _ibprof_thread_fill(IBPROF_BINARY_RECORD *records, IBPROF_OBJECT *ibprof_obj,
+		int max)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	IBPROF_THREAD_CALL *entries = NULL;
+	int64_t t_sum = 0;
+	int count = 0;
+	int n = 0;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id == IBPROF_MODULE_INVALID) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			n = ibprof_thread_call_gather(ibprof_obj->thread_list, ibprof_obj->generation,
+					module_obj->id, module_call->call, &entries, &t_sum);
+			for (j = 0; (j < n) && (count < max); j++, count++) {
+				sys_memset(&records[count], 0, sizeof(records[count]));
+				records[count].module = module_obj->id;
+				records[count].call = module_call->call;
+				records[count].flags = IBPROF_BINARY_FLAG_THREAD;
+				sys_snprintf_safe(records[count].module_name, sizeof(records[count].module_name),
+						"%s", module_obj->name);
+				sys_snprintf_safe(records[count].name, sizeof(records[count].name),
+						"%s", module_call->name);
+				records[count].count = entries[j].count;
+				records[count].samples = entries[j].samples;
+				records[count].err = entries[j].err;
+				records[count].t_tot = entries[j].t_tot;
+				records[count].t_max = entries[j].t_max;
+				records[count].tid = entries[j].tid;
+				records[count].thread = entries[j].number;
+			}
+			sys_free(entries);
+		}
+	}
+
+	return count;
+}
+
+static int _ibprof_write(int fd, const void *buf, size_t len)
+{
+	const char *ptr = (const char *)buf;
+	ssize_t ret = 0;
+
+	while (len > 0) {
+		ret = write(fd, ptr, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		ptr += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
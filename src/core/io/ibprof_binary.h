@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file ibprof_binary.h
+ *
+ * @brief This file is place for binary dump format
+ *         declaration.
+ *
+ * Every dump (final one or snapshot) is written as single block:
+ *
+ *     IBPROF_BINARY_HEADER
+ *     record_count * IBPROF_BINARY_RECORD
+ *
+ * Record keeps statistics of one call for one message size class
+ * (size_class 0 is a total of the call regardless of size) or of one
+ * call made by one thread (IBPROF_BINARY_FLAG_THREAD) or of one call
+ * made inside one user interval (IBPROF_BINARY_FLAG_INTERVAL). Dumps of
+ * the same process are appended one after another, dump of several
+ * processes can share the file. Readers should use header_size and
+ * record_size to locate records, so fields can be appended to both
+ * structures without changing version.
+ *
+ * This header is shared with tools and should not depend
+ * on library internals.
+ *
+ **/
+#ifndef _IBPROF_BINARY_H_
+#define _IBPROF_BINARY_H_
+
+#include <stdint.h>
+
+#define IBPROF_BINARY_MAGIC      "IBPDUMP"
+#define IBPROF_BINARY_VERSION    1
+
+#define IBPROF_BINARY_FLAG_USER  0x1 /* user defined interval (not a library call) */
+#define IBPROF_BINARY_FLAG_THREAD  0x2 /* statistics of single thread (included in the total) */
+#define IBPROF_BINARY_FLAG_INTERVAL  0x4 /* call made inside user interval (included in the total) */
+
+/**
+ * @struct _IBPROF_BINARY_HEADER
+ * @brief Dump header (task description)
+ */
+typedef struct _IBPROF_BINARY_HEADER {
+	char magic[8]; /**< IBPROF_BINARY_MAGIC */
+	uint32_t version; /**< IBPROF_BINARY_VERSION */
+	uint32_t header_size; /**< size of IBPROF_BINARY_HEADER (offset of records) */
+	uint32_t record_size; /**< size of IBPROF_BINARY_RECORD */
+	uint32_t record_count; /**< number of records following header */
+	double freq; /**< clock ticks per second */
+	int32_t jobid; /**< job id */
+	int32_t rank; /**< process rank */
+	int32_t pid; /**< process id */
+	int32_t tid; /**< main thread id */
+	int32_t snapshot; /**< snapshot number (0 - final dump) */
+	int32_t delta; /**< snapshot covers period since previous one */
+	int64_t t_start; /**< process start (usec since epoch) */
+	double wall_time; /**< wall time covered by dump (sec) */
+	char host[64]; /**< host name */
+	char user[32]; /**< user name */
+	char date[32]; /**< start date */
+	char cmdline[256]; /**< command line */
+} IBPROF_BINARY_HEADER;
+
+/**
+ * @struct _IBPROF_BINARY_RECORD
+ * @brief Statistics of single call and message size class
+ */
+typedef struct _IBPROF_BINARY_RECORD {
+	uint16_t module; /**< module id */
+	uint16_t call; /**< call number */
+	uint16_t size_class; /**< message size class (0 - all sizes) */
+	uint16_t flags; /**< IBPROF_BINARY_FLAG_XXX */
+	char module_name[16]; /**< module name */
+	char name[48]; /**< call name */
+	int64_t count; /**< number of calls */
+	int64_t samples; /**< number of calls in t_tot (count without warmup) */
+	int64_t err; /**< number of injected errors */
+	int64_t bytes; /**< amount of transferred data */
+	int64_t t_tot; /**< total time (clock ticks) */
+	int64_t t_min; /**< minimum time (clock ticks) */
+	int64_t t_max; /**< maximum time (clock ticks) */
+	int64_t t_pct[4]; /**< p50, p90, p99, p99.9 (clock ticks, 0 if unknown) */
+	int32_t tid; /**< thread id (IBPROF_BINARY_FLAG_THREAD) */
+	int32_t thread; /**< order number of the thread (IBPROF_BINARY_FLAG_THREAD) */
+	int64_t t_self; /**< time out of nested intervals (IBPROF_BINARY_FLAG_USER, clock ticks) */
+	char interval[48]; /**< name of user interval (IBPROF_BINARY_FLAG_INTERVAL) */
+} IBPROF_BINARY_RECORD;
+
+#endif /* _IBPROF_BINARY_H_ */
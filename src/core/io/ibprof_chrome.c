@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ibprof_types.h"
+#include "ibprof_io.h"
+
+#include <fcntl.h>
+
+#define CHROME_READ_RECORDS  (16384) /* Records converted per read */
+
+/*
+ * Call names of a trace file indexed by module and call number
+ */
+typedef struct {
+	char *name[IBPROF_MODULE_USER][HASH_MAX_CALL + 1];
+} CHROME_NAMES;
+
+static int _ibprof_read(int fd, void *buf, size_t len);
+
+static int _ibprof_names_load(int fd, uint32_t count, CHROME_NAMES *names);
+
+static void _ibprof_names_free(CHROME_NAMES *names);
+
+static void _ibprof_metadata_dump(FILE* file, IBPROF_OBJECT *ibprof_obj);
+
+static void _ibprof_trace_dump(FILE* file, IBPROF_OBJECT *ibprof_obj, int fd);
+
+/**
+ * ibprof_io_chrome_dump
+ *
+ * @brief
+ *    Dumps recorded call timeline in Chrome trace event format
+ *    (JSON object format, can be loaded by chrome://tracing and Perfetto UI).
+ *    Trace file written in trace mode is converted by fixed size chunks,
+ *    so memory usage does not depend on the trace length.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_io_chrome_dump(FILE* file, IBPROF_OBJECT *ibprof_obj)
+{
+	const char *file_name = ibprof_conf_get_string(IBPROF_TRACE_FILE);
+	int fd = -1;
+
+	sys_fprintf(file, "{\"traceEvents\":[\n");
+
+	_ibprof_metadata_dump(file, ibprof_obj);
+
+	fd = (file_name ? open(file_name, O_RDONLY) : -1);
+	if (fd >= 0) {
+		_ibprof_trace_dump(file, ibprof_obj, fd);
+		close(fd);
+	} else {
+		IBPROF_WARN("%s : trace file '%s' is not available, "
+				"set IBPROF_MODE to trace mode (4) to record calls\n",
+				__FUNCTION__, (file_name ? file_name : ""));
+	}
+
+	sys_fprintf(file, "\n],\n\"displayTimeUnit\":\"ns\",\n"
+			"\"otherData\":{\"version\":\"" __MODULE_NAME " %s\",\"clock\":\"%s\"}}\n",
+			STR(__MODULE_VERSION), ibprof_clock_name());
+
+	return;
+}
+
+static int _ibprof_read(int fd, void *buf, size_t len)
+{
+	char *ptr = (char *)buf;
+	ssize_t ret = 0;
+	size_t done = 0;
+
+	while (done < len) {
+		ret = read(fd, ptr + done, len - done);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			break;
+		done += ret;
+	}
+
+	return (int)done;
+}
+
+static int _ibprof_names_load(int fd, uint32_t count, CHROME_NAMES *names)
+{
+	uint32_t entry[3];
+	char *name = NULL;
+
+	while (count--) {
+		if (_ibprof_read(fd, entry, sizeof(entry)) != sizeof(entry))
+			return -1;
+
+		name = (char *)sys_malloc(entry[2] + 1);
+		if (!name || (_ibprof_read(fd, name, entry[2]) != (int)entry[2])) {
+			sys_free(name);
+			return -1;
+		}
+
+		if ((entry[0] < IBPROF_MODULE_USER) && (entry[1] <= HASH_MAX_CALL)) {
+			sys_free(names->name[entry[0]][entry[1]]);
+			names->name[entry[0]][entry[1]] = name;
+		} else
+			sys_free(name);
+	}
+
+	return 0;
+}
+
+static void _ibprof_names_free(CHROME_NAMES *names)
+{
+	int module = 0;
+	int call = 0;
+
+	for (module = 0; module < IBPROF_MODULE_USER; module++) {
+		for (call = 0; call <= HASH_MAX_CALL; call++)
+			sys_free(names->name[module][call]);
+	}
+	sys_free(names);
+}
+
+static void _ibprof_metadata_dump(FILE* file, IBPROF_OBJECT *ibprof_obj)
+{
+	IBPROF_THREAD_OBJECT *thread_obj = NULL;
+	IBPROF_TASK_OBJECT *task_obj = ibprof_obj->task_obj;
+
+	/* One process track per rank and one thread track per thread */
+	sys_fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+			"\"args\":{\"name\":\"%s %d (%s)\"}}",
+			task_obj->procid, sys_procname(), task_obj->procid, task_obj->host);
+	sys_fprintf(file, ",\n{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":%d,"
+			"\"args\":{\"sort_index\":%d}}",
+			task_obj->procid, task_obj->procid);
+
+	for (thread_obj = ibprof_obj->thread_list; thread_obj; thread_obj = thread_obj->next) {
+		if (thread_obj->number == IBPROF_THREAD_RETIRED)
+			continue;
+		sys_fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}",
+				task_obj->procid, thread_obj->tid,
+				(thread_obj->tid == task_obj->tid ? "main" : "thread"));
+	}
+}
+
+static void _ibprof_trace_dump(FILE* file, IBPROF_OBJECT *ibprof_obj, int fd)
+{
+	IBPROF_TRACE_HEADER header;
+	IBPROF_TRACE_RECORD *records = NULL;
+	CHROME_NAMES *names = NULL;
+	const char *module_name[IBPROF_MODULE_USER];
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const char *call_name = NULL;
+	double usec = 0;
+	int count = 0;
+	int i = 0;
+
+	if ((_ibprof_read(fd, &header, sizeof(header)) != sizeof(header)) ||
+		sys_memcmp(header.magic, IBPROF_TRACE_MAGIC, sizeof(header.magic)) ||
+		(header.version != IBPROF_TRACE_VERSION) ||
+		(header.record_size != sizeof(IBPROF_TRACE_RECORD))) {
+		IBPROF_WARN("%s : trace file has unsupported format\n", __FUNCTION__);
+		return;
+	}
+
+	names = (CHROME_NAMES *)sys_malloc(sizeof(CHROME_NAMES));
+	records = (IBPROF_TRACE_RECORD *)sys_malloc(CHROME_READ_RECORDS * sizeof(IBPROF_TRACE_RECORD));
+	if (!names || !records || _ibprof_names_load(fd, header.name_count, names)) {
+		IBPROF_WARN("%s : can't load trace file\n", __FUNCTION__);
+		goto out;
+	}
+
+	for (i = 0; i < IBPROF_MODULE_USER; i++)
+		module_name[i] = "unknown";
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id >= 0) && (module_obj->id < IBPROF_MODULE_USER))
+			module_name[module_obj->id] = module_obj->name;
+	}
+
+	usec = 1.0e+6 / header.freq;
+
+	/* Partial record at the end of file (being written) is ignored */
+	while ((count = _ibprof_read(fd, records, CHROME_READ_RECORDS * sizeof(IBPROF_TRACE_RECORD))) > 0) {
+		count /= sizeof(IBPROF_TRACE_RECORD);
+		for (i = 0; i < count; i++) {
+			IBPROF_TRACE_RECORD *record = &records[i];
+
+			if ((record->module >= IBPROF_MODULE_USER) || (record->call > HASH_MAX_CALL))
+				continue;
+
+			call_name = names->name[record->module][record->call];
+			sys_fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+					"\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u",
+					(call_name ? call_name : "unknown"),
+					module_name[record->module],
+					record->t_start * usec, record->t_dur * usec,
+					header.rank, record->tid);
+			if ((record->size >= 0) || record->handle)
+				sys_fprintf(file, ",\"args\":{\"size\":%ld,\"handle\":\"0x%lx\"}}",
+						(long)record->size, (unsigned long)record->handle);
+			else
+				sys_fprintf(file, "}");
+		}
+	}
+
+out:
+	sys_free(records);
+	if (names)
+		_ibprof_names_free(names);
+}
@@ -11,6 +11,10 @@
 #ifndef _IBPROF_IO_H_
 #define _IBPROF_IO_H_
 
+typedef void (*ibprof_format_dump)(FILE*, IBPROF_OBJECT*);
+
+extern ibprof_format_dump format_dump;
+
 /**
  * ibprof_plain_dump
  *
@@ -21,6 +25,16 @@
  ***************************************************************************/
 void ibprof_io_plain_dump(FILE* file, IBPROF_OBJECT *ibprof_obj);
 
+/**
+ * ibprof_io_plain_node_dump
+ *
+ * @brief
+ *    Dumps statistics merged across ranks of the node in plain.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_io_plain_node_dump(FILE* file, IBPROF_OBJECT *ibprof_obj, IBPROF_NODE_REPORT *report);
+
 /**
  * ibprof_xml_dump
  *
@@ -31,4 +45,24 @@ void ibprof_io_plain_dump(FILE* file, IBPROF_OBJECT *ibprof_obj);
  ***************************************************************************/
 void ibprof_io_xml_dump(FILE* file, IBPROF_OBJECT *task_obj);
 
+/**
+ * ibprof_io_chrome_dump
+ *
+ * @brief
+ *    Dumps recorded call timeline in Chrome trace event format.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_io_chrome_dump(FILE* file, IBPROF_OBJECT *ibprof_obj);
+
+/**
+ * ibprof_io_binary_dump
+ *
+ * @brief
+ *    Dumps all gathered information in versioned binary format.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_io_binary_dump(FILE* file, IBPROF_OBJECT *ibprof_obj);
+
 #endif /* _IBPROF_IO_H_ */
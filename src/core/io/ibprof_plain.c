@@ -27,6 +27,16 @@ static void _ibprof_banner_dump(FILE* file, IBPROF_OBJECT *ibprof_obj);
 
 static void _ibprof_module_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_HASH_OBJECT* hash_obj, int proc_id);
 
+static void _ibprof_size_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_HASH_OBJECT* hash_obj, int proc_id);
+
+static void _ibprof_resource_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj);
+
+static void _ibprof_thread_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj);
+
+static void _ibprof_counter_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj);
+
+static void _ibprof_interval_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj);
+
 static int _ibprof_io_plain_prefix(void *stream, const char* format, ...);
 
 /**
@@ -71,6 +81,16 @@ void ibprof_io_plain_dump(FILE* file, IBPROF_OBJECT *ibprof_obj)
 			plain_output(file, "%-30.30s :    %20.4f %\n", "wall time (%)", total_time
 				/ (ibprof_obj->task_obj->wall_time * 1.0e+6));
 			plain_output(file, DELIMITER);
+
+			_ibprof_size_dump(file, temp_module_obj, ibprof_obj->hash_obj, ibprof_obj->task_obj->procid);
+
+			_ibprof_thread_dump(file, temp_module_obj, ibprof_obj);
+
+			_ibprof_counter_dump(file, temp_module_obj, ibprof_obj);
+
+			_ibprof_resource_dump(file, temp_module_obj, ibprof_obj);
+
+			_ibprof_interval_dump(file, temp_module_obj, ibprof_obj);
 		}
 
 		temp_module_obj = ibprof_obj->module_array[++i];
@@ -94,6 +114,29 @@ static void _ibprof_banner_dump(FILE* file, IBPROF_OBJECT *ibprof_obj)
 	_ibprof_task_dump(ibprof_obj->task_obj);
 	plain_output(file,"warmup number : %d\n", ibprof_conf_get_int(IBPROF_WARMUP_NUMBER));
 	plain_output(file,"Output time unit : %s\n", ibprof_time_units_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)]);
+	plain_output(file,"Clock source : %s (%.3f MHz)\n", ibprof_clock_name(), ibprof_clock_freq * 1.0e-6);
+	if (ibprof_clock_call_cost > 0) {
+		plain_output(file,"Clock read cost (ns) : tsc %.1f, monotonic %.1f, monotonic_raw %.1f, gettimeofday %.1f\n",
+			ibprof_clock_read_cost[IBPROF_CLOCK_TSC], ibprof_clock_read_cost[IBPROF_CLOCK_MONOTONIC],
+			ibprof_clock_read_cost[IBPROF_CLOCK_MONOTONIC_RAW], ibprof_clock_read_cost[IBPROF_CLOCK_GETTIMEOFDAY]);
+		plain_output(file,"Profiling overhead : %.1f ns per call, %.1f ns in measured time (%s)\n",
+			ibprof_clock_call_cost, ibprof_clock_to_sec(ibprof_clock_window) * 1.0e+9,
+			(ibprof_conf_get_int(IBPROF_OVERHEAD_SUBTRACT) ? "subtracted" : "not subtracted"));
+	} else
+		plain_output(file,"Profiling overhead : not measured (no module is profiled)\n");
+	plain_output(file,"Histogram bits : %d\n", ibprof_hist_bits);
+	if (ibprof_sample_active)
+		plain_output(file,"Sampled calls : %s (totals are scaled)\n",
+			ibprof_conf_get_string(IBPROF_SAMPLE));
+	if (ibprof_conf_get_string(IBPROF_ERR_POLICY))
+		plain_output(file,"Error policy : %s (seed %d)\n",
+			ibprof_conf_get_string(IBPROF_ERR_POLICY), ibprof_conf_get_int(IBPROF_ERR_SEED));
+	if (ibprof_conf_get_string(IBPROF_DELAY))
+		plain_output(file,"Injected delay : %s\n", ibprof_conf_get_string(IBPROF_DELAY));
+	if (ibprof_obj->snapshot)
+		plain_output(file,"Snapshot : %d (%s) at %.2f sec\n", ibprof_obj->snapshot,
+			(ibprof_conf_get_int(IBPROF_DUMP_DELTA) ? "delta" : "cumulative"),
+			ibprof_task_wall_time(ibprof_obj->task_obj->t_start));
 	plain_output(file, DELIMITER);
 
 	return;
@@ -138,18 +181,32 @@ static const char *_ibprof_hash_format_plain(int module, const char* call_name,
 			dest_len += ret;
 	}
 
-	switch (ibprof_conf_get_mode(module)) {
+	switch (module == IBPROF_MODULE_USER ? IBPROF_MODE_NONE : ibprof_conf_get_mode(module)) {
+	case IBPROF_MODE_NONE:
+		/* User intervals report self time */
+		ret = sys_vsnprintf((dest + dest_len),
+			sizeof(buffer) - dest_len,
+			(ibprof_hist_size ?
+			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f" :
+			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f"),
+			stats);
+		break;
+
 	case IBPROF_MODE_ERR:
 		ret = sys_vsnprintf((dest + dest_len),
 			sizeof(buffer) - dest_len,
-			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10ld",
+			(ibprof_hist_size ?
+			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10ld   %10.4f   %10.4f   %10.4f   %10.4f" :
+			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10ld"),
 			stats);
 		break;
 
 	default:
 		ret = sys_vsnprintf((dest + dest_len),
 			sizeof(buffer) - dest_len,
-			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f",
+			(ibprof_hist_size ?
+			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f   %10.4f" :
+			"%10ld   %10.4f   %10.4f   %10.4f   %10.4f"),
 			stats);
 		break;
 	}
@@ -164,22 +221,41 @@ static void _ibprof_module_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IB
 	const IBPROF_MODULE_CALL *temp_module_call = NULL;
 	char *str = NULL;
 	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	char percentiles[100];
+
+	percentiles[0] = '\0';
+	if (ibprof_hist_size) {
+		sys_snprintf_safe(percentiles, sizeof(percentiles),
+			"   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)",
+			"p50", time_unit, "p90", time_unit,
+			"p99", time_unit, "p99.9", time_unit);
+	}
 
 	plain_output(file, "\n");
-	switch (ibprof_conf_get_mode(module_obj->id)) {
+	switch (module_obj->id == IBPROF_MODULE_USER ? IBPROF_MODE_NONE : ibprof_conf_get_mode(module_obj->id)) {
+	case IBPROF_MODE_NONE:
+		plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)%s\n",
+			(module_obj->name ? module_obj->name : "unknown"), "count",
+						"total", time_unit, "self", time_unit,
+						"avg", time_unit, "max", time_unit, "min", time_unit,
+						percentiles);
+		break;
+
 	case IBPROF_MODE_ERR:
-		plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)   %10s\n",
+		plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)   %10s%s\n",
 			(module_obj->name ? module_obj->name : "unknown"), "count",
 						"total", time_unit, "avg", time_unit,
-						"max", time_unit, "min", time_unit, "fail");
+						"max", time_unit, "min", time_unit, "fail",
+						percentiles);
 		break;
 
 	default:
 
-		plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)\n",
+		plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)%s\n",
 			(module_obj->name ? module_obj->name : "unknown"), "count",
 						"total", time_unit, "avg", time_unit,
-						"max", time_unit, "min", time_unit);
+						"max", time_unit, "min", time_unit,
+						percentiles);
 		break;
 	}
 	plain_output(file, DELIMITER);
@@ -217,6 +293,343 @@ static void _ibprof_module_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IB
 	return;
 }
 
+static const char *_ibprof_hash_format_size_plain(int module, const char* call_name, const char* stats_fmt, ...)
+{
+	static char buffer[1024];
+	char *dest = buffer;
+	int dest_len = 0;
+	va_list stats;
+	int ret = 0;
+
+	va_start(stats, stats_fmt);
+
+	buffer[0] = '\0';
+
+	ret = sys_snprintf_safe((dest + dest_len),
+		sizeof(buffer) - dest_len,
+		"  %-28.28s : ",
+		(call_name ? call_name : ""));
+	if (ret >= 0)
+		dest_len += ret;
+
+	ret = sys_vsnprintf((dest + dest_len),
+		sizeof(buffer) - dest_len,
+		"%10ld   %10.4f   %10.4f   %10.4f   %10.4f   %10.2f",
+		stats);
+
+	va_end(stats);
+
+	return (ret > 0 ? buffer: NULL);
+}
+
+static void _ibprof_size_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_HASH_OBJECT* hash_obj, int proc_id)
+{
+	const IBPROF_MODULE_CALL *temp_module_call = NULL;
+	char *str = NULL;
+	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	int header = 0;
+
+	if (!module_obj->tbl_call)
+		return;
+
+	temp_module_call = module_obj->tbl_call;
+
+	while (temp_module_call	&& (temp_module_call->call	!= UNDEFINED_VALUE &&
+		temp_module_call->name)) {
+
+		str = ibprof_hash_dump_size(hash_obj, module_obj->id,
+			temp_module_call->call, proc_id,
+			_ibprof_hash_format_size_plain);
+
+		if (str && str[0]) {
+			if (!header) {
+				plain_output(file, "\n");
+				plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)   %10s\n",
+					"message size (bytes)", "count",
+					"total", time_unit, "avg", time_unit,
+					"max", time_unit, "min", time_unit, "MB/s");
+				plain_output(file, DELIMITER);
+				header = 1;
+			}
+			plain_output(file, "%-30.30s :\n",
+				(temp_module_call->name ? temp_module_call->name : "unknown"));
+			plain_output(file, "%s", str);
+		}
+
+		sys_free(str);
+		temp_module_call++;
+	}
+
+	if (header)
+		plain_output(file, DELIMITER);
+
+	return;
+}
+
+static void _ibprof_resource_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj)
+{
+	const IBPROF_MODULE_CALL *temp_module_call = NULL;
+	IBPROF_RESOURCE_OBJ *entries = NULL;
+	const char *format = NULL;
+	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double units = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	char name[64];
+	int header = 0;
+	int count = 0;
+	int i = 0;
+
+	if (!ibprof_resource_size || !module_obj->tbl_call)
+		return;
+
+	temp_module_call = module_obj->tbl_call;
+
+	while (temp_module_call	&& (temp_module_call->call	!= UNDEFINED_VALUE &&
+		temp_module_call->name)) {
+
+		count = ibprof_resource_gather(ibprof_obj->thread_list, ibprof_obj->generation,
+				module_obj->id, temp_module_call->call, &entries, &format);
+
+		if (count) {
+			if (!header) {
+				plain_output(file, "\n");
+				plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %6s(%2s)\n",
+					"resource (top by time)", "count",
+					"total", time_unit, "avg", time_unit,
+					"max", time_unit, "error", time_unit);
+				plain_output(file, DELIMITER);
+				header = 1;
+			}
+			plain_output(file, "%-30.30s :\n",
+				(temp_module_call->name ? temp_module_call->name : "unknown"));
+			for (i = 0; i < count; i++) {
+				sys_snprintf_safe(name, sizeof(name), format, (unsigned long)entries[i].key);
+				plain_output(file, "  %-28.28s : %10ld   %10.4f   %10.4f   %10.4f   %10.4f\n",
+					name, (long)entries[i].count,
+					ibprof_clock_to_sec(entries[i].t_tot) * units,
+					(entries[i].count ?
+						ibprof_clock_to_sec(entries[i].t_tot) * units / entries[i].count : 0),
+					ibprof_clock_to_sec(entries[i].t_max) * units,
+					ibprof_clock_to_sec(entries[i].t_err) * units);
+			}
+		}
+
+		sys_free(entries);
+		temp_module_call++;
+	}
+
+	if (header)
+		plain_output(file, DELIMITER);
+
+	return;
+}
+
+static void _ibprof_thread_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj)
+{
+	const IBPROF_MODULE_CALL *temp_module_call = NULL;
+	IBPROF_THREAD_CALL *entries = NULL;
+	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double units = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	int64_t t_sum = 0;
+	char name[64];
+	int header = 0;
+	int count = 0;
+	int i = 0;
+
+	if (!ibprof_thread_top || !module_obj->tbl_call)
+		return;
+
+	temp_module_call = module_obj->tbl_call;
+
+	while (temp_module_call	&& (temp_module_call->call	!= UNDEFINED_VALUE &&
+		temp_module_call->name)) {
+
+		count = ibprof_thread_call_gather(ibprof_obj->thread_list, ibprof_obj->generation,
+				module_obj->id, temp_module_call->call, &entries, &t_sum);
+
+		if (count) {
+			if (!header) {
+				plain_output(file, "\n");
+				plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %10s\n",
+					"thread (top by time)", "count",
+					"total", time_unit, "avg", time_unit,
+					"max", time_unit, "% of call");
+				plain_output(file, DELIMITER);
+				header = 1;
+			}
+			plain_output(file, "%-30.30s :\n",
+				(temp_module_call->name ? temp_module_call->name : "unknown"));
+			for (i = 0; i < count; i++) {
+				if (entries[i].number == IBPROF_THREAD_RETIRED)
+					sys_snprintf_safe(name, sizeof(name), "exited threads");
+				else
+					sys_snprintf_safe(name, sizeof(name), "tid %d (#%d)",
+						entries[i].tid, entries[i].number);
+				plain_output(file, "  %-28.28s : %10ld   %10.4f   %10.4f   %10.4f   %10.2f\n",
+					name, (long)entries[i].count,
+					ibprof_clock_to_sec(entries[i].t_tot) * units,
+					(entries[i].samples ?
+						ibprof_clock_to_sec(entries[i].t_tot) * units / entries[i].samples : 0),
+					ibprof_clock_to_sec(entries[i].t_max) * units,
+					(t_sum ? entries[i].t_tot * 100.0 / t_sum : 0));
+			}
+		}
+
+		sys_free(entries);
+		temp_module_call++;
+	}
+
+	if (header)
+		plain_output(file, DELIMITER);
+
+	return;
+}
+
+static void _ibprof_counter_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj)
+{
+	const IBPROF_MODULE_CALL *temp_module_call = NULL;
+	const IBPROF_COUNTER_DESC *desc = NULL;
+	int64_t value[COUNTER_MAX_SIZE];
+	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double units = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double base = 0;
+	int header = 0;
+	int i = 0;
+
+	if (!ibprof_counter_active || !module_obj->tbl_call)
+		return;
+
+	temp_module_call = module_obj->tbl_call;
+
+	while (temp_module_call	&& (temp_module_call->call	!= UNDEFINED_VALUE &&
+		temp_module_call->name)) {
+
+		if (ibprof_counter_gather(ibprof_obj->thread_list, ibprof_obj->generation,
+				module_obj->id, temp_module_call->call, value, &desc)) {
+			if (!header) {
+				plain_output(file, "\n");
+				plain_output(file, "%-30.30s : %10s   %10s\n",
+					"counters", "value", "ratio");
+				plain_output(file, DELIMITER);
+				header = 1;
+			}
+			plain_output(file, "%-30.30s :\n",
+				(temp_module_call->name ? temp_module_call->name : "unknown"));
+			for (i = 0; (i < COUNTER_MAX_SIZE) && desc[i].name; i++) {
+				base = (double)value[desc[i].base];
+				switch (desc[i].kind) {
+				case IBPROF_COUNTER_PERCENT:
+					plain_output(file, "  %-28.28s : %10ld   %10.2f %% of %s\n",
+						desc[i].name, (long)value[i],
+						(base ? value[i] * 100.0 / base : 0), desc[desc[i].base].name);
+					break;
+				case IBPROF_COUNTER_AVERAGE:
+				case IBPROF_COUNTER_BYTES:
+					plain_output(file, "  %-28.28s : %10ld   %10.2f / %s\n",
+						desc[i].name, (long)value[i],
+						(base ? value[i] / base : 0), desc[desc[i].base].name);
+					break;
+				case IBPROF_COUNTER_TIME:
+					if (desc[desc[i].base].kind == IBPROF_COUNTER_BYTES)
+						base /= (1 << 20);
+					plain_output(file, "  %-28.28s : %10.4f   %10.4f %s / %s\n",
+						desc[i].name, ibprof_clock_to_sec(value[i]) * units,
+						(base ? ibprof_clock_to_sec(value[i]) * units / base : 0), time_unit,
+						(desc[desc[i].base].kind == IBPROF_COUNTER_BYTES ?
+							"MB" : desc[desc[i].base].name));
+					break;
+				default:
+					plain_output(file, "  %-28.28s : %10ld\n",
+						desc[i].name, (long)value[i]);
+					break;
+				}
+			}
+		}
+
+		temp_module_call++;
+	}
+
+	if (header)
+		plain_output(file, DELIMITER);
+
+	return;
+}
+
+static const char *_ibprof_call_name(IBPROF_OBJECT *ibprof_obj, int module, int call)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	int i = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id != module) || !module_obj->tbl_call)
+			continue;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if (module_call->call == call)
+				return module_call->name;
+		}
+	}
+
+	return "unknown";
+}
+
+static void _ibprof_interval_dump(FILE* file, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj)
+{
+	IBPROF_HASH_OBJECT *hash_obj = ibprof_obj->hash_obj;
+	IBPROF_HASH_OBJ *interval = NULL;
+	IBPROF_HASH_OBJ **entries = NULL;
+	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double units = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	int header = 0;
+	int count = 0;
+	int i = 0;
+	int j = 0;
+
+	if (!ibprof_interval_calls || (module_obj->id != IBPROF_MODULE_USER))
+		return;
+
+	for (i = 0; i < hash_obj->size; i++) {
+		interval = &hash_obj->hash_table[i];
+		if ((interval->key == HASH_KEY_INVALID) ||
+			(HASH_KEY_GET_MODULE(interval->key) != IBPROF_MODULE_USER) ||
+			(HASH_KEY_GET_RANK(interval->key) != ibprof_obj->task_obj->procid))
+			continue;
+
+		count = ibprof_interval_call_gather(hash_obj, interval->key, &entries);
+		if (count) {
+			if (!header) {
+				plain_output(file, "\n");
+				plain_output(file, "%-30.30s : %10s   %6s(%2s)   %6s(%2s)   %6s(%2s)   %10s\n",
+					"interval calls (top by time)", "count",
+					"total", time_unit, "avg", time_unit,
+					"max", time_unit, "% of self");
+				plain_output(file, DELIMITER);
+				header = 1;
+			}
+			plain_output(file, "%-30.30s :\n",
+				(interval->call_name ? interval->call_name : "unknown"));
+			for (j = 0; j < count; j++) {
+				plain_output(file, "  %-28.28s : %10ld   %10.4f   %10.4f   %10.4f   %10.2f\n",
+					_ibprof_call_name(ibprof_obj, HASH_KEY_GET_MODULE(entries[j]->key),
+						HASH_KEY_GET_CALL(entries[j]->key)),
+					(long)entries[j]->count,
+					ibprof_clock_to_sec(entries[j]->t_tot) * units,
+					(entries[j]->samples ?
+						ibprof_clock_to_sec(entries[j]->t_tot) * units / entries[j]->samples : 0),
+					ibprof_clock_to_sec(entries[j]->t_max) * units,
+					(interval->t_self ? entries[j]->t_tot * 100.0 / interval->t_self : 0));
+			}
+		}
+
+		sys_free(entries);
+	}
+
+	if (header)
+		plain_output(file, DELIMITER);
+
+	return;
+}
+
 static int _ibprof_io_plain_prefix(void *stream, const char* format, ...)
 {
 	char *buffer, *ptr;
@@ -254,3 +667,99 @@ static int _ibprof_io_plain_prefix(void *stream, const char* format, ...)
 
 	return 0;
 }
+
+/**
+ * ibprof_io_plain_node_dump
+ *
+ * @brief
+ *    Dumps statistics merged across ranks of the node in plain.
+ *
+ * @return @a none
+ ***************************************************************************/
+void ibprof_io_plain_node_dump(FILE* file, IBPROF_OBJECT *ibprof_obj, IBPROF_NODE_REPORT *report)
+{
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	IBPROF_NODE_CALL *call = NULL;
+	const char *time_unit = ibprof_time_units_short_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double mult = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	double wall_min = 0, wall_max = 0, wall_avg = 0;
+	int module = IBPROF_MODULE_INVALID;
+	int outliers = 0;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < report->rank_count; i++) {
+		wall_min = (i ? sys_min(wall_min, report->ranks[i].wall_time) : report->ranks[i].wall_time);
+		wall_max = sys_max(wall_max, report->ranks[i].wall_time);
+		wall_avg += report->ranks[i].wall_time / report->rank_count;
+	}
+
+	plain_output(file, "\n");
+	plain_output(file, DELIMITER);
+	plain_output(file, __MODULE_NAME ", version %s (node summary)\n",
+		STR(__MODULE_VERSION));
+	plain_output(file, "   compiled %s, %s\n\n",
+		__DATE__,
+		__TIME__);
+	plain_output(file, "%s\n\n", __MODULE_COPYRIGHT);
+	plain_output(file, "date : %s\n", ibprof_obj->task_obj->date);
+	plain_output(file, "host : %s\n", report->host);
+	plain_output(file, "user : %s\n", ibprof_obj->task_obj->user);
+	plain_output(file, "jobid : %d\n", ibprof_obj->task_obj->jobid);
+	if (report->rank_lost)
+		plain_output(file, "ranks : %d (%d exited without statistics)\n",
+				report->rank_count, report->rank_lost);
+	else
+		plain_output(file, "ranks : %d\n", report->rank_count);
+	plain_output(file, "command line : %s\n", ibprof_obj->task_obj->cmdline);
+	plain_output(file, "wall time (sec) : min %.2f avg %.2f max %.2f\n", wall_min, wall_avg, wall_max);
+	plain_output(file,"Output time unit : %s\n", ibprof_time_units_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)]);
+	plain_output(file, DELIMITER);
+
+	for (i = 0; i < report->call_count; i++) {
+		call = &report->calls[i];
+		if (call->module != module) {
+			module = call->module;
+			for (j = 0; (module_obj = ibprof_obj->module_array[j]); j++) {
+				if (module_obj->id == module)
+					break;
+			}
+			if (i)
+				plain_output(file, DELIMITER);
+			plain_output(file, "\n");
+			plain_output(file, "%-30.30s : %5s %12s   %6s(%2s) %6s   %6s(%2s)   %6s(%2s) %6s   %8s\n",
+				(module_obj && module_obj->name ? module_obj->name : "unknown"),
+				"ranks", "count",
+				"min", time_unit, "rank",
+				"avg", time_unit,
+				"max", time_unit, "rank",
+				"max/avg");
+			plain_output(file, DELIMITER);
+		}
+		plain_output(file, "%-30.30s : %5d %12ld %12.4f %6d %12.4f %12.4f %6d %10.2f\n",
+			call->name, call->ranks, (long)call->count,
+			call->t_min * mult, call->min_rank,
+			call->t_tot / call->ranks * mult,
+			call->t_max * mult, call->max_rank,
+			(call->t_tot > 0 ? call->t_max / (call->t_tot / call->ranks) : 0));
+	}
+	plain_output(file, DELIMITER);
+
+	plain_output(file, "outlier ranks (time in calls above mean + 2 sigma, mean %.4f %s, sigma %.4f %s)\n",
+		report->t_mean * mult, time_unit, report->t_sigma * mult, time_unit);
+	for (i = 0; i < report->rank_count; i++) {
+		if ((report->t_sigma > 0) &&
+			(report->ranks[i].t_tot > report->t_mean + 2 * report->t_sigma)) {
+			plain_output(file, "rank %6d (pid %d) : %.4f %s (%+.1f%%)\n",
+				report->ranks[i].rank, report->ranks[i].pid,
+				report->ranks[i].t_tot * mult, time_unit,
+				(report->ranks[i].t_tot / report->t_mean - 1.0) * 100.0);
+			outliers++;
+		}
+	}
+	if (!outliers)
+		plain_output(file, "none\n");
+	plain_output(file, DELIMITER);
+
+	return;
+}
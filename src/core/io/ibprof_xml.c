@@ -17,7 +17,11 @@ static int _ibprof_banner_dump(char **root, IBPROF_OBJECT *task_obj);
 
 static int _ibprof_task_dump(char **root, IBPROF_TASK_OBJECT *task_obj);
 
-static int _ibprof_module_dump(char **root, IBPROF_MODULE_OBJECT *module_obj, IBPROF_HASH_OBJECT* hash_obj, IBPROF_TASK_OBJECT* task_obj);
+static int _ibprof_module_dump(char **root, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj);
+
+static char *_ibprof_thread_dump(IBPROF_OBJECT *ibprof_obj, int module, int call);
+
+static char *_ibprof_interval_dump(IBPROF_OBJECT *ibprof_obj, int rank);
 
 /**
  * ibprof_xml_dump
@@ -49,8 +53,7 @@ void ibprof_io_xml_dump(FILE* file, IBPROF_OBJECT *ibprof_obj)
 				continue;
 			}
 
-			ret = _ibprof_module_dump(&module, temp_module_obj,
-				ibprof_obj->hash_obj, ibprof_obj->task_obj);
+			ret = _ibprof_module_dump(&module, temp_module_obj, ibprof_obj);
 
 			if (ret > 0) {
 				ret = sys_asprintf(&modules,
@@ -97,7 +100,14 @@ static int _ibprof_banner_dump(char **root, IBPROF_OBJECT *ibprof_obj)
 					XML("copyright", "%s") \
 					XML("task", "%s") \
 					XML("warmup_number", "%d") \
-					XML("Output time unit", "%s")
+					XML("Output time unit", "%s") \
+					XML("clock_source", "%s") \
+					XML("call_overhead_ns", "%.1f") \
+					XML("measured_overhead_ns", "%.1f") \
+					XML("overhead_subtracted", "%d") \
+					XML("histogram_bits", "%d") \
+					XML("snapshot", "%d") \
+					XML("snapshot_type", "%s")
 				)
 			),
 			__MODULE_NAME,
@@ -107,7 +117,15 @@ static int _ibprof_banner_dump(char **root, IBPROF_OBJECT *ibprof_obj)
 			__MODULE_COPYRIGHT,
 			task_dump,
 			ibprof_conf_get_int(IBPROF_WARMUP_NUMBER),
-			ibprof_time_units_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)]);
+			ibprof_time_units_str[ibprof_conf_get_int(IBPROF_TIME_UNITS)],
+			ibprof_clock_name(),
+			ibprof_clock_call_cost,
+			ibprof_clock_to_sec(ibprof_clock_window) * 1.0e+9,
+			(ibprof_conf_get_int(IBPROF_OVERHEAD_SUBTRACT) != 0),
+			ibprof_hist_bits,
+			ibprof_obj->snapshot,
+			(!ibprof_obj->snapshot ? "final" :
+				(ibprof_conf_get_int(IBPROF_DUMP_DELTA) ? "delta" : "cumulative")));
 	}
 
 	sys_free(task_dump);
@@ -160,15 +178,49 @@ static const char *_ibprof_hash_format_xml(int module, const char* call_name, co
 
 	buffer[0] = '\0';
 
-	ret = sys_vsnprintf(stat_buffer,
-		sizeof(buffer),
+#define XML_STATS \
 		XML("count", "%ld") \
 		XML("total", "%.4f") \
 		XML("avg", "%.4f") \
 		XML("max", "%.4f") \
-		XML("min", "%.4f") \
-		XML("fail", "%ld"),
-		stats);
+		XML("min", "%.4f")
+#define XML_PERCENTILES \
+		XML("p50", "%.4f") \
+		XML("p90", "%.4f") \
+		XML("p99", "%.4f") \
+		XML("p99.9", "%.4f")
+
+	switch (module == IBPROF_MODULE_USER ? IBPROF_MODE_NONE : ibprof_conf_get_mode(module)) {
+	case IBPROF_MODE_NONE:
+		/* User intervals report self time */
+		ret = sys_vsnprintf(stat_buffer,
+			sizeof(stat_buffer),
+			(ibprof_hist_size ?
+			XML("count", "%ld") XML("total", "%.4f") XML("self", "%.4f")
+			XML("avg", "%.4f") XML("max", "%.4f") XML("min", "%.4f") XML_PERCENTILES :
+			XML("count", "%ld") XML("total", "%.4f") XML("self", "%.4f")
+			XML("avg", "%.4f") XML("max", "%.4f") XML("min", "%.4f")),
+			stats);
+		break;
+
+	case IBPROF_MODE_ERR:
+		ret = sys_vsnprintf(stat_buffer,
+			sizeof(stat_buffer),
+			(ibprof_hist_size ?
+			XML_STATS XML("fail", "%ld") XML_PERCENTILES :
+			XML_STATS XML("fail", "%ld")),
+			stats);
+		break;
+
+	default:
+		ret = sys_vsnprintf(stat_buffer,
+			sizeof(stat_buffer),
+			(ibprof_hist_size ?
+			XML_STATS XML_PERCENTILES :
+			XML_STATS),
+			stats);
+		break;
+	}
 	if (ret >= 0)
 		dest_len += ret;
 
@@ -189,16 +241,192 @@ static const char *_ibprof_hash_format_xml(int module, const char* call_name, co
 	return (ret > 0 ? dest : NULL);
 }
 
-static int _ibprof_module_dump(char **module, IBPROF_MODULE_OBJECT *module_obj, IBPROF_HASH_OBJECT* hash_obj, IBPROF_TASK_OBJECT *task_obj)
+static const char *_ibprof_hash_format_size_xml(int module, const char* call_name, const char* stats_fmt, ...)
+{
+	static char buffer[1024];
+	static char stat_buffer[1024];
+	va_list stats;
+	int ret = 0;
+
+	va_start(stats, stats_fmt);
+
+	buffer[0] = '\0';
+
+	ret = sys_vsnprintf(stat_buffer,
+		sizeof(stat_buffer),
+		XML_STATS XML("bandwidth", "%.2f"),
+		stats);
+	if (ret >= 0) {
+		ret = sys_snprintf_safe(buffer,
+			sizeof(buffer),
+			XML("size",
+				XML("range", "%s") \
+				"%s"),
+			(call_name ? call_name : ""),
+			stat_buffer);
+	}
+
+	va_end(stats);
+
+	return (ret > 0 ? buffer : NULL);
+}
+
+static char *_ibprof_thread_dump(IBPROF_OBJECT *ibprof_obj, int module, int call)
+{
+	IBPROF_THREAD_CALL *entries = NULL;
+	double units = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	char *threads = NULL;
+	char *thread = NULL;
+	int64_t t_sum = 0;
+	int count = 0;
+	int ret = 0;
+	int i = 0;
+
+	count = ibprof_thread_call_gather(ibprof_obj->thread_list, ibprof_obj->generation,
+			module, call, &entries, &t_sum);
+
+	for (i = 0; i < count; i++) {
+		ret = sys_asprintf(&thread,
+			XML("thread",
+				XML("tid", "%d") \
+				XML("number", "%d") \
+				XML("count", "%ld") \
+				XML("total", "%.4f") \
+				XML("avg", "%.4f") \
+				XML("max", "%.4f") \
+				XML("call_percent", "%.2f")),
+			entries[i].tid,
+			entries[i].number,
+			(long)entries[i].count,
+			ibprof_clock_to_sec(entries[i].t_tot) * units,
+			(entries[i].samples ?
+				ibprof_clock_to_sec(entries[i].t_tot) * units / entries[i].samples : 0),
+			ibprof_clock_to_sec(entries[i].t_max) * units,
+			(t_sum ? entries[i].t_tot * 100.0 / t_sum : 0));
+		if (ret > 0) {
+			ret = sys_asprintf(&threads, "%s%s",
+				threads == NULL ? "" : threads,
+				thread);
+		}
+	}
+
+	sys_free(thread);
+	sys_free(entries);
+
+	return threads;
+}
+
+static const IBPROF_MODULE_CALL *_ibprof_module_call(IBPROF_OBJECT *ibprof_obj, int module, int call,
+		const char **module_name)
 {
+	IBPROF_MODULE_OBJECT *module_obj = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	int i = 0;
+
+	for (i = 0; (module_obj = ibprof_obj->module_array[i]); i++) {
+		if ((module_obj->id != module) || !module_obj->tbl_call)
+			continue;
+		*module_name = module_obj->name;
+		for (module_call = module_obj->tbl_call;
+			(module_call->call != UNDEFINED_VALUE) && module_call->name; module_call++) {
+			if (module_call->call == call)
+				return module_call;
+		}
+	}
+
+	return NULL;
+}
+
+static char *_ibprof_interval_dump(IBPROF_OBJECT *ibprof_obj, int rank)
+{
+	IBPROF_HASH_OBJECT *hash_obj = ibprof_obj->hash_obj;
+	IBPROF_HASH_OBJ *interval = NULL;
+	IBPROF_HASH_OBJ **entries = NULL;
+	const IBPROF_MODULE_CALL *module_call = NULL;
+	const char *module_name = NULL;
+	double units = ibprof_time_units_multiplier_val[ibprof_conf_get_int(IBPROF_TIME_UNITS)];
+	char *intervals = NULL;
+	char *calls = NULL;
+	char *call = NULL;
+	int count = 0;
+	int ret = 0;
+	int i = 0;
+	int j = 0;
+
+	if (!ibprof_interval_calls)
+		return NULL;
+
+	for (i = 0; i < hash_obj->size; i++) {
+		interval = &hash_obj->hash_table[i];
+		if ((interval->key == HASH_KEY_INVALID) ||
+			(HASH_KEY_GET_MODULE(interval->key) != IBPROF_MODULE_USER) ||
+			(HASH_KEY_GET_RANK(interval->key) != rank))
+			continue;
+
+		count = ibprof_interval_call_gather(hash_obj, interval->key, &entries);
+		for (j = 0; j < count; j++) {
+			module_name = "unknown";
+			module_call = _ibprof_module_call(ibprof_obj, HASH_KEY_GET_MODULE(entries[j]->key),
+					HASH_KEY_GET_CALL(entries[j]->key), &module_name);
+			ret = sys_asprintf(&call,
+				XML("call",
+					XML("module", "%s") \
+					XML("name", "%s") \
+					XML("count", "%ld") \
+					XML("total", "%.4f") \
+					XML("avg", "%.4f") \
+					XML("max", "%.4f") \
+					XML("self_percent", "%.2f")),
+				module_name,
+				(module_call ? module_call->name : "unknown"),
+				(long)entries[j]->count,
+				ibprof_clock_to_sec(entries[j]->t_tot) * units,
+				(entries[j]->samples ?
+					ibprof_clock_to_sec(entries[j]->t_tot) * units / entries[j]->samples : 0),
+				ibprof_clock_to_sec(entries[j]->t_max) * units,
+				(interval->t_self ? entries[j]->t_tot * 100.0 / interval->t_self : 0));
+			if (ret > 0) {
+				ret = sys_asprintf(&calls, "%s%s",
+					calls == NULL ? "" : calls,
+					call);
+			}
+		}
+
+		if (calls) {
+			ret = sys_asprintf(&intervals,
+				"%s" XML("interval",
+					XML("name", "%s") \
+					"%s"),
+				intervals == NULL ? "" : intervals,
+				(interval->call_name ? interval->call_name : "unknown"),
+				calls);
+		}
+
+		sys_free(calls);
+		calls = NULL;
+		sys_free(entries);
+	}
+
+	sys_free(call);
+
+	return intervals;
+}
+
+static int _ibprof_module_dump(char **module, IBPROF_MODULE_OBJECT *module_obj, IBPROF_OBJECT *ibprof_obj)
+{
+	IBPROF_HASH_OBJECT *hash_obj = ibprof_obj->hash_obj;
+	IBPROF_TASK_OBJECT *task_obj = ibprof_obj->task_obj;
 	const IBPROF_MODULE_CALL *temp_module_call = NULL;
 	char *str = NULL;
 	double total_time = 0;
 	char *module_calls = NULL;
+	char *intervals = NULL;
 	int ret = 0;
 
 	if (module_obj->tbl_call) {
 		char *module_call = NULL;
+		char *sizes = NULL;
+		char *threads = NULL;
 		temp_module_call = module_obj->tbl_call;
 
 		while (temp_module_call && (temp_module_call->call != UNDEFINED_VALUE && temp_module_call->name))
@@ -210,12 +438,27 @@ static int _ibprof_module_dump(char **module, IBPROF_MODULE_OBJECT *module_obj,
 				task_obj->procid,
 				_ibprof_hash_format_xml);
 
+			sizes = ibprof_hash_dump_size(
+				hash_obj,
+				module_obj->id,
+				temp_module_call->call,
+				task_obj->procid,
+				_ibprof_hash_format_size_xml);
+
+			threads = _ibprof_thread_dump(ibprof_obj, module_obj->id, temp_module_call->call);
+
 			if (str && str[0]) {
 				ret = sys_asprintf(&module_call,
 					XML("call",
 						XML("name", "%s") \
-						"%s"),
-					temp_module_call->name ? temp_module_call->name : "unknown", str);
+						"%s%s%s%s%s%s%s"),
+					temp_module_call->name ? temp_module_call->name : "unknown", str,
+					(sizes ? "<sizes>" : ""),
+					(sizes ? sizes : ""),
+					(sizes ? "</sizes>" : ""),
+					(threads ? "<threads>" : ""),
+					(threads ? threads : ""),
+					(threads ? "</threads>" : ""));
 				if (ret > 0) {
 					ret = sys_asprintf(&module_calls, "%s%s",
 						module_calls == NULL ? "" : module_calls,
@@ -224,6 +467,10 @@ static int _ibprof_module_dump(char **module, IBPROF_MODULE_OBJECT *module_obj,
 			}
 
 			free(str);
+			sys_free(sizes);
+			sizes = NULL;
+			sys_free(threads);
+			threads = NULL;
 			temp_module_call++;
 		}
 		sys_free(module_call);
@@ -239,6 +486,7 @@ static int _ibprof_module_dump(char **module, IBPROF_MODULE_OBJECT *module_obj,
 				ret = sys_asprintf(&module_calls, "%s", str);
 			}
 			free(str);
+			intervals = _ibprof_interval_dump(ibprof_obj, task_obj->procid);
 	}
 
 	total_time = ibprof_hash_module_total(hash_obj,
@@ -249,14 +497,19 @@ static int _ibprof_module_dump(char **module, IBPROF_MODULE_OBJECT *module_obj,
 		XML("module",
 			XML("name", "%s") \
 			XML("calls","%s") \
+			"%s%s%s" \
 			XML("total", "%.4f") \
 			XML("wall_time_percent", "%.4f")),
 			module_obj->name ? module_obj->name : "unknown",
 			module_calls,
+			(intervals ? "<intervals>" : ""),
+			(intervals ? intervals : ""),
+			(intervals ? "</intervals>" : ""),
 			total_time,
 			total_time / (task_obj->wall_time * 1.0e+6));
 
 	sys_free(module_calls);
+	sys_free(intervals);
 
 	return ret;
 }
@@ -186,6 +186,9 @@ DECLARE_OPTION(TRACE)
 #define PREFIX_ERR(x) ERR##x,
 DECLARE_OPTION(ERR)
 
+#define PREFIX_DELAY(x) DELAY##x,
+DECLARE_OPTION(DELAY)
+
 /****************************************************************************
  * Module configuration place
  ***************************************************************************/
@@ -260,6 +263,10 @@ static IBPROF_ERROR __mxm_init(IBPROF_MODULE_OBJECT *mod_obj)
 		src_api = &mxm_TRACE_funcs;
 		break;
 
+	case IBPROF_MODE_DELAY:
+		src_api = &mxm_DELAY_funcs;
+		break;
+
 	default:
 		src_api = &mxm_NONE_funcs;
 	}
@@ -159,6 +159,9 @@ DECLARE_OPTION(TRACE)
 #define PREFIX_ERR(x) ERR##x,
 DECLARE_OPTION(ERR)
 
+#define PREFIX_DELAY(x) DELAY##x,
+DECLARE_OPTION(DELAY)
+
 /****************************************************************************
  * Module configuration place
  ***************************************************************************/
@@ -226,6 +229,10 @@ static IBPROF_ERROR __pmix_init(IBPROF_MODULE_OBJECT *mod_obj)
 		src_api = &pmix_TRACE_funcs;
 		break;
 
+	case IBPROF_MODE_DELAY:
+		src_api = &pmix_DELAY_funcs;
+		break;
+
 	default:
 		src_api = &pmix_NONE_funcs;
 	}
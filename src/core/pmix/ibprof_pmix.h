@@ -44,33 +44,47 @@
 
 /* Profiling mode - collect timing information about function run-times */
 #define PRE_PROF(func_name) \
-	double tm_start; \
-	tm_start = ibprof_timestamp();
+	int64_t tm_start = 0; \
+	int sampled = ibprof_sample_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name)); \
+	if (sampled) tm_start = ibprof_clock_ticks();
 #define POST_PROF(func_name) \
-	ibprof_update(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start));
+	if (sampled) ibprof_update_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start));
 #define POST_RET_PROF(func_name) \
-	ibprof_update(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start));
+	if (sampled) ibprof_update_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start));
+
+/* Delay-injection mode - busy-wait before the call, time is profiled */
+#define PRE_DELAY(func_name) \
+	PRE_PROF(func_name) \
+	ibprof_delay_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name));
+#define POST_DELAY(func_name) POST_PROF(func_name)
+#define POST_RET_DELAY(func_name) POST_RET_PROF(func_name)
 
 /* Error-injection mode - return an error with some probability */
 #define PRE_ERR(func_name) \
-	double tm_start; \
+	int64_t tm_start; \
 	int64_t err = 0; \
-	tm_start = ibprof_timestamp();
+	tm_start = ibprof_clock_ticks();
 #define POST_ERR(func_name) \
-	ibprof_update_ex(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start), &err);
+	ibprof_update_call_ex(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start), &err);
 #define POST_RET_ERR(func_name) \
-	if ((rand() % 100) < ibprof_conf_get_int(IBPROF_ERR_PERCENT)) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
+	if (ibprof_fault_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name))) ret = (flip_ret ? ((typeof(ret))1) : ((typeof(ret))0)); \
 	err = (flip_ret ? (ret != 0) : (ret == 0)); \
-	ibprof_update_ex(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
-            ibprof_timestamp_diff(tm_start), &err);
+	ibprof_update_call_ex(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
+            ibprof_clock_diff(tm_start), &err);
 
-/* TODO: Stack-tracing mode - collect information about the origin of function calls */
-#define PRE_TRACE(func_name)
-#define POST_TRACE(func_name)
-#define POST_RET_TRACE(func_name)
+/* Trace mode - record start and duration of every call to a trace file */
+#define PRE_TRACE(func_name) \
+	int64_t tm_start; \
+	tm_start = ibprof_clock_ticks();
+#define POST_TRACE(func_name) \
+	ibprof_trace_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
+            tm_start, ibprof_clock_diff(tm_start), -1, 0);
+#define POST_RET_TRACE(func_name) \
+	ibprof_trace_call(IBPROF_MODULE_PMIX, TBL_CALL_NUMBER(func_name), \
+            tm_start, ibprof_clock_diff(tm_start), -1, 0);
 
 /*
  * Common macros, presenting the function stubs
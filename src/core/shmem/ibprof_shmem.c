@@ -334,48 +334,48 @@ static struct module_context_t {
 		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_p, addr, value, pe) }; \
 \
 	void TYPE ## shmem_short_put(short *target, const short *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_short_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_short_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_int_put(int *target, const int *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_int_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_int_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_long_put(long *target, const long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_long_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_long_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_float_put(float *target, const float *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_float_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_float_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_double_put(double *target, const double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_double_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_double_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longlong_put(long long *target, const long long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longlong_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longlong_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longdouble_put(long double *target, const long double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_put, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longdouble_put, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_put32(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put32, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put32, (int64_t)len * 4, target, source, len, pe) }; \
 	void TYPE ## shmem_put64(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put64, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put64, (int64_t)len * 8, target, source, len, pe) }; \
 	void TYPE ## shmem_put128(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put128, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put128, (int64_t)len * 16, target, source, len, pe) }; \
 	void TYPE ## shmem_putmem(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_putmem, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_putmem, (int64_t)len, target, source, len, pe) }; \
 \
 	void TYPE ## shmem_short_iput(short *target, const short *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_short_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_short_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_int_iput(int *target, const int *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_int_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_int_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_long_iput(long *target, const long *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_long_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_long_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_float_iput(float *target, const float *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_float_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_float_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_double_iput(double *target, const double *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_double_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_double_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_longlong_iput(long long *target, const long long *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longlong_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longlong_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_longdouble_iput(long double *target, const long double *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_iput, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longdouble_iput, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_iput32(void *target, const void *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_iput32, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_iput32, (int64_t)len * 4, target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_iput64(void *target, const void *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_iput64, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_iput64, (int64_t)len * 8, target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_iput128(void *target, const void *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_iput128, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_iput128, (int64_t)len * 16, target, source, tst, sst, len, pe) }; \
 \
 	char TYPE ## shmem_char_g(const char* addr, int pe) \
 		{ FUNC_BODY_ANY(char, TYPE, shmem_char_g, addr, pe) }; \
@@ -395,48 +395,48 @@ static struct module_context_t {
 		{ FUNC_BODY_ANY(long double, TYPE, shmem_longdouble_g, addr, pe) }; \
 \
 	void TYPE ## shmem_short_get(short *target, const short *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_short_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_short_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_int_get(int *target, const int *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_int_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_int_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_long_get(long *target, const long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_long_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_long_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_float_get(float *target, const float *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_float_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_float_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_double_get(double *target, const double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_double_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_double_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longlong_get(long long *target, const long long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longlong_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longlong_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longdouble_get(long double *target, const long double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_get, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longdouble_get, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_get32(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get32, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get32, (int64_t)len * 4, target, source, len, pe) }; \
 	void TYPE ## shmem_get64(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get64, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get64, (int64_t)len * 8, target, source, len, pe) }; \
 	void TYPE ## shmem_get128(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get128, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get128, (int64_t)len * 16, target, source, len, pe) }; \
 	void TYPE ## shmem_getmem(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_getmem, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_getmem, (int64_t)len, target, source, len, pe) }; \
 \
 	void TYPE ## shmem_short_iget(short *target, const short *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_short_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_short_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_int_iget(int *target, const int *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_int_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_int_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_long_iget(long *target, const long *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_long_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_long_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_float_iget(float *target, const float *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_float_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_float_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_double_iget(double *target, const double *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_double_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_double_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_longlong_iget(long long *target, const long long *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longlong_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longlong_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_longdouble_iget(long double *target, const long double *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_iget, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longdouble_iget, (int64_t)len * sizeof(*target), target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_iget32(void *target, const void *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_iget32, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_iget32, (int64_t)len * 4, target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_iget64(void *target, const void *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_iget64, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_iget64, (int64_t)len * 8, target, source, tst, sst, len, pe) }; \
 	void TYPE ## shmem_iget128(void *target, const void *source, ptrdiff_t tst, ptrdiff_t sst, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_iget128, target, source, tst, sst, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_iget128, (int64_t)len * 16, target, source, tst, sst, len, pe) }; \
 \
 	double TYPE ## shmem_double_swap(double *target, double value, int pe) \
 		{ FUNC_BODY_ANY(double, TYPE, shmem_double_swap, target, value, pe) }; \
@@ -645,62 +645,62 @@ static struct module_context_t {
 		{ FUNC_BODY_VOID(TYPE, shmem_clear_cache_line_inv, target) }; \
 \
 	void TYPE ## shmem_char_put_nbi(char *target, const char *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_char_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_char_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_short_put_nbi(short *target, const short *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_short_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_short_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_int_put_nbi(int *target, const int *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_int_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_int_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_long_put_nbi(long *target, const long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_long_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_long_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_float_put_nbi(float *target, const float *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_float_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_float_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_double_put_nbi(double *target, const double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_double_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_double_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longlong_put_nbi(long long *target, const long long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longlong_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longlong_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longdouble_put_nbi(long double *target, const long double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_put_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longdouble_put_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_put8_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put8_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put8_nbi, (int64_t)len, target, source, len, pe) }; \
 	void TYPE ## shmem_put16_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put16_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put16_nbi, (int64_t)len * 2, target, source, len, pe) }; \
 	void TYPE ## shmem_put32_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put32_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put32_nbi, (int64_t)len * 4, target, source, len, pe) }; \
 	void TYPE ## shmem_put64_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put64_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put64_nbi, (int64_t)len * 8, target, source, len, pe) }; \
 	void TYPE ## shmem_put128_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_put128_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_put128_nbi, (int64_t)len * 16, target, source, len, pe) }; \
 	void TYPE ## shmem_putmem_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_putmem_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_putmem_nbi, (int64_t)len, target, source, len, pe) }; \
 \
 	void TYPE ## shmem_char_get_nbi(char *target, const char *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_char_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_char_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_short_get_nbi(short *target, const short *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_short_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_short_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_int_get_nbi(int *target, const int *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_int_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_int_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_long_get_nbi(long *target, const long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_long_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_long_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_float_get_nbi(float *target, const float *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_float_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_float_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_double_get_nbi(double *target, const double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_double_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_double_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longlong_get_nbi(long long *target, const long long *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longlong_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longlong_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_longdouble_get_nbi(long double *target, const long double *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_longdouble_get_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_longdouble_get_nbi, (int64_t)len * sizeof(*target), target, source, len, pe) }; \
 	void TYPE ## shmem_get8_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get8_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get8_nbi, (int64_t)len, target, source, len, pe) }; \
 	void TYPE ## shmem_get16_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get16_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get16_nbi, (int64_t)len * 2, target, source, len, pe) }; \
 	void TYPE ## shmem_get32_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get32_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get32_nbi, (int64_t)len * 4, target, source, len, pe) }; \
 	void TYPE ## shmem_get64_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get64_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get64_nbi, (int64_t)len * 8, target, source, len, pe) }; \
 	void TYPE ## shmem_get128_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_get128_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_get128_nbi, (int64_t)len * 16, target, source, len, pe) }; \
 	void TYPE ## shmem_getmem_nbi(void *target, const void *source, size_t len, int pe) \
-		{ FUNC_BODY_VOID(TYPE, shmem_getmem_nbi, target, source, len, pe) }; \
+		{ FUNC_BODY_VOID_SIZE(TYPE, shmem_getmem_nbi, (int64_t)len, target, source, len, pe) }; \
 \
 	void TYPE ## shmem_alltoall32(void *target, const void *source, size_t nlong, int PE_start, int logPE_stride, int PE_size, long *pSync) \
 		{ FUNC_BODY_VOID(TYPE, shmem_alltoall32, target, source, nlong, PE_start, logPE_stride, PE_size, pSync) }; \
@@ -743,6 +743,9 @@ DECLARE_OPTION(TRACE)
 #define PREFIX_ERR(x) ERR##x,
 DECLARE_OPTION(ERR)
 
+#define PREFIX_DELAY(x) DELAY##x,
+DECLARE_OPTION(DELAY)
+
 /****************************************************************************
  * Module configuration place
  ***************************************************************************/
@@ -1012,6 +1015,10 @@ static IBPROF_ERROR __shmem_init(IBPROF_MODULE_OBJECT *mod_obj)
 		src_api = &shmem_TRACE_funcs;
 		break;
 
+	case IBPROF_MODE_DELAY:
+		src_api = &shmem_DELAY_funcs;
+		break;
+
 	default:
 		src_api = &shmem_NONE_funcs;
 	}
@@ -0,0 +1,710 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * ibprof-merge: reduces binary dumps of all ranks of a job (IBPROF_FORMAT=binary,
+ * see src/core/io/ibprof_binary.h) into job-wide tables: distribution of every
+ * call across ranks, slowest ranks and load imbalance. Files are mapped into
+ * memory and processed by pool of threads, every thread reduces own subset
+ * of files into private table, tables are merged at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ibprof_binary.h"
+
+#define MERGE_MAX_THREADS    (64)
+#define MERGE_TABLE_SIZE     (256) /* Initial number of slots in call table */
+
+/*
+ * Statistics of a call reduced across ranks (time in seconds)
+ */
+typedef struct {
+	char module[16];
+	char name[48];
+	int size_class;
+	int flags;
+	int used;
+	int ranks; /* number of ranks that made the call */
+	int64_t count;
+	int64_t samples;
+	int64_t err;
+	int64_t bytes;
+	double t_tot; /* sum across ranks */
+	double t_max; /* longest single call */
+	int t_max_rank;
+	double r_min; /* minimum of per-rank totals */
+	int r_min_rank;
+	double r_max; /* maximum of per-rank totals */
+	int r_max_rank;
+	double r_sq; /* sum of squares of per-rank totals */
+	double p99; /* worst p99 across ranks */
+} MERGE_CALL;
+
+typedef struct {
+	MERGE_CALL *calls;
+	int size; /* power of two */
+	int count;
+} MERGE_TABLE;
+
+/*
+ * Process found in dump files
+ */
+typedef struct {
+	int rank;
+	int pid;
+	char host[64];
+	double wall_time;
+	double t_lib; /* time spent in library calls */
+} MERGE_RANK;
+
+typedef struct {
+	pthread_t thread;
+	MERGE_TABLE table; /* calls of processed ranks */
+	MERGE_TABLE rank_table; /* calls of the rank being processed */
+	MERGE_RANK *ranks;
+	int rank_count;
+	int rank_size;
+	int dumps; /* dumps used */
+	int skipped; /* files without valid dump */
+} MERGE_WORKER;
+
+static struct {
+	int threads;
+	int lines;
+	int slowest;
+	int sizes;
+} merge_opt = { 0, 20, 10, 0 };
+
+static char **merge_files = NULL;
+static int merge_file_count = 0;
+static int merge_file_next = 0;
+
+static void __usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <file|directory> ...\n"
+		"  -j <threads>  number of threads (default number of CPUs)\n"
+		"  -l <lines>    number of calls shown (default 20, 0 - all)\n"
+		"  -r <ranks>    number of slowest ranks shown (default 10, 0 - all)\n"
+		"  -s            show message size classes\n"
+		"  -h            show this help\n"
+		"Files are written with IBPROF_FORMAT=binary, all regular files of a directory are read.\n",
+		prog);
+}
+
+static void __size_label(int size_class, char *buf, size_t len)
+{
+	static const char *units[] = { "", "K", "M", "G" };
+	uint64_t size = 0;
+	int i = 0;
+
+	if (size_class <= 0) {
+		snprintf(buf, len, "-");
+		return;
+	}
+	if (size_class == 1) {
+		snprintf(buf, len, "0");
+		return;
+	}
+
+	size = (uint64_t)1 << (size_class - 2);
+	while ((size >= 1024) && (i < (int)(sizeof(units) / sizeof(units[0])) - 1)) {
+		size /= 1024;
+		i++;
+	}
+	snprintf(buf, len, ">=%lu%s", (unsigned long)size, units[i]);
+}
+
+static uint64_t __call_hash(const char *module, const char *name, int size_class)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	const char *ptr = NULL;
+
+	for (ptr = module; *ptr; ptr++)
+		hash = (hash ^ (unsigned char)*ptr) * 1099511628211ULL;
+	for (ptr = name; *ptr; ptr++)
+		hash = (hash ^ (unsigned char)*ptr) * 1099511628211ULL;
+
+	return (hash ^ (uint64_t)size_class) * 1099511628211ULL;
+}
+
+static int __table_init(MERGE_TABLE *table, int size)
+{
+	table->calls = (MERGE_CALL *)calloc(size, sizeof(MERGE_CALL));
+	table->size = size;
+	table->count = 0;
+
+	return (table->calls ? 0 : -1);
+}
+
+static void __table_clear(MERGE_TABLE *table)
+{
+	memset(table->calls, 0, table->size * sizeof(MERGE_CALL));
+	table->count = 0;
+}
+
+/*
+ * Find call in the table, new empty call is inserted if it is not found
+ */
+static MERGE_CALL *__table_find(MERGE_TABLE *table, const char *module,
+		const char *name, int size_class)
+{
+	MERGE_CALL *call = NULL;
+	int idx = 0;
+
+	if ((table->count + 1) * 2 > table->size) {
+		MERGE_TABLE grown;
+		int i = 0;
+
+		if (__table_init(&grown, table->size * 2))
+			return NULL;
+		for (i = 0; i < table->size; i++) {
+			if (!table->calls[i].used)
+				continue;
+			call = __table_find(&grown, table->calls[i].module,
+					table->calls[i].name, table->calls[i].size_class);
+			*call = table->calls[i];
+		}
+		free(table->calls);
+		*table = grown;
+	}
+
+	idx = (int)(__call_hash(module, name, size_class) & (table->size - 1));
+	while (table->calls[idx].used) {
+		call = &table->calls[idx];
+		if ((call->size_class == size_class) &&
+			!strcmp(call->module, module) && !strcmp(call->name, name))
+			return call;
+		idx = (idx + 1) & (table->size - 1);
+	}
+
+	call = &table->calls[idx];
+	snprintf(call->module, sizeof(call->module), "%s", module);
+	snprintf(call->name, sizeof(call->name), "%s", name);
+	call->size_class = size_class;
+	call->used = 1;
+	table->count++;
+
+	return call;
+}
+
+/*
+ * Accumulate statistics of ranks (src) into dst
+ */
+static void __call_merge(MERGE_CALL *dst, const MERGE_CALL *src)
+{
+	if (!dst->ranks) {
+		*dst = *src;
+		return;
+	}
+
+	dst->ranks += src->ranks;
+	dst->count += src->count;
+	dst->samples += src->samples;
+	dst->err += src->err;
+	dst->bytes += src->bytes;
+	dst->t_tot += src->t_tot;
+	dst->r_sq += src->r_sq;
+	if (src->t_max > dst->t_max) {
+		dst->t_max = src->t_max;
+		dst->t_max_rank = src->t_max_rank;
+	}
+	if (src->r_min < dst->r_min) {
+		dst->r_min = src->r_min;
+		dst->r_min_rank = src->r_min_rank;
+	}
+	if (src->r_max > dst->r_max) {
+		dst->r_max = src->r_max;
+		dst->r_max_rank = src->r_max_rank;
+	}
+	if (src->p99 > dst->p99)
+		dst->p99 = src->p99;
+}
+
+static int __table_merge(MERGE_TABLE *dst, const MERGE_TABLE *src)
+{
+	MERGE_CALL *call = NULL;
+	int i = 0;
+
+	for (i = 0; i < src->size; i++) {
+		if (!src->calls[i].used)
+			continue;
+		call = __table_find(dst, src->calls[i].module,
+				src->calls[i].name, src->calls[i].size_class);
+		if (!call)
+			return -1;
+		__call_merge(call, &src->calls[i]);
+	}
+
+	return 0;
+}
+
+static const IBPROF_BINARY_HEADER *__dump_check(const char *base, size_t size, size_t offset)
+{
+	const IBPROF_BINARY_HEADER *header = (const IBPROF_BINARY_HEADER *)(base + offset);
+
+	if ((size - offset) < sizeof(IBPROF_BINARY_HEADER) ||
+		memcmp(header->magic, IBPROF_BINARY_MAGIC, sizeof(header->magic)) ||
+		(header->version != IBPROF_BINARY_VERSION) ||
+		(header->header_size < sizeof(IBPROF_BINARY_HEADER)) ||
+		(header->header_size > (size - offset)) ||
+		(header->record_size < offsetof(IBPROF_BINARY_RECORD, tid)) ||
+		((size - offset - header->header_size) / header->record_size < header->record_count))
+		return NULL;
+
+	return header;
+}
+
+/*
+ * Accumulate records of a dump into table of the rank being processed
+ */
+static void __dump_add(MERGE_WORKER *worker, const IBPROF_BINARY_HEADER *header,
+		MERGE_RANK *rank)
+{
+	const char *records = (const char *)header + header->header_size;
+	double sec = (header->freq > 0 ? 1.0 / header->freq : 0);
+	uint32_t i = 0;
+
+	for (i = 0; i < header->record_count; i++) {
+		const IBPROF_BINARY_RECORD *record =
+			(const IBPROF_BINARY_RECORD *)(records + (size_t)i * header->record_size);
+		char module[sizeof(record->module_name) + 1];
+		char name[sizeof(record->name) + 1];
+		MERGE_CALL *call = NULL;
+
+		if (record->size_class && !merge_opt.sizes)
+			continue;
+		/* Thread and interval records split totals that are merged already */
+		if (record->flags & (IBPROF_BINARY_FLAG_THREAD | IBPROF_BINARY_FLAG_INTERVAL))
+			continue;
+		if (!record->size_class && !(record->flags & IBPROF_BINARY_FLAG_USER))
+			rank->t_lib += record->t_tot * sec;
+
+		memcpy(module, record->module_name, sizeof(record->module_name));
+		module[sizeof(record->module_name)] = '\0';
+		memcpy(name, record->name, sizeof(record->name));
+		name[sizeof(record->name)] = '\0';
+
+		call = __table_find(&worker->rank_table, module, name, record->size_class);
+		if (!call)
+			continue;
+		call->flags = record->flags;
+		call->ranks = 1;
+		call->count += record->count;
+		call->samples += record->samples;
+		call->err += record->err;
+		call->bytes += record->bytes;
+		call->t_tot += record->t_tot * sec;
+		if (record->t_max * sec > call->t_max) {
+			call->t_max = record->t_max * sec;
+			call->t_max_rank = header->rank;
+		}
+		if (record->t_pct[2] * sec > call->p99)
+			call->p99 = record->t_pct[2] * sec;
+	}
+	worker->dumps++;
+}
+
+/*
+ * Move calls of the processed rank to table of the worker
+ */
+static void __rank_done(MERGE_WORKER *worker, MERGE_RANK *rank)
+{
+	MERGE_TABLE *rank_table = &worker->rank_table;
+	MERGE_CALL *call = NULL;
+	MERGE_CALL *dst = NULL;
+	int i = 0;
+
+	for (i = 0; i < rank_table->size; i++) {
+		call = &rank_table->calls[i];
+		if (!call->used)
+			continue;
+		call->r_min = call->r_max = call->t_tot;
+		call->r_min_rank = call->r_max_rank = rank->rank;
+		call->r_sq = call->t_tot * call->t_tot;
+		dst = __table_find(&worker->table, call->module, call->name, call->size_class);
+		if (dst)
+			__call_merge(dst, call);
+	}
+	__table_clear(rank_table);
+
+	if (worker->rank_count == worker->rank_size) {
+		MERGE_RANK *ranks = (MERGE_RANK *)realloc(worker->ranks,
+				(worker->rank_size * 2 + 16) * sizeof(MERGE_RANK));
+		if (!ranks)
+			return;
+		worker->ranks = ranks;
+		worker->rank_size = worker->rank_size * 2 + 16;
+	}
+	worker->ranks[worker->rank_count++] = *rank;
+}
+
+/*
+ * File can keep several dumps of several processes. Final dumps of a process
+ * are summed. Process that has not finished is taken from snapshots: all delta
+ * snapshots are summed, the last cumulative one is used.
+ */
+static void __file_process(MERGE_WORKER *worker, const char *file_name)
+{
+	const IBPROF_BINARY_HEADER *header = NULL;
+	const IBPROF_BINARY_HEADER **dumps = NULL;
+	MERGE_RANK rank;
+	struct stat statbuf;
+	void *addr = MAP_FAILED;
+	size_t offset = 0;
+	int count = 0;
+	int size = 0;
+	int fd = -1;
+	int i = 0;
+	int j = 0;
+
+	fd = open(file_name, O_RDONLY);
+	if ((fd < 0) || fstat(fd, &statbuf) || (statbuf.st_size <= 0))
+		goto out;
+	addr = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+		goto out;
+
+	/* Truncated dump at the end of file (being written) is ignored */
+	while ((offset < (size_t)statbuf.st_size) &&
+		(header = __dump_check((const char *)addr, statbuf.st_size, offset))) {
+		if (count == size) {
+			const IBPROF_BINARY_HEADER **grown = (const IBPROF_BINARY_HEADER **)
+				realloc(dumps, (size * 2 + 4) * sizeof(*dumps));
+			if (!grown)
+				break;
+			dumps = grown;
+			size = size * 2 + 4;
+		}
+		dumps[count++] = header;
+		offset += header->header_size + (size_t)header->record_count * header->record_size;
+	}
+
+	for (i = 0; i < count; i++) {
+		int final = 0;
+		int last = i;
+
+		if (!dumps[i])
+			continue;
+		for (j = i; j < count; j++) {
+			if (dumps[j] && (dumps[j]->pid == dumps[i]->pid)) {
+				final |= !dumps[j]->snapshot;
+				last = j;
+			}
+		}
+
+		memset(&rank, 0, sizeof(rank));
+		rank.rank = dumps[i]->rank;
+		rank.pid = dumps[i]->pid;
+		memcpy(rank.host, dumps[i]->host, sizeof(rank.host) - 1);
+
+		for (j = last; j >= i; j--) {
+			header = dumps[j];
+			if (!header || (header->pid != rank.pid))
+				continue;
+			dumps[j] = NULL;
+
+			if (final ? !header->snapshot : (header->delta || (j == last))) {
+				__dump_add(worker, header, &rank);
+				if (!final && header->delta)
+					rank.wall_time += header->wall_time;
+				else if (header->wall_time > rank.wall_time)
+					rank.wall_time = header->wall_time;
+			}
+		}
+		__rank_done(worker, &rank);
+	}
+
+out:
+	if (!count) {
+		fprintf(stderr, "%s : no valid dump is found\n", file_name);
+		worker->skipped++;
+	}
+	free(dumps);
+	if (addr != MAP_FAILED)
+		munmap(addr, statbuf.st_size);
+	if (fd >= 0)
+		close(fd);
+}
+
+static void *__worker(void *arg)
+{
+	MERGE_WORKER *worker = (MERGE_WORKER *)arg;
+	int i = 0;
+
+	while ((i = __atomic_fetch_add(&merge_file_next, 1, __ATOMIC_RELAXED)) < merge_file_count)
+		__file_process(worker, merge_files[i]);
+
+	return NULL;
+}
+
+static int __file_add(const char *file_name)
+{
+	if (!(merge_file_count & (merge_file_count - 1))) {
+		char **files = (char **)realloc(merge_files,
+				(merge_file_count ? merge_file_count * 2 : 1) * sizeof(char *));
+		if (!files)
+			return -1;
+		merge_files = files;
+	}
+
+	merge_files[merge_file_count] = strdup(file_name);
+	if (!merge_files[merge_file_count])
+		return -1;
+	merge_file_count++;
+
+	return 0;
+}
+
+static int __path_add(const char *path)
+{
+	char file_name[PATH_MAX];
+	struct stat statbuf;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+	int ret = 0;
+
+	if (stat(path, &statbuf)) {
+		fprintf(stderr, "%s : %s\n", path, strerror(errno));
+		return 0;
+	}
+	if (!S_ISDIR(statbuf.st_mode))
+		return __file_add(path);
+
+	dir = opendir(path);
+	if (!dir) {
+		fprintf(stderr, "%s : %s\n", path, strerror(errno));
+		return 0;
+	}
+	while (!ret && (entry = readdir(dir))) {
+		if ((entry->d_name[0] == '.') ||
+			(snprintf(file_name, sizeof(file_name), "%s/%s", path, entry->d_name) >= (int)sizeof(file_name)))
+			continue;
+		if (!stat(file_name, &statbuf) && S_ISREG(statbuf.st_mode))
+			ret = __file_add(file_name);
+	}
+	closedir(dir);
+
+	return ret;
+}
+
+static int __call_compare(const void *a, const void *b)
+{
+	const MERGE_CALL *call_a = *(const MERGE_CALL **)a;
+	const MERGE_CALL *call_b = *(const MERGE_CALL **)b;
+
+	if (call_a->t_tot != call_b->t_tot)
+		return (call_a->t_tot < call_b->t_tot ? 1 : -1);
+	return call_a->size_class - call_b->size_class;
+}
+
+static int __rank_compare(const void *a, const void *b)
+{
+	const MERGE_RANK *rank_a = (const MERGE_RANK *)a;
+	const MERGE_RANK *rank_b = (const MERGE_RANK *)b;
+
+	if (rank_a->t_lib != rank_b->t_lib)
+		return (rank_a->t_lib < rank_b->t_lib ? 1 : -1);
+	return rank_a->rank - rank_b->rank;
+}
+
+static void __report(MERGE_TABLE *table, MERGE_RANK *ranks, int rank_count)
+{
+	MERGE_CALL **calls = NULL;
+	double wall_min = 0, wall_max = 0, wall_avg = 0;
+	double lib_avg = 0, lib_sq = 0, lib_sigma = 0;
+	char size[32];
+	int count = 0;
+	int i = 0;
+
+	for (i = 0; i < rank_count; i++) {
+		wall_min = (!i || ranks[i].wall_time < wall_min ? ranks[i].wall_time : wall_min);
+		wall_max = (!i || ranks[i].wall_time > wall_max ? ranks[i].wall_time : wall_max);
+		wall_avg += ranks[i].wall_time / rank_count;
+		lib_avg += ranks[i].t_lib / rank_count;
+		lib_sq += ranks[i].t_lib * ranks[i].t_lib / rank_count;
+	}
+	lib_sigma = sqrt(lib_sq > lib_avg * lib_avg ? lib_sq - lib_avg * lib_avg : 0);
+
+	qsort(ranks, rank_count, sizeof(*ranks), __rank_compare);
+
+	printf("ranks          : %d\n", rank_count);
+	printf("wall time      : min %.3f avg %.3f max %.3f sec\n", wall_min, wall_avg, wall_max);
+	if (rank_count) {
+		printf("library time   : min %.3f (rank %d) avg %.3f max %.3f (rank %d) sigma %.3f sec\n",
+			ranks[rank_count - 1].t_lib, ranks[rank_count - 1].rank,
+			lib_avg, ranks[0].t_lib, ranks[0].rank, lib_sigma);
+		printf("load imbalance : max/avg %.3f, %.1f%% (time lost waiting for slowest rank %.3f sec)\n",
+			(lib_avg > 0 ? ranks[0].t_lib / lib_avg : 0),
+			(ranks[0].t_lib > 0 ? (ranks[0].t_lib - lib_avg) / ranks[0].t_lib * 100.0 : 0),
+			(ranks[0].t_lib - lib_avg) * rank_count);
+	}
+
+	calls = (MERGE_CALL **)malloc((table->count + 1) * sizeof(*calls));
+	if (!calls)
+		return;
+	for (i = 0; i < table->size; i++) {
+		if (table->calls[i].used)
+			calls[count++] = &table->calls[i];
+	}
+	qsort(calls, count, sizeof(*calls), __call_compare);
+
+	printf("\nper call distribution across ranks (time per rank in sec, call time in usec)\n");
+	printf("%-12s %-28s %-8s %6s %12s %10s %9s %9s %10s %7s %10s %7s %9s %7s\n",
+		"MODULE", "CALL", "SIZE", "RANKS", "COUNT", "TOTAL", "AVG(us)", "MAX(us)",
+		"MIN", "RANK", "MAX", "RANK", "SIGMA", "IMBAL");
+	for (i = 0; i < count && (!merge_opt.lines || i < merge_opt.lines); i++) {
+		MERGE_CALL *call = calls[i];
+		double avg = call->t_tot / call->ranks;
+		double sq = call->r_sq / call->ranks;
+
+		__size_label(call->size_class, size, sizeof(size));
+		printf("%-12s %-28.28s %-8.8s %6d %12ld %10.3f %9.3f %9.3f %10.3f %7d %10.3f %7d %9.3f %7.2f\n",
+			call->module, call->name, size, call->ranks, (long)call->count, call->t_tot,
+			(call->samples > 0 ? call->t_tot / call->samples * 1.0e+6 : 0),
+			call->t_max * 1.0e+6,
+			call->r_min, call->r_min_rank, call->r_max, call->r_max_rank,
+			sqrt(sq > avg * avg ? sq - avg * avg : 0),
+			(avg > 0 ? call->r_max / avg : 0));
+	}
+
+	printf("\nslowest ranks (time in library calls)\n");
+	printf("%7s %8s %-24s %10s %10s %7s %7s\n",
+		"RANK", "PID", "HOST", "WALL", "LIBRARY", "LIB%", "SIGMA");
+	for (i = 0; i < rank_count && (!merge_opt.slowest || i < merge_opt.slowest); i++) {
+		printf("%7d %8d %-24.24s %10.3f %10.3f %7.2f %7.2f\n",
+			ranks[i].rank, ranks[i].pid, ranks[i].host,
+			ranks[i].wall_time, ranks[i].t_lib,
+			(ranks[i].wall_time > 0 ? ranks[i].t_lib / ranks[i].wall_time * 100.0 : 0),
+			(lib_sigma > 0 ? (ranks[i].t_lib - lib_avg) / lib_sigma : 0));
+	}
+
+	free(calls);
+}
+
+int main(int argc, char **argv)
+{
+	MERGE_WORKER *workers = NULL;
+	MERGE_TABLE table;
+	MERGE_RANK *ranks = NULL;
+	int rank_count = 0;
+	int dumps = 0;
+	int skipped = 0;
+	int opt = 0;
+	int i = 0;
+
+	while ((opt = getopt(argc, argv, "j:l:r:sh")) != -1) {
+		switch (opt) {
+		case 'j':
+			merge_opt.threads = atoi(optarg);
+			break;
+		case 'l':
+			merge_opt.lines = atoi(optarg);
+			break;
+		case 'r':
+			merge_opt.slowest = atoi(optarg);
+			break;
+		case 's':
+			merge_opt.sizes = 1;
+			break;
+		default:
+			__usage(argv[0]);
+			return (opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+	if (optind >= argc) {
+		__usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (__path_add(argv[i])) {
+			fprintf(stderr, "Can't allocate file list\n");
+			return EXIT_FAILURE;
+		}
+	}
+	if (!merge_file_count) {
+		fprintf(stderr, "No files to merge\n");
+		return EXIT_FAILURE;
+	}
+
+	if (merge_opt.threads <= 0)
+		merge_opt.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (merge_opt.threads > MERGE_MAX_THREADS)
+		merge_opt.threads = MERGE_MAX_THREADS;
+	if (merge_opt.threads > merge_file_count)
+		merge_opt.threads = merge_file_count;
+	if (merge_opt.threads <= 0)
+		merge_opt.threads = 1;
+
+	workers = (MERGE_WORKER *)calloc(merge_opt.threads, sizeof(*workers));
+	if (!workers || __table_init(&table, MERGE_TABLE_SIZE)) {
+		fprintf(stderr, "Can't allocate memory\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < merge_opt.threads; i++) {
+		if (__table_init(&workers[i].table, MERGE_TABLE_SIZE) ||
+			__table_init(&workers[i].rank_table, MERGE_TABLE_SIZE) ||
+			pthread_create(&workers[i].thread, NULL, __worker, &workers[i])) {
+			fprintf(stderr, "Can't start worker thread\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < merge_opt.threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		rank_count += workers[i].rank_count;
+	}
+
+	ranks = (MERGE_RANK *)malloc((rank_count + 1) * sizeof(*ranks));
+	if (!ranks) {
+		fprintf(stderr, "Can't allocate memory\n");
+		return EXIT_FAILURE;
+	}
+	for (rank_count = 0, i = 0; i < merge_opt.threads; i++) {
+		if (__table_merge(&table, &workers[i].table)) {
+			fprintf(stderr, "Can't allocate memory\n");
+			return EXIT_FAILURE;
+		}
+		memcpy(ranks + rank_count, workers[i].ranks, workers[i].rank_count * sizeof(*ranks));
+		rank_count += workers[i].rank_count;
+		dumps += workers[i].dumps;
+		skipped += workers[i].skipped;
+		free(workers[i].table.calls);
+		free(workers[i].rank_table.calls);
+		free(workers[i].ranks);
+	}
+
+	printf("files          : %d (%d skipped), %d dumps\n", merge_file_count, skipped, dumps);
+	__report(&table, ranks, rank_count);
+
+	for (i = 0; i < merge_file_count; i++)
+		free(merge_files[i]);
+	free(merge_files);
+	free(ranks);
+	free(table.calls);
+	free(workers);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2013-2015 Mellanox Technologies, Inc.
+ *                         All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * ibprof-top: shows live call rates and latencies of profiled processes
+ * running on the node. Processes publish statistics in shared memory when
+ * IBPROF_LIVE_INTERVAL is set (see src/core/ibprof_live.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ibprof_live.h"
+
+#define TOP_SHM_DIR          "/dev/shm"
+#define TOP_READ_ATTEMPTS    (100) /* Attempts to read consistent segment */
+
+/*
+ * Attached process
+ */
+typedef struct _TOP_PROC {
+	char name[NAME_MAX + 2]; /* segment name */
+	size_t size; /* segment size */
+	const IBPROF_LIVE_HEADER *header; /* mapped segment */
+	IBPROF_LIVE_RECORD *cur; /* records read at this refresh */
+	IBPROF_LIVE_RECORD *prev; /* records read at previous refresh */
+	double t_cur; /* update time of cur */
+	double t_prev; /* update time of prev (negative if none) */
+	int seen; /* segment still exists */
+	struct _TOP_PROC *next;
+} TOP_PROC;
+
+/*
+ * Output line
+ */
+typedef struct {
+	const TOP_PROC *proc;
+	const IBPROF_LIVE_RECORD *record;
+	double rate; /* calls per second */
+	double avg; /* average time in usec during period */
+	double max; /* maximum time in usec since start */
+} TOP_ROW;
+
+static struct {
+	double delay;
+	int iterations;
+	int pid;
+	int lines;
+	int batch;
+} top_opt = { 1.0, 0, 0, 20, 0 };
+
+static TOP_PROC *top_list = NULL;
+
+static void __usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -d <sec>    refresh period (default 1)\n"
+		"  -n <count>  number of refreshes (default unlimited)\n"
+		"  -p <pid>    show given process only\n"
+		"  -l <lines>  number of calls shown (default 20, 0 - all)\n"
+		"  -b          batch mode (do not clear screen)\n"
+		"  -h          show this help\n"
+		"Profiled processes should be started with IBPROF_LIVE_INTERVAL=<msec>.\n",
+		prog);
+}
+
+static void __proc_detach(TOP_PROC *proc)
+{
+	munmap((void *)proc->header, proc->size);
+	free(proc->cur);
+	free(proc->prev);
+	free(proc);
+}
+
+static TOP_PROC *__proc_attach(const char *file_name)
+{
+	TOP_PROC *proc = NULL;
+	const IBPROF_LIVE_HEADER *header = NULL;
+	struct stat statbuf;
+	void *addr = MAP_FAILED;
+	int fd = -1;
+
+	proc = (TOP_PROC *)calloc(1, sizeof(*proc));
+	if (!proc)
+		return NULL;
+	snprintf(proc->name, sizeof(proc->name), "/%s", file_name);
+
+	fd = shm_open(proc->name, O_RDONLY, 0);
+	if ((fd < 0) || fstat(fd, &statbuf) || (statbuf.st_size < (off_t)sizeof(*header)))
+		goto err;
+	proc->size = statbuf.st_size;
+	addr = mmap(NULL, proc->size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		goto err;
+	close(fd);
+	fd = -1;
+
+	header = (const IBPROF_LIVE_HEADER *)addr;
+	if (memcmp(header->magic, IBPROF_LIVE_MAGIC, sizeof(header->magic)) ||
+		(header->version != IBPROF_LIVE_VERSION) ||
+		(header->record_size != sizeof(IBPROF_LIVE_RECORD)) ||
+		(header->header_size + (size_t)header->record_count * header->record_size > proc->size))
+		goto err;
+
+	proc->header = header;
+	proc->cur = (IBPROF_LIVE_RECORD *)calloc(header->record_count + 1, sizeof(IBPROF_LIVE_RECORD));
+	proc->prev = (IBPROF_LIVE_RECORD *)calloc(header->record_count + 1, sizeof(IBPROF_LIVE_RECORD));
+	if (!proc->cur || !proc->prev) {
+		free(proc->cur);
+		free(proc->prev);
+		goto err;
+	}
+	proc->t_cur = -1.0;
+
+	return proc;
+
+err:
+	if (fd >= 0)
+		close(fd);
+	if (addr != MAP_FAILED)
+		munmap(addr, statbuf.st_size);
+	free(proc);
+	return NULL;
+}
+
+/*
+ * Copy records under sequence lock of the publisher
+ */
+static int __proc_read(TOP_PROC *proc)
+{
+	const IBPROF_LIVE_HEADER *header = proc->header;
+	const IBPROF_LIVE_RECORD *records =
+		(const IBPROF_LIVE_RECORD *)((const char *)header + header->header_size);
+	IBPROF_LIVE_RECORD *temp = NULL;
+	uint64_t seq1, seq2;
+	double t_update = 0;
+	int i = 0;
+
+	for (i = 0; i < TOP_READ_ATTEMPTS; i++) {
+		seq1 = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+		if (seq1 & 1) {
+			usleep(100);
+			continue;
+		}
+		memcpy(proc->prev, records, header->record_count * sizeof(IBPROF_LIVE_RECORD));
+		t_update = header->t_update;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&header->seq, __ATOMIC_RELAXED);
+		if (seq1 == seq2)
+			break;
+	}
+	if (i == TOP_READ_ATTEMPTS)
+		return -1;
+
+	/* New data is read into prev buffer, swap it with current one */
+	temp = proc->cur;
+	proc->cur = proc->prev;
+	proc->prev = temp;
+	proc->t_prev = proc->t_cur;
+	proc->t_cur = t_update;
+
+	return 0;
+}
+
+static void __proc_scan(void)
+{
+	TOP_PROC *proc = NULL;
+	TOP_PROC **link = NULL;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+	const char *prefix = IBPROF_LIVE_PREFIX + 1;
+	char name[NAME_MAX + 2];
+
+	for (proc = top_list; proc; proc = proc->next)
+		proc->seen = 0;
+
+	dir = opendir(TOP_SHM_DIR);
+	if (!dir)
+		return;
+
+	while ((entry = readdir(dir))) {
+		if (strncmp(entry->d_name, prefix, strlen(prefix)))
+			continue;
+		if (top_opt.pid && (atoi(entry->d_name + strlen(prefix)) != top_opt.pid))
+			continue;
+		snprintf(name, sizeof(name), "/%s", entry->d_name);
+		for (proc = top_list; proc; proc = proc->next) {
+			if (!strcmp(proc->name, name))
+				break;
+		}
+		if (!proc) {
+			proc = __proc_attach(entry->d_name);
+			if (!proc)
+				continue;
+			proc->next = top_list;
+			top_list = proc;
+		}
+		/* Segment of killed process is left in place */
+		proc->seen = ((kill(proc->header->pid, 0) == 0) || (errno != ESRCH));
+	}
+	closedir(dir);
+
+	for (link = &top_list; (proc = *link);) {
+		if (!proc->seen) {
+			*link = proc->next;
+			__proc_detach(proc);
+		} else
+			link = &proc->next;
+	}
+}
+
+static int __row_compare(const void *a, const void *b)
+{
+	const TOP_ROW *row1 = (const TOP_ROW *)a;
+	const TOP_ROW *row2 = (const TOP_ROW *)b;
+
+	if (row1->rate != row2->rate)
+		return (row1->rate < row2->rate ? 1 : -1);
+	return (row1->record->count < row2->record->count ? 1 :
+		(row1->record->count > row2->record->count ? -1 : 0));
+}
+
+static void __refresh(void)
+{
+	TOP_PROC *proc = NULL;
+	TOP_ROW *rows = NULL;
+	const IBPROF_LIVE_RECORD *cur = NULL;
+	const IBPROF_LIVE_RECORD *prev = NULL;
+	double usec = 0;
+	double period = 0;
+	int64_t count = 0;
+	int64_t samples = 0;
+	int row_count = 0;
+	int proc_count = 0;
+	int max_rows = 0;
+	uint32_t i = 0;
+	int j = 0;
+
+	__proc_scan();
+
+	for (proc = top_list; proc; proc = proc->next)
+		max_rows += proc->header->record_count;
+	rows = (TOP_ROW *)calloc(max_rows + 1, sizeof(TOP_ROW));
+	if (!rows)
+		return;
+
+	for (proc = top_list; proc; proc = proc->next) {
+		if (__proc_read(proc))
+			continue;
+		proc_count++;
+		usec = 1.0e+6 / proc->header->freq;
+		period = (proc->t_prev >= 0 ? proc->t_cur - proc->t_prev : 0);
+		for (i = 0; i < proc->header->record_count; i++) {
+			cur = &proc->cur[i];
+			prev = &proc->prev[i];
+			if (cur->count <= 0)
+				continue;
+			count = cur->count - (period > 0 ? prev->count : 0);
+			samples = cur->samples - (period > 0 ? prev->samples : 0);
+			rows[row_count].proc = proc;
+			rows[row_count].record = cur;
+			rows[row_count].rate = (period > 0 ? count / period : 0);
+			rows[row_count].avg = (samples > 0 ?
+				(cur->t_tot - (period > 0 ? prev->t_tot : 0)) * usec / samples : 0);
+			rows[row_count].max = cur->t_max * usec;
+			row_count++;
+		}
+	}
+
+	qsort(rows, row_count, sizeof(TOP_ROW), __row_compare);
+
+	if (!top_opt.batch)
+		printf("\033[H\033[2J");
+	printf("ibprof-top - %d process(es), %d active call(s)\n\n", proc_count, row_count);
+	printf("%6s %8s %-16.16s %-12s %-32.32s %12s %12s %12s %14s\n",
+		"RANK", "PID", "HOST", "MODULE", "CALL",
+		"CALLS/s", "AVG(us)", "MAX(us)", "COUNT");
+	for (j = 0; (j < row_count) && (!top_opt.lines || (j < top_opt.lines)); j++) {
+		printf("%6d %8d %-16.16s %-12.15s %-32.32s %12.1f %12.3f %12.3f %14ld\n",
+			rows[j].proc->header->rank,
+			rows[j].proc->header->pid,
+			rows[j].proc->header->host,
+			rows[j].record->module,
+			rows[j].record->name,
+			rows[j].rate,
+			rows[j].avg,
+			rows[j].max,
+			(long)rows[j].record->count);
+	}
+	printf("\n");
+	fflush(stdout);
+
+	free(rows);
+}
+
+int main(int argc, char **argv)
+{
+	int opt = 0;
+	int i = 0;
+
+	while ((opt = getopt(argc, argv, "d:n:p:l:bh")) != -1) {
+		switch (opt) {
+		case 'd':
+			top_opt.delay = atof(optarg);
+			break;
+		case 'n':
+			top_opt.iterations = atoi(optarg);
+			break;
+		case 'p':
+			top_opt.pid = atoi(optarg);
+			break;
+		case 'l':
+			top_opt.lines = atoi(optarg);
+			break;
+		case 'b':
+			top_opt.batch = 1;
+			break;
+		default:
+			__usage(argv[0]);
+			return (opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+	if (top_opt.delay <= 0)
+		top_opt.delay = 1.0;
+
+	for (i = 0; !top_opt.iterations || (i < top_opt.iterations); i++) {
+		__refresh();
+		if (!top_opt.iterations || (i + 1 < top_opt.iterations))
+			usleep((useconds_t)(top_opt.delay * 1.0e+6));
+	}
+
+	while (top_list) {
+		TOP_PROC *proc = top_list;
+
+		top_list = proc->next;
+		__proc_detach(proc);
+	}
+
+	return EXIT_SUCCESS;
+}